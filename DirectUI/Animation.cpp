@@ -0,0 +1,274 @@
+#include "Animation.h"
+#include "Window.h"
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <xmmintrin.h> // for SSE intrinsics
+#define DIRECTUI_ANIMATION_SSE
+#endif
+
+namespace directui
+{
+
+namespace
+{
+
+// Every easing is a cubic e(t) = a*t + b*t^2 + c*t^3 with e(0) = 0 and e(1) = 1,
+// so evaluation does not need to branch on the easing of a channel.
+struct EasingCoefficients
+{
+	float a, b, c;
+};
+
+EasingCoefficients CoefficientsFromEasing( Easing easing )
+{
+	switch ( easing )
+	{
+		case Easing::Linear:	return EasingCoefficients{ 1.0f,  0.0f,  0.0f };
+		case Easing::EaseIn:	return EasingCoefficients{ 0.0f,  1.0f,  0.0f };
+		case Easing::EaseOut:	return EasingCoefficients{ 2.0f, -1.0f,  0.0f };
+		case Easing::EaseInOut:	return EasingCoefficients{ 0.0f,  3.0f, -2.0f };
+		default:				return EasingCoefficients{ 1.0f,  0.0f,  0.0f };
+	}
+}
+
+} // namespace
+
+Animator::Animator()
+	: _epoch{ Clock::now() }
+{
+}
+
+float Animator::Now() const
+{
+	return std::chrono::duration<float>( Clock::now() - _epoch ).count();
+}
+
+float Animator::StartTime()
+{
+	if ( _targets.empty() )
+	{
+		// Rebase while idle so float precision does not degrade over a long session.
+		_epoch = Clock::now();
+		_lastUpdate = -k_FrameInterval;
+	}
+	return Now();
+}
+
+float Animator::GetTimeUntilNextFrame() const
+{
+	return std::max( 0.0f, _lastUpdate + k_FrameInterval - Now() );
+}
+
+AnimationId Animator::Animate( Window& window, float& target, float to, float duration, Easing easing )
+{
+	auto id = _nextId++;
+	AddChannel( id, window, target, to, StartTime(), duration, easing );
+	return id;
+}
+
+AnimationId Animator::Animate( Window& window, graphics::RectF& target, const graphics::RectF& to, float duration, Easing easing )
+{
+	auto id = _nextId++;
+	auto start = StartTime();
+	AddChannel( id, window, target.x, to.x, start, duration, easing );
+	AddChannel( id, window, target.y, to.y, start, duration, easing );
+	AddChannel( id, window, target.w, to.w, start, duration, easing );
+	AddChannel( id, window, target.h, to.h, start, duration, easing );
+	return id;
+}
+
+AnimationId Animator::Animate( Window& window, graphics::ColorF& target, const graphics::ColorF& to, float duration, Easing easing )
+{
+	auto id = _nextId++;
+	auto start = StartTime();
+	AddChannel( id, window, target.r, to.r, start, duration, easing );
+	AddChannel( id, window, target.g, to.g, start, duration, easing );
+	AddChannel( id, window, target.b, to.b, start, duration, easing );
+	AddChannel( id, window, target.a, to.a, start, duration, easing );
+	return id;
+}
+
+void Animator::AddChannel( AnimationId id, Window& window, float& target, float to, float start, float duration, Easing easing )
+{
+	auto coefficients = CoefficientsFromEasing( easing );
+	auto invDuration = 1.0f / std::max( duration, 1.0e-4f );
+
+	auto it = _channelByTarget.find( &target );
+	if ( it != _channelByTarget.end() )
+	{
+		// Retarget the running animation from the current value.
+		auto index = it->second;
+		_from[ index ] = target;
+		_delta[ index ] = to - target;
+		_start[ index ] = start;
+		_invDuration[ index ] = invDuration;
+		_easeA[ index ] = coefficients.a;
+		_easeB[ index ] = coefficients.b;
+		_easeC[ index ] = coefficients.c;
+		_easing[ index ] = easing;
+		_windows[ index ] = &window;
+		_ids[ index ] = id;
+		return;
+	}
+
+	_channelByTarget.emplace( &target, _targets.size() );
+	_from.push_back( target );
+	_delta.push_back( to - target );
+	_start.push_back( start );
+	_invDuration.push_back( invDuration );
+	_easeA.push_back( coefficients.a );
+	_easeB.push_back( coefficients.b );
+	_easeC.push_back( coefficients.c );
+	_easing.push_back( easing );
+	_targets.push_back( &target );
+	_windows.push_back( &window );
+	_ids.push_back( id );
+}
+
+void Animator::RemoveChannel( size_t index )
+{
+	_channelByTarget.erase( _targets[ index ] );
+
+	auto removeAt = [index] ( auto& channels )
+	{
+		channels[ index ] = channels.back();
+		channels.pop_back();
+	};
+
+	removeAt( _from );
+	removeAt( _delta );
+	removeAt( _start );
+	removeAt( _invDuration );
+	removeAt( _easeA );
+	removeAt( _easeB );
+	removeAt( _easeC );
+	removeAt( _easing );
+	removeAt( _targets );
+	removeAt( _windows );
+	removeAt( _ids );
+
+	if ( index < _targets.size() )
+	{
+		_channelByTarget[ _targets[ index ] ] = index;
+	}
+}
+
+void Animator::Cancel( AnimationId id )
+{
+	for ( size_t i = _ids.size(); i-- > 0; )
+	{
+		if ( _ids[ i ] == id )
+		{
+			RemoveChannel( i );
+		}
+	}
+}
+
+void Animator::Cancel( const Window& window )
+{
+	for ( size_t i = _windows.size(); i-- > 0; )
+	{
+		if ( _windows[ i ] == &window )
+		{
+			RemoveChannel( i );
+		}
+	}
+}
+
+void Animator::Evaluate( float now )
+{
+	const size_t count = _targets.size();
+	_values.resize( count );
+
+	const float* from = _from.data();
+	const float* delta = _delta.data();
+	const float* start = _start.data();
+	const float* invDuration = _invDuration.data();
+	const float* easeA = _easeA.data();
+	const float* easeB = _easeB.data();
+	const float* easeC = _easeC.data();
+	float* values = _values.data();
+
+	size_t i = 0;
+
+#if defined(DIRECTUI_ANIMATION_SSE)
+	const __m128 vNow = _mm_set1_ps( now );
+	const __m128 vZero = _mm_setzero_ps();
+	const __m128 vOne = _mm_set1_ps( 1.0f );
+
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		__m128 t = _mm_mul_ps( _mm_sub_ps( vNow, _mm_loadu_ps( start + i ) ), _mm_loadu_ps( invDuration + i ) );
+		t = _mm_min_ps( _mm_max_ps( t, vZero ), vOne );
+
+		__m128 e = _mm_add_ps( _mm_loadu_ps( easeB + i ), _mm_mul_ps( t, _mm_loadu_ps( easeC + i ) ) );
+		e = _mm_add_ps( _mm_loadu_ps( easeA + i ), _mm_mul_ps( t, e ) );
+		e = _mm_mul_ps( t, e );
+
+		_mm_storeu_ps( values + i, _mm_add_ps( _mm_loadu_ps( from + i ), _mm_mul_ps( _mm_loadu_ps( delta + i ), e ) ) );
+	}
+#endif
+
+	for ( ; i < count; ++i )
+	{
+		float t = std::min( std::max( ( now - start[ i ] ) * invDuration[ i ], 0.0f ), 1.0f );
+		float e = t * ( easeA[ i ] + t * ( easeB[ i ] + t * easeC[ i ] ) );
+		values[ i ] = from[ i ] + delta[ i ] * e;
+	}
+}
+
+void Animator::Update()
+{
+	if ( !IsActive() )
+		return;
+
+	auto now = Now();
+	_lastUpdate = now;
+	Evaluate( now );
+
+	// Windows drawing on a render thread are skipped while they draw, their channels
+	// are written by a later update instead of blocking the UI thread.
+	_dirtyWindows.clear();
+	_written.assign( _targets.size(), 0 );
+	Window* lastWindow = nullptr;
+	std::unique_lock<std::mutex> lock;
+	for ( size_t i = 0; i < _targets.size(); ++i )
+	{
+		if ( _windows[ i ] != lastWindow )
+		{
+			lastWindow = _windows[ i ];
+			lock = lastWindow->TryLockDraw();
+			if ( lock.owns_lock() )
+				_dirtyWindows.push_back( lastWindow );
+		}
+
+		if ( lock.owns_lock() )
+		{
+			*_targets[ i ] = _values[ i ];
+			_written[ i ] = 1;
+		}
+	}
+	if ( lock.owns_lock() )
+		lock.unlock();
+
+	// Iterate backwards, removal moves the last channel into the removed slot.
+	for ( size_t i = _targets.size(); i-- > 0; )
+	{
+		if ( _written[ i ] && ( now - _start[ i ] ) * _invDuration[ i ] >= 1.0f )
+		{
+			RemoveChannel( i );
+		}
+	}
+
+	std::sort( _dirtyWindows.begin(), _dirtyWindows.end() );
+	_dirtyWindows.erase( std::unique( _dirtyWindows.begin(), _dirtyWindows.end() ), _dirtyWindows.end() );
+
+	for ( auto window : _dirtyWindows )
+	{
+		window->Redraw();
+	}
+}
+
+} // namespace directui
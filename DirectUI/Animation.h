@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Graphics.h"
+
+#include <vector> // for std::vector
+#include <unordered_map> // for std::unordered_map
+#include <chrono> // for std::chrono::steady_clock
+
+namespace directui
+{
+
+class Window;
+
+enum class Easing : uint8_t
+{
+	Linear,
+	EaseIn,
+	EaseOut,
+	EaseInOut
+};
+
+using AnimationId = uint64_t;
+
+// Animates bound float properties. Vector properties (RectF, ColorF) are split into one
+// float channel per component, every channel lives in structure-of-arrays storage and
+// all channels are evaluated together once per frame.
+class Animator
+{
+private:
+	using Clock = std::chrono::steady_clock;
+
+	Clock::time_point _epoch;
+	float _lastUpdate{ 0 };
+	AnimationId _nextId{ 1 };
+
+	// Hot data, evaluated in a single vectorized pass
+	std::vector<float> _from;
+	std::vector<float> _delta;
+	std::vector<float> _start;
+	std::vector<float> _invDuration;
+	std::vector<float> _easeA;
+	std::vector<float> _easeB;
+	std::vector<float> _easeC;
+	std::vector<float> _values;
+
+	// Per channel bindings
+	std::vector<Easing> _easing;
+	std::vector<float*> _targets;
+	std::vector<Window*> _windows;
+	std::vector<AnimationId> _ids;
+
+	std::unordered_map<float*, size_t> _channelByTarget;
+	std::vector<Window*> _dirtyWindows;
+	std::vector<uint8_t> _written;
+
+	float Now() const;
+	float StartTime();
+	void AddChannel( AnimationId id, Window& window, float& target, float to, float start, float duration, Easing easing );
+	void RemoveChannel( size_t index );
+	void Evaluate( float now );
+
+public:
+	static constexpr float k_FrameInterval = 1.0f / 60.0f;
+
+	Animator();
+
+	AnimationId Animate( Window& window, float& target, float to, float duration, Easing easing = Easing::EaseInOut );
+	AnimationId Animate( Window& window, graphics::RectF& target, const graphics::RectF& to, float duration, Easing easing = Easing::EaseInOut );
+	AnimationId Animate( Window& window, graphics::ColorF& target, const graphics::ColorF& to, float duration, Easing easing = Easing::EaseInOut );
+
+	void Cancel( AnimationId id );
+	void Cancel( const Window& window );
+
+	bool IsActive() const { return !_targets.empty(); }
+	size_t GetChannelCount() const { return _targets.size(); }
+	float GetTimeUntilNextFrame() const;
+
+	// Evaluates all animations, writes bound properties and invalidates affected windows.
+	void Update();
+};
+
+} // namespace directui
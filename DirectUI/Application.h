@@ -1,30 +1,89 @@
-#pragma once
-
-#include <memory> // for std::unique_ptr
-
-namespace graphics
-{
-class Device;
-}
-
-namespace directui
-{
-
-class Window;
-
-class Application
-{
-private:
-	class Impl;
-	std::unique_ptr<Impl> _impl;
-public:
-	Application();
-	~Application();
-
-	static Application*& Instance();
-
-	int Run( Window& window );
-	graphics::Device& GetDevice();
-};
-
-} // namespace directui
+#pragma once
+
+#include "TaskPool.h"
+#include "TimerWheel.h"
+
+#include <memory> // for std::unique_ptr
+#include <vector> // for std::vector
+#include <functional> // for std::function
+#include <chrono> // for std::chrono::steady_clock
+
+namespace graphics
+{
+class Device;
+struct StartupPhase;
+}
+
+namespace directui
+{
+
+class Window;
+class Animator;
+
+class Application
+{
+private:
+	friend class Window;
+
+	class Impl;
+	std::unique_ptr<Impl> _impl;
+
+	void RegisterWindow( Window& window );
+	void UnregisterWindow( Window& window );
+	void OnWindowDestroyed( Window& window );
+	void AddStartupPhase( const char* name, std::chrono::steady_clock::time_point begin );
+	void OnFramePresented();
+public:
+	Application();
+	~Application();
+
+	static Application*& Instance();
+
+	// Runs the message loop for all windows until the last main window is destroyed.
+	int Run();
+	// Runs the message loop for all windows until the given window is destroyed.
+	int Run( Window& window );
+
+	// Main windows created while enabled draw on their own render thread, see Window::LockDraw.
+	void SetRenderThreads( bool enabled );
+	bool GetRenderThreads() const;
+
+	const std::vector<Window*>& GetWindows() const;
+
+	graphics::Device& GetDevice();
+	Animator& GetAnimator();
+
+	// Phases from the constructor to the first presented frame: the application with the device
+	// and its parts, the first window, and the first frame, which spans all of them. Complete once
+	// a window presented a frame.
+	std::vector<graphics::StartupPhase> GetStartupPhases() const;
+
+	// Application-wide pool with one worker per hardware thread.
+	TaskPool& GetTaskPool();
+	// Runs callbacks on the message loop thread, also while a modal loop runs.
+	Dispatcher& GetUiDispatcher();
+
+	bool IsUiThread() const;
+
+	// Both run the callback on the message loop thread and can be called from any thread.
+	void PostDelayed( std::chrono::steady_clock::duration delay, std::function<void()> callback );
+	// Next frame callbacks are paced at the animation frame rate.
+	void PostNextFrame( std::function<void()> callback );
+
+	// Timers live in a timer wheel on the message loop thread, both calls are only valid there.
+	// Timers due within the same animation frame fire together. A non-zero period repeats the timer.
+	TimerId StartTimer( std::chrono::steady_clock::duration delay, std::function<void()> callback,
+		std::chrono::steady_clock::duration period = std::chrono::steady_clock::duration::zero() );
+	// Returns false when the timer already fired or was cancelled.
+	bool CancelTimer( TimerId id );
+
+	// Runs work on the task pool, continuations added with Task::ThenOnUi run on the message loop thread.
+	// Pass Window::GetCancellationToken to drop the work and its continuation with the window.
+	template< typename TWork >
+	auto RunAsync( TWork&& work, TaskPriority priority = TaskPriority::Normal, CancellationToken token = {} )
+	{
+		return directui::RunAsync( GetTaskPool(), GetUiDispatcher(), std::forward<TWork>( work ), priority, std::move( token ) );
+	}
+};
+
+} // namespace directui
@@ -1,92 +1,148 @@
-#pragma once
-
-namespace directui
-{
-
-using Handle = void*;
-
-class NamedBase
-{
-protected:
-	const char* _name;
-public:
-	NamedBase( const char* name ) : _name{ name } {}
-	virtual ~NamedBase() {}
-
-	template< typename TDerived >
-	TDerived* As()
-	{
-		if ( TDerived::Name() == _name )
-		{
-			return static_cast< TDerived* >( this );
-		}
-		return nullptr;
-	}
-
-	template< typename TDerived >
-	const TDerived* As() const
-	{
-		if ( TDerived::Name() == _name )
-		{
-			return static_cast< const TDerived* >( this );
-		}
-		return nullptr;
-	}
-};
-
-struct PointPx
-{
-	int x, y;
-	PointPx() : x{ 0 }, y{ 0 } {}
-	PointPx( int x, int y ) : x{ x }, y{ y } {}
-};
-
-struct SizePx
-{
-	int w, h;
-	SizePx() : w{ 0 }, h{ 0 } {}
-	SizePx( int w, int h ) : w{ w }, h{ h } {}
-};
-
-struct RectPx
-{
-	int x, y, w, h;
-	RectPx() : x{ 0 }, y{ 0 }, w{ 0 }, h{ 0 } {}
-	RectPx( int x, int y, int w, int h ) : x{ x }, y{ y }, w{ w }, h{ h } {}
-};
-
-} // namespace directui
-
-namespace graphics
-{
-
-struct PointF
-{
-	float x, y;
-	PointF() : x{ 0 }, y{ 0 } {}
-	PointF( float x, float y ) : x{ x }, y{ y } {}
-};
-
-struct SizeF
-{
-	float w, h;
-	SizeF() : w{ 0 }, h{ 0 } {}
-	SizeF( float w, float h ) : w{ w }, h{ h } {}
-};
-
-struct RectF
-{
-	float x, y, w, h;
-	RectF() : x{ 0 }, y{ 0 }, w{ 0 }, h{ 0 } {}
-	RectF( float x, float y, float w, float h ) : x{ x }, y{ y }, w{ w }, h{ h } {}
-
-	bool HasPoint( const PointF& point ) const
-	{
-		return
-			point.x >= x && point.x <= x + w &&
-			point.y >= y && point.y <= y + h;
-	}
-};
-
-} // namespace graphics
-
+#pragma once
+
+namespace directui
+{
+
+using Handle = void*;
+
+class NamedBase
+{
+protected:
+	const char* _name;
+public:
+	NamedBase( const char* name ) : _name{ name } {}
+	virtual ~NamedBase() {}
+
+	template< typename TDerived >
+	TDerived* As()
+	{
+		if ( TDerived::Name() == _name )
+		{
+			return static_cast< TDerived* >( this );
+		}
+		return nullptr;
+	}
+
+	template< typename TDerived >
+	const TDerived* As() const
+	{
+		if ( TDerived::Name() == _name )
+		{
+			return static_cast< const TDerived* >( this );
+		}
+		return nullptr;
+	}
+};
+
+struct PointPx
+{
+	int x, y;
+	PointPx() : x{ 0 }, y{ 0 } {}
+	PointPx( int x, int y ) : x{ x }, y{ y } {}
+};
+
+struct SizePx
+{
+	int w, h;
+	SizePx() : w{ 0 }, h{ 0 } {}
+	SizePx( int w, int h ) : w{ w }, h{ h } {}
+};
+
+struct RectPx
+{
+	int x, y, w, h;
+	RectPx() : x{ 0 }, y{ 0 }, w{ 0 }, h{ 0 } {}
+	RectPx( int x, int y, int w, int h ) : x{ x }, y{ y }, w{ w }, h{ h } {}
+};
+
+} // namespace directui
+
+namespace graphics
+{
+
+struct PointF
+{
+	float x, y;
+	PointF() : x{ 0 }, y{ 0 } {}
+	PointF( float x, float y ) : x{ x }, y{ y } {}
+};
+
+struct SizeF
+{
+	float w, h;
+	SizeF() : w{ 0 }, h{ 0 } {}
+	SizeF( float w, float h ) : w{ w }, h{ h } {}
+};
+
+struct RectF
+{
+	float x, y, w, h;
+	RectF() : x{ 0 }, y{ 0 }, w{ 0 }, h{ 0 } {}
+	RectF( float x, float y, float w, float h ) : x{ x }, y{ y }, w{ w }, h{ h } {}
+
+	bool HasPoint( const PointF& point ) const
+	{
+		return
+			point.x >= x && point.x <= x + w &&
+			point.y >= y && point.y <= y + h;
+	}
+};
+
+struct Matrix3x2F
+{
+	float m11, m12, m21, m22, dx, dy;
+	Matrix3x2F() : m11{ 1 }, m12{ 0 }, m21{ 0 }, m22{ 1 }, dx{ 0 }, dy{ 0 } {}
+	Matrix3x2F( float m11, float m12, float m21, float m22, float dx, float dy )
+		: m11{ m11 }, m12{ m12 }, m21{ m21 }, m22{ m22 }, dx{ dx }, dy{ dy }
+	{}
+
+	static Matrix3x2F Identity() { return Matrix3x2F{}; }
+	static Matrix3x2F Translation( float x, float y ) { return Matrix3x2F{ 1, 0, 0, 1, x, y }; }
+	static Matrix3x2F Scale( float sx, float sy ) { return Matrix3x2F{ sx, 0, 0, sy, 0, 0 }; }
+
+	bool IsIdentity() const
+	{
+		return m11 == 1 && m12 == 0 && m21 == 0 && m22 == 1 && dx == 0 && dy == 0;
+	}
+
+	// Returns false and keeps the matrix unchanged when it is singular.
+	bool Invert()
+	{
+		float determinant = m11 * m22 - m12 * m21;
+		if ( determinant == 0 )
+			return false;
+
+		float inverse = 1.0f / determinant;
+		*this = Matrix3x2F
+		{
+			m22 * inverse,
+			-m12 * inverse,
+			-m21 * inverse,
+			m11 * inverse,
+			( m21 * dy - m22 * dx ) * inverse,
+			( m12 * dx - m11 * dy ) * inverse
+		};
+		return true;
+	}
+
+	PointF TransformPoint( const PointF& point ) const
+	{
+		return PointF{ point.x * m11 + point.y * m21 + dx, point.x * m12 + point.y * m22 + dy };
+	}
+
+	Matrix3x2F operator*( const Matrix3x2F& other ) const
+	{
+		return Matrix3x2F
+		{
+			m11 * other.m11 + m12 * other.m21,
+			m11 * other.m12 + m12 * other.m22,
+			m21 * other.m11 + m22 * other.m21,
+			m21 * other.m12 + m22 * other.m22,
+			dx * other.m11 + dy * other.m21 + other.dx,
+			dx * other.m12 + dy * other.m22 + other.dy,
+		};
+	}
+};
+
+} // namespace graphics
+
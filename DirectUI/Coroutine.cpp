@@ -0,0 +1,105 @@
+#include "Coroutine.h"
+#include "Application.h"
+
+#include <mutex>
+#include <new>
+
+namespace directui
+{
+
+namespace
+{
+
+constexpr size_t k_FrameGranularity = 128;
+constexpr size_t k_FrameSizeClasses = 16; // pooled frames up to 2 KB
+
+struct FreeFrame
+{
+	FreeFrame* next;
+};
+
+struct FrameSizeClass
+{
+	std::mutex mutex;
+	FreeFrame* free{ nullptr };
+};
+
+FrameSizeClass& SizeClass( size_t index )
+{
+	static FrameSizeClass s_classes[ k_FrameSizeClasses ];
+	return s_classes[ index ];
+}
+
+size_t SizeClassIndex( size_t size )
+{
+	return ( size + k_FrameGranularity - 1 ) / k_FrameGranularity - 1;
+}
+
+} // namespace
+
+void* AllocateCoroutineFrame( size_t size )
+{
+	auto index = SizeClassIndex( size );
+	if ( index >= k_FrameSizeClasses )
+		return ::operator new( size );
+
+	auto& sizeClass = SizeClass( index );
+	{
+		std::lock_guard<std::mutex> lock{ sizeClass.mutex };
+		if ( auto frame = sizeClass.free )
+		{
+			sizeClass.free = frame->next;
+			return frame;
+		}
+	}
+	return ::operator new( ( index + 1 ) * k_FrameGranularity );
+}
+
+void FreeCoroutineFrame( void* frame, size_t size )
+{
+	auto index = SizeClassIndex( size );
+	if ( index >= k_FrameSizeClasses )
+	{
+		::operator delete( frame );
+		return;
+	}
+
+	// Frames are kept for reuse, the pool only grows to the peak number of live coroutines.
+	auto& sizeClass = SizeClass( index );
+	std::lock_guard<std::mutex> lock{ sizeClass.mutex };
+	auto node = static_cast< FreeFrame* >( frame );
+	node->next = sizeClass.free;
+	sizeClass.free = node;
+}
+
+void PostCoroutineException( std::exception_ptr error )
+{
+	Application::Instance()->GetUiDispatcher().Post( [error] { std::rethrow_exception( error ); } );
+}
+
+bool UiThreadAwaiter::await_ready() const
+{
+	return Application::Instance()->IsUiThread();
+}
+
+void UiThreadAwaiter::await_suspend( std::coroutine_handle<> handle ) const
+{
+	Application::Instance()->GetUiDispatcher().Post( [handle] { handle.resume(); } );
+}
+
+void BackgroundAwaiter::await_suspend( std::coroutine_handle<> handle ) const
+{
+	Application::Instance()->GetTaskPool().Submit( [handle] { handle.resume(); }, priority );
+}
+
+void DelayAwaiter::await_suspend( std::coroutine_handle<> handle ) const
+{
+	Application::Instance()->PostDelayed( delay, [handle] { handle.resume(); } );
+}
+
+void NextFrameAwaiter::await_suspend( std::coroutine_handle<> handle ) const
+{
+	Application::Instance()->PostNextFrame( [handle] { handle.resume(); } );
+}
+
+} // namespace directui
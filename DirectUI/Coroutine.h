@@ -0,0 +1,80 @@
+#pragma once
+
+#include "TaskPool.h"
+
+#include <coroutine> // for std::coroutine_handle, std::suspend_never
+#include <chrono> // for std::chrono::milliseconds
+#include <exception> // for std::exception_ptr
+
+namespace directui
+{
+
+// Coroutine frames come from per size class free lists instead of the heap, frames
+// freed on any thread are reused by the next coroutine of the same size class.
+void* AllocateCoroutineFrame( size_t size );
+void FreeCoroutineFrame( void* frame, size_t size );
+
+// Rethrows the exception on the message loop thread, from Application::Run.
+void PostCoroutineException( std::exception_ptr error );
+
+// Fire-and-forget coroutine for UI code. It starts running on the calling thread and
+// frees its frame when it finishes. Nobody waits for it, so an exception escaping it is
+// posted to the message loop, on whatever thread resumed it last.
+class Coroutine
+{
+public:
+	struct promise_type
+	{
+		Coroutine get_return_object() { return Coroutine{}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { PostCoroutineException( std::current_exception() ); }
+
+		static void* operator new( size_t size ) { return AllocateCoroutineFrame( size ); }
+		static void operator delete( void* frame, size_t size ) { FreeCoroutineFrame( frame, size ); }
+	};
+};
+
+struct UiThreadAwaiter
+{
+	bool await_ready() const;
+	void await_suspend( std::coroutine_handle<> handle ) const;
+	void await_resume() const {}
+};
+
+struct BackgroundAwaiter
+{
+	TaskPriority priority;
+
+	bool await_ready() const { return false; }
+	void await_suspend( std::coroutine_handle<> handle ) const;
+	void await_resume() const {}
+};
+
+struct DelayAwaiter
+{
+	std::chrono::milliseconds delay;
+
+	bool await_ready() const { return false; }
+	void await_suspend( std::coroutine_handle<> handle ) const;
+	void await_resume() const {}
+};
+
+struct NextFrameAwaiter
+{
+	bool await_ready() const { return false; }
+	void await_suspend( std::coroutine_handle<> handle ) const;
+	void await_resume() const {}
+};
+
+// Continues on the message loop thread, right away when already there.
+inline UiThreadAwaiter UiThread() { return UiThreadAwaiter{}; }
+// Continues on the application task pool.
+inline BackgroundAwaiter Background( TaskPriority priority = TaskPriority::Normal ) { return BackgroundAwaiter{ priority }; }
+// Continues on the message loop thread once the delay elapsed.
+inline DelayAwaiter Delay( std::chrono::milliseconds delay ) { return DelayAwaiter{ delay }; }
+// Continues on the message loop thread with the next frame.
+inline NextFrameAwaiter NextFrame() { return NextFrameAwaiter{}; }
+
+} // namespace directui
@@ -0,0 +1,1110 @@
+#include "CpuGraphics.h"
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace graphics::cpu
+{
+
+namespace
+{
+
+constexpr int k_TileSize = 64;
+// Earlier commands of a tile checked against an opaque command that covers only part of it.
+constexpr size_t k_OcclusionDepth = 8;
+
+// Placeholder glyph metrics in ems, shared by MeasureText and DrawTextLayout.
+constexpr float k_GlyphAdvance = 0.5f;
+constexpr float k_LineHeight = 1.2f;
+
+struct RectI
+{
+	int left, top, right, bottom;
+
+	bool IsEmpty() const { return left >= right || top >= bottom; }
+	bool Contains( const RectI& other ) const
+	{
+		return other.left >= left && other.top >= top && other.right <= right && other.bottom <= bottom;
+	}
+};
+
+RectI Intersect( const RectI& a, const RectI& b )
+{
+	return RectI{ std::max( a.left, b.left ), std::max( a.top, b.top ), std::min( a.right, b.right ), std::min( a.bottom, b.bottom ) };
+}
+
+// Pixels are 32-bit BGRA with premultiplied alpha, the same layout as the DX readback.
+uint32_t PremultipliedFromColor( const ColorF& color )
+{
+	float a = std::min( std::max( color.a, 0.0f ), 1.0f );
+	auto channel = [a] ( float c ) { return static_cast< uint32_t >( std::min( std::max( c, 0.0f ), 1.0f ) * a * 255.0f + 0.5f ); };
+	return ( static_cast< uint32_t >( a * 255.0f + 0.5f ) << 24 ) | ( channel( color.r ) << 16 ) | ( channel( color.g ) << 8 ) | channel( color.b );
+}
+
+// Multiplies all four channels by scale / 255, two channels at a time.
+inline uint32_t ScalePixel( uint32_t pixel, uint32_t scale )
+{
+	uint32_t rb = ( pixel & 0x00FF00FF ) * scale + 0x00800080;
+	rb = ( ( rb + ( ( rb >> 8 ) & 0x00FF00FF ) ) >> 8 ) & 0x00FF00FF;
+	uint32_t ag = ( ( pixel >> 8 ) & 0x00FF00FF ) * scale + 0x00800080;
+	ag = ( ag + ( ( ag >> 8 ) & 0x00FF00FF ) ) & 0xFF00FF00;
+	return rb | ag;
+}
+
+inline uint32_t BlendOver( uint32_t destination, uint32_t source )
+{
+	return source + ScalePixel( destination, 255 - ( source >> 24 ) );
+}
+
+// Fraction of the pixel [p, p + 1) covered by the span [begin, end).
+inline float Coverage( int p, float begin, float end )
+{
+	return std::min( std::max( std::min( p + 1.0f, end ) - std::max( static_cast< float >( p ), begin ), 0.0f ), 1.0f );
+}
+
+struct Surface
+{
+	int width{ 0 };
+	int height{ 0 };
+	std::vector<uint32_t> pixels;
+
+	void Resize( int w, int h )
+	{
+		if ( w == width && h == height )
+			return;
+		width = w;
+		height = h;
+		pixels.assign( static_cast< size_t >( w ) * h, 0 );
+	}
+
+	RectI GetBounds() const { return RectI{ 0, 0, width, height }; }
+};
+
+// Colors of a gradient at evenly spaced positions, shared by brushes with equal stops.
+struct GradientRamp
+{
+	static constexpr size_t k_Size = 256;
+
+	uint32_t colors[ k_Size ];
+	ResourceCharge charge;
+};
+
+GradientRamp* CreateGradientRamp( const GradientStops& stops, ResourceTracker& resources )
+{
+	std::unique_ptr<GradientRamp> ramp{ new GradientRamp{} };
+
+	auto sorted = stops.stops;
+	std::stable_sort( sorted.begin(), sorted.end(), [] ( const GradientStop& a, const GradientStop& b ) { return a.position < b.position; } );
+
+	// Interpolated with straight alpha, then premultiplied.
+	size_t next = 0;
+	for ( size_t i = 0; i < GradientRamp::k_Size; ++i )
+	{
+		auto position = static_cast< float >( i ) / ( GradientRamp::k_Size - 1 );
+		while ( next < sorted.size() && sorted[ next ].position < position )
+		{
+			next++;
+		}
+
+		ColorF color;
+		if ( sorted.empty() )
+			color = ColorF{};
+		else if ( next == 0 )
+			color = sorted.front().color;
+		else if ( next == sorted.size() )
+			color = sorted.back().color;
+		else
+		{
+			const auto& a = sorted[ next - 1 ];
+			const auto& b = sorted[ next ];
+			auto span = b.position - a.position;
+			auto t = span > 0 ? ( position - a.position ) / span : 1.0f;
+			color = ColorF{
+				a.color.r + ( b.color.r - a.color.r ) * t,
+				a.color.g + ( b.color.g - a.color.g ) * t,
+				a.color.b + ( b.color.b - a.color.b ) * t,
+				a.color.a + ( b.color.a - a.color.a ) * t };
+		}
+		ramp->colors[ i ] = PremultipliedFromColor( color );
+	}
+
+	ramp->charge = ResourceCharge{ resources, ResourceType::Brush, sizeof( ramp->colors ) };
+	return ramp.release();
+}
+
+// Gradient of one fill, allocated in the frame arena. Holds the ramp until the frame is rasterized,
+// even when the brush changes its stops before that.
+struct GradientFill
+{
+	std::shared_ptr<const GradientRamp> ramp;
+	GradientType type;
+	GradientExtend extend;
+	Matrix3x2F inverse; // device pixel to brush space
+	PointF origin; // start of linear gradients, center of radial ones
+	PointF axis; // linear: direction divided by squared length, radial: inverse radii
+};
+
+enum class CommandType : uint8_t
+{
+	Fill,
+	Copy,
+	Composite,
+	Gradient
+};
+
+struct Command
+{
+	CommandType type;
+	uint32_t color;
+	uint32_t opacity;
+	RectF rect; // device pixels, edges are antialiased
+	RectI bounds; // pixels touched, already clipped
+	const Surface* source;
+	const GradientFill* gradient;
+	Matrix3x2F inverse; // destination pixel to source pixel
+
+	// Pixels the command overwrites regardless of what is under them: all of a copy, the
+	// fully covered pixels of an opaque solid fill.
+	RectI GetOpaqueBounds() const
+	{
+		if ( type == CommandType::Copy )
+			return bounds;
+		if ( type != CommandType::Fill || ( color >> 24 ) != 255 )
+			return RectI{};
+
+		RectI inner{
+			static_cast< int >( std::ceil( rect.x ) ), static_cast< int >( std::ceil( rect.y ) ),
+			static_cast< int >( std::floor( rect.x + rect.w ) ), static_cast< int >( std::floor( rect.y + rect.h ) ) };
+		return Intersect( inner, bounds );
+	}
+};
+
+// Commands recorded for one surface, the frame or a layer being recorded. Commands hidden
+// under later opaque ones are dropped from the tiles where they are hidden, so overdraw of
+// stacked backgrounds is not rasterized.
+struct Target
+{
+	Surface* surface{ nullptr };
+	Matrix3x2F transform; // DIPs to device pixels
+	int tilesX{ 0 };
+	int tilesY{ 0 };
+	std::vector<Command> commands;
+	std::vector<std::vector<uint32_t>> bins;
+	std::vector<RectI> clips;
+
+	void Begin( Surface& target, const Matrix3x2F& toPixels )
+	{
+		surface = &target;
+		transform = toPixels;
+		tilesX = ( target.width + k_TileSize - 1 ) / k_TileSize;
+		tilesY = ( target.height + k_TileSize - 1 ) / k_TileSize;
+		commands.clear();
+		clips.clear();
+		clips.push_back( target.GetBounds() );
+
+		// Bins keep their capacity between frames.
+		size_t tileCount = static_cast< size_t >( tilesX ) * tilesY;
+		if ( bins.size() < tileCount )
+			bins.resize( tileCount );
+		for ( size_t i = 0; i < tileCount; ++i )
+		{
+			bins[ i ].clear();
+		}
+	}
+
+	RectI GetTileRect( int tx, int ty ) const
+	{
+		return RectI{ tx * k_TileSize, ty * k_TileSize,
+			std::min( surface->width, ( tx + 1 ) * k_TileSize ), std::min( surface->height, ( ty + 1 ) * k_TileSize ) };
+	}
+
+	// Removes commands of the bin whose pixels in the tile are all inside the opaque area.
+	// Covering the whole tile drops everything, otherwise only the most recent commands are
+	// checked so recording stays linear in the number of commands.
+	void Occlude( std::vector<uint32_t>& bin, const RectI& opaque, const RectI& tileRect )
+	{
+		if ( opaque.Contains( tileRect ) )
+		{
+			bin.clear();
+			return;
+		}
+
+		auto first = bin.end() - std::min( bin.size(), k_OcclusionDepth );
+		bin.erase( std::remove_if( first, bin.end(), [&] ( uint32_t index ) {
+			return opaque.Contains( Intersect( commands[ index ].bounds, tileRect ) );
+		} ), bin.end() );
+	}
+
+	void Record( const Command& command )
+	{
+		if ( command.bounds.IsEmpty() )
+			return;
+
+		auto index = static_cast< uint32_t >( commands.size() );
+		commands.push_back( command );
+
+		auto opaque = command.GetOpaqueBounds();
+		int tileLeft = command.bounds.left / k_TileSize;
+		int tileRight = ( command.bounds.right - 1 ) / k_TileSize;
+		int tileTop = command.bounds.top / k_TileSize;
+		int tileBottom = ( command.bounds.bottom - 1 ) / k_TileSize;
+		for ( int ty = tileTop; ty <= tileBottom; ++ty )
+		{
+			for ( int tx = tileLeft; tx <= tileRight; ++tx )
+			{
+				auto& bin = bins[ static_cast< size_t >( ty ) * tilesX + tx ];
+				if ( !bin.empty() && !opaque.IsEmpty() )
+				{
+					auto tileRect = GetTileRect( tx, ty );
+					auto tileOpaque = Intersect( opaque, tileRect );
+					if ( !tileOpaque.IsEmpty() )
+						Occlude( bin, tileOpaque, tileRect );
+				}
+				bin.push_back( index );
+			}
+		}
+	}
+};
+
+void FillTile( Surface& surface, const Command& command, const RectI& area )
+{
+	const auto& rect = command.rect;
+	const float right = rect.x + rect.w;
+	const float bottom = rect.y + rect.h;
+
+	// Columns in [innerLeft, innerRight) are fully covered horizontally.
+	int innerLeft = std::max( area.left, static_cast< int >( std::ceil( rect.x ) ) );
+	int innerRight = std::max( innerLeft, std::min( area.right, static_cast< int >( std::floor( right ) ) ) );
+	bool opaque = ( command.color >> 24 ) == 255;
+
+	for ( int y = area.top; y < area.bottom; ++y )
+	{
+		auto row = surface.pixels.data() + static_cast< size_t >( y ) * surface.width;
+		float coverageY = Coverage( y, rect.y, bottom );
+
+		auto blend = [&] ( int x, float coverage ) {
+			auto scale = static_cast< uint32_t >( coverage * 255.0f + 0.5f );
+			if ( scale == 255 && opaque )
+				row[ x ] = command.color;
+			else if ( scale > 0 )
+				row[ x ] = BlendOver( row[ x ], ScalePixel( command.color, scale ) );
+		};
+
+		for ( int x = area.left; x < std::min( innerLeft, area.right ); ++x )
+		{
+			blend( x, Coverage( x, rect.x, right ) * coverageY );
+		}
+
+		if ( coverageY == 1.0f && opaque )
+		{
+			std::fill( row + innerLeft, row + innerRight, command.color );
+		}
+		else
+		{
+			auto source = ScalePixel( command.color, static_cast< uint32_t >( coverageY * 255.0f + 0.5f ) );
+			for ( int x = innerLeft; x < innerRight; ++x )
+			{
+				row[ x ] = BlendOver( row[ x ], source );
+			}
+		}
+
+		for ( int x = std::max( innerRight, area.left ); x < area.right; ++x )
+		{
+			blend( x, Coverage( x, rect.x, right ) * coverageY );
+		}
+	}
+}
+
+inline float ExtendGradient( float t, GradientExtend extend )
+{
+	switch ( extend )
+	{
+		case GradientExtend::Repeat: return t - std::floor( t );
+		case GradientExtend::Mirror:
+		{
+			auto m = t - 2.0f * std::floor( t * 0.5f );
+			return m > 1.0f ? 2.0f - m : m;
+		}
+		default: return std::min( std::max( t, 0.0f ), 1.0f );
+	}
+}
+
+void GradientTile( Surface& surface, const Command& command, const RectI& area )
+{
+	const auto& rect = command.rect;
+	const auto& fill = *command.gradient;
+	const float right = rect.x + rect.w;
+	const float bottom = rect.y + rect.h;
+
+	for ( int y = area.top; y < area.bottom; ++y )
+	{
+		auto row = surface.pixels.data() + static_cast< size_t >( y ) * surface.width;
+		float coverageY = Coverage( y, rect.y, bottom );
+		for ( int x = area.left; x < area.right; ++x )
+		{
+			auto scale = static_cast< uint32_t >( Coverage( x, rect.x, right ) * coverageY * 255.0f + 0.5f );
+			if ( scale == 0 )
+				continue;
+
+			auto point = fill.inverse.TransformPoint( PointF{ x + 0.5f, y + 0.5f } );
+			auto dx = point.x - fill.origin.x;
+			auto dy = point.y - fill.origin.y;
+			float t;
+			if ( fill.type == GradientType::Linear )
+			{
+				t = dx * fill.axis.x + dy * fill.axis.y;
+			}
+			else
+			{
+				dx *= fill.axis.x;
+				dy *= fill.axis.y;
+				t = std::sqrt( dx * dx + dy * dy );
+			}
+
+			auto index = static_cast< size_t >( ExtendGradient( t, fill.extend ) * ( GradientRamp::k_Size - 1 ) + 0.5f );
+			auto color = fill.ramp->colors[ index ];
+			if ( scale != 255 )
+				color = ScalePixel( color, scale );
+			row[ x ] = BlendOver( row[ x ], color );
+		}
+	}
+}
+
+void CopyTile( Surface& surface, const Command& command, const RectI& area )
+{
+	for ( int y = area.top; y < area.bottom; ++y )
+	{
+		auto row = surface.pixels.data() + static_cast< size_t >( y ) * surface.width;
+		std::fill( row + area.left, row + area.right, command.color );
+	}
+}
+
+// Bilinear sample of a premultiplied surface, transparent outside of it.
+inline uint32_t Sample( const Surface& source, float x, float y )
+{
+	x -= 0.5f;
+	y -= 0.5f;
+	int x0 = static_cast< int >( std::floor( x ) );
+	int y0 = static_cast< int >( std::floor( y ) );
+	auto wx = static_cast< uint32_t >( ( x - x0 ) * 256.0f );
+	auto wy = static_cast< uint32_t >( ( y - y0 ) * 256.0f );
+
+	auto at = [&source] ( int px, int py ) -> uint32_t {
+		if ( px < 0 || py < 0 || px >= source.width || py >= source.height )
+			return 0;
+		return source.pixels[ static_cast< size_t >( py ) * source.width + px ];
+	};
+
+	uint32_t p00 = at( x0, y0 ), p10 = at( x0 + 1, y0 ), p01 = at( x0, y0 + 1 ), p11 = at( x0 + 1, y0 + 1 );
+	uint32_t w00 = ( 256 - wx ) * ( 256 - wy ), w10 = wx * ( 256 - wy ), w01 = ( 256 - wx ) * wy, w11 = wx * wy;
+
+	uint32_t result = 0;
+	for ( int shift = 0; shift < 32; shift += 8 )
+	{
+		uint64_t sum =
+			static_cast< uint64_t >( ( p00 >> shift ) & 0xFF ) * w00 +
+			static_cast< uint64_t >( ( p10 >> shift ) & 0xFF ) * w10 +
+			static_cast< uint64_t >( ( p01 >> shift ) & 0xFF ) * w01 +
+			static_cast< uint64_t >( ( p11 >> shift ) & 0xFF ) * w11;
+		result |= static_cast< uint32_t >( ( sum + 0x8000 ) >> 16 ) << shift;
+	}
+	return result;
+}
+
+void CompositeTile( Surface& surface, const Command& command, const RectI& area )
+{
+	const auto& inverse = command.inverse;
+	for ( int y = area.top; y < area.bottom; ++y )
+	{
+		auto row = surface.pixels.data() + static_cast< size_t >( y ) * surface.width;
+		for ( int x = area.left; x < area.right; ++x )
+		{
+			auto point = inverse.TransformPoint( PointF{ x + 0.5f, y + 0.5f } );
+			auto pixel = Sample( *command.source, point.x, point.y );
+			if ( pixel == 0 )
+				continue;
+			if ( command.opacity != 255 )
+				pixel = ScalePixel( pixel, command.opacity );
+			row[ x ] = BlendOver( row[ x ], pixel );
+		}
+	}
+}
+
+void RasterizeTile( Target& target, size_t tile )
+{
+	auto& surface = *target.surface;
+	auto tileRect = target.GetTileRect( static_cast< int >( tile % target.tilesX ), static_cast< int >( tile / target.tilesX ) );
+
+	for ( auto index : target.bins[ tile ] )
+	{
+		const auto& command = target.commands[ index ];
+		auto area = Intersect( command.bounds, tileRect );
+		switch ( command.type )
+		{
+			case CommandType::Fill: FillTile( surface, command, area ); break;
+			case CommandType::Copy: CopyTile( surface, command, area ); break;
+			case CommandType::Composite: CompositeTile( surface, command, area ); break;
+			case CommandType::Gradient: GradientTile( surface, command, area ); break;
+		}
+	}
+}
+
+} // namespace
+
+class Brush : public graphics::Brush
+{
+private:
+	uint32_t _color;
+public:
+	static const char* Name() { return "CpuBrush"; }
+
+	Brush( const ColorF& color ) : graphics::Brush{ Name() }, _color{ PremultipliedFromColor( color ) } {}
+
+	uint32_t GetColor() const { return _color; }
+};
+
+class GradientBrush : public graphics::GradientBrush
+{
+private:
+	GradientCache<GradientRamp>& _cache;
+	ResourceTracker& _resources;
+	std::shared_ptr<const GradientRamp> _ramp;
+
+protected:
+	// Geometry and transform are read when filling.
+	void OnGeometryChanged() override {}
+
+	void OnStopsChanged() override
+	{
+		_ramp = _cache.GetOrCreate( GetStops(), [this] ( const GradientStops& stops ) { return CreateGradientRamp( stops, _resources ); } );
+	}
+
+public:
+	static const char* Name() { return "CpuGradientBrush"; }
+
+	template< typename TGradient >
+	GradientBrush( GradientCache<GradientRamp>& cache, ResourceTracker& resources, const TGradient& gradient, const GradientStops& stops )
+		: graphics::GradientBrush{ Name(), gradient, stops }
+		, _cache{ cache }
+		, _resources{ resources }
+	{
+		OnStopsChanged();
+	}
+
+	const std::shared_ptr<const GradientRamp>& GetRamp() const { return _ramp; }
+};
+
+class TextFormat : public graphics::TextFormat
+{
+private:
+	float _height;
+public:
+	static const char* Name() { return "CpuTextFormat"; }
+
+	TextFormat( float height ) : graphics::TextFormat{ Name() }, _height{ height } {}
+
+	float GetHeight() const { return _height; }
+};
+
+class TextLayout : public graphics::TextLayout
+{
+private:
+	String _ownedText;
+	const wchar_t* _text;
+	size_t _length;
+	float _height;
+	SizeF _size;
+	TextAlignment _textAlignment{ TextAlignment::Leading };
+	ParagraphAlignment _paragraphAlignment{ ParagraphAlignment::Near };
+
+public:
+	static const char* Name() { return "CpuTextLayout"; }
+
+	// Frame layouts point to text copied into the frame arena.
+	TextLayout( const wchar_t* text, size_t length, float height, const SizeF& size )
+		: graphics::TextLayout{ Name() }
+		, _text{ text }
+		, _length{ length }
+		, _height{ height }
+		, _size{ size }
+	{}
+
+	TextLayout( String text, float height, const SizeF& size )
+		: graphics::TextLayout{ Name() }
+		, _ownedText{ std::move( text ) }
+		, _text{ _ownedText.c_str() }
+		, _length{ _ownedText.length() }
+		, _height{ height }
+		, _size{ size }
+	{}
+
+	void SetTextAlignment( TextAlignment alignment ) override { _textAlignment = alignment; }
+	void SetParagraphAlignment( ParagraphAlignment alignment ) override { _paragraphAlignment = alignment; }
+
+	const wchar_t* GetText() const { return _text; }
+	size_t GetLength() const { return _length; }
+	float GetHeight() const { return _height; }
+	const SizeF& GetSize() const { return _size; }
+	TextAlignment GetTextAlignment() const { return _textAlignment; }
+	ParagraphAlignment GetParagraphAlignment() const { return _paragraphAlignment; }
+};
+
+class DeviceContext final : public graphics::DeviceContext
+{
+private:
+	directui::TaskPool& _pool;
+
+	Surface _surface;
+	ResourceCharge _surfaceCharge;
+	float _dpi{ 96.0f };
+	ReadbackId _nextReadbackId{ 1 };
+	uint64_t _frameNumber{ 0 };
+
+	// Recording targets reused between frames, the first one is the frame itself
+	std::vector<std::unique_ptr<Target>> _targets;
+	size_t _targetDepth{ 0 };
+
+	struct Layer
+	{
+		Surface surface;
+		ResourceCharge charge;
+		RectF bounds;
+		bool valid{ false };
+		uint64_t lastUsedFrame{ 0 };
+	};
+
+	struct LayerScope
+	{
+		LayerKey key;
+		bool recording;
+	};
+
+	std::unordered_map<LayerKey, Layer, LayerKeyHash> _layers;
+	std::vector<DpiBucket> _layerDpis; // every bucket in _layers, for InvalidateLayer
+	std::vector<LayerScope> _layerStack;
+
+	float GetScale() const { return _dpi / 96.0f; }
+
+	Target& CurrentTarget() { return *_targets[ _targetDepth - 1 ]; }
+
+	Target& PushTarget( Surface& surface, const Matrix3x2F& transform )
+	{
+		if ( _targetDepth == _targets.size() )
+			_targets.emplace_back( new Target{} );
+
+		auto& target = *_targets[ _targetDepth++ ];
+		target.Begin( surface, transform );
+		return target;
+	}
+
+	void Rasterize( Target& target )
+	{
+		_pool.ParallelFor( static_cast< size_t >( target.tilesX ) * target.tilesY, [&target] ( size_t tile ) {
+			RasterizeTile( target, tile );
+		} );
+	}
+
+	// Bounding box of a rect in device pixels, exact while transforms keep rects axis-aligned.
+	static RectF TransformRect( const Matrix3x2F& transform, const RectF& rect )
+	{
+		PointF corners[] =
+		{
+			transform.TransformPoint( PointF{ rect.x, rect.y } ),
+			transform.TransformPoint( PointF{ rect.x + rect.w, rect.y } ),
+			transform.TransformPoint( PointF{ rect.x, rect.y + rect.h } ),
+			transform.TransformPoint( PointF{ rect.x + rect.w, rect.y + rect.h } )
+		};
+
+		float left = corners[ 0 ].x, top = corners[ 0 ].y, right = left, bottom = top;
+		for ( const auto& corner : corners )
+		{
+			left = std::min( left, corner.x );
+			top = std::min( top, corner.y );
+			right = std::max( right, corner.x );
+			bottom = std::max( bottom, corner.y );
+		}
+		return RectF{ left, top, right - left, bottom - top };
+	}
+
+	static RectI OuterPixels( const RectF& rect )
+	{
+		return RectI{
+			static_cast< int >( std::floor( rect.x ) ), static_cast< int >( std::floor( rect.y ) ),
+			static_cast< int >( std::ceil( rect.x + rect.w ) ), static_cast< int >( std::ceil( rect.y + rect.h ) ) };
+	}
+
+	// A solid color, or a gradient when gradient is set.
+	struct Paint
+	{
+		uint32_t color;
+		const GradientFill* gradient;
+	};
+
+	void Fill( const Paint& paint, const RectF& rect )
+	{
+		if ( ( paint.color == 0 && paint.gradient == nullptr ) || rect.w <= 0 || rect.h <= 0 )
+			return;
+
+		auto& target = CurrentTarget();
+		Command command{};
+		command.type = paint.gradient != nullptr ? CommandType::Gradient : CommandType::Fill;
+		command.color = paint.color;
+		command.gradient = paint.gradient;
+		command.rect = TransformRect( target.transform, rect );
+		command.bounds = Intersect( OuterPixels( command.rect ), target.clips.back() );
+		target.Record( command );
+	}
+
+	static uint64_t SurfaceBytes( const Surface& surface )
+	{
+		return static_cast< uint64_t >( surface.width ) * surface.height * 4;
+	}
+
+	// Evicts layers not drawn in the last frame, least recently used first.
+	void TrimCaches()
+	{
+		uint64_t cacheBytes = 0;
+		for ( const auto& entry : _layers )
+		{
+			cacheBytes += entry.second.charge.GetBytes();
+		}
+
+		if ( !IsOverBudget( cacheBytes ) )
+			return;
+
+		std::vector<std::pair<uint64_t, LayerKey>> unused;
+		for ( const auto& entry : _layers )
+		{
+			if ( entry.second.lastUsedFrame + 1 < _frameNumber )
+				unused.emplace_back( entry.second.lastUsedFrame, entry.first );
+		}
+		std::sort( unused.begin(), unused.end(), [] ( const auto& a, const auto& b ) { return a.first < b.first; } );
+
+		for ( const auto& candidate : unused )
+		{
+			if ( !IsOverBudget( cacheBytes ) )
+				break;
+
+			auto it = _layers.find( candidate.second );
+			cacheBytes -= it->second.charge.GetBytes();
+			_layers.erase( it );
+		}
+	}
+
+	// The stroke is centered on the outline, split into four rects that do not overlap.
+	void Stroke( const Paint& paint, const RectF& rect, float strokeWidth )
+	{
+		auto half = strokeWidth * 0.5f;
+		Fill( paint, RectF{ rect.x - half, rect.y - half, rect.w + strokeWidth, strokeWidth } );
+		Fill( paint, RectF{ rect.x - half, rect.y + rect.h - half, rect.w + strokeWidth, strokeWidth } );
+		Fill( paint, RectF{ rect.x - half, rect.y + half, strokeWidth, rect.h - strokeWidth } );
+		Fill( paint, RectF{ rect.x + rect.w - half, rect.y + half, strokeWidth, rect.h - strokeWidth } );
+	}
+
+	Paint GetPaint( graphics::Brush& brush )
+	{
+		if ( auto pBrush = brush.As<Brush>() )
+			return Paint{ pBrush->GetColor(), nullptr };
+
+		auto pGradientBrush = brush.As<GradientBrush>();
+		if ( pGradientBrush == nullptr )
+			return Paint{ 0, nullptr };
+
+		auto toPixels = pGradientBrush->GetTransform() * CurrentTarget().transform;
+		if ( !toPixels.Invert() )
+			return Paint{ 0, nullptr };
+
+		auto fill = _frameArena.New<GradientFill>();
+		fill->ramp = pGradientBrush->GetRamp();
+		fill->type = pGradientBrush->GetType();
+		fill->extend = pGradientBrush->GetStops().extend;
+		fill->inverse = toPixels;
+		if ( fill->type == GradientType::Linear )
+		{
+			const auto& linear = pGradientBrush->GetLinear();
+			PointF direction{ linear.end.x - linear.start.x, linear.end.y - linear.start.y };
+			auto lengthSquared = direction.x * direction.x + direction.y * direction.y;
+			fill->origin = linear.start;
+			fill->axis = lengthSquared > 0 ? PointF{ direction.x / lengthSquared, direction.y / lengthSquared } : PointF{};
+		}
+		else
+		{
+			const auto& radial = pGradientBrush->GetRadial();
+			fill->origin = radial.center;
+			fill->axis = PointF{ radial.radiusX > 0 ? 1.0f / radial.radiusX : 0.0f, radial.radiusY > 0 ? 1.0f / radial.radiusY : 0.0f };
+		}
+		return Paint{ 0, fill };
+	}
+
+	void DrawText( const TextLayout& layout, const Paint& paint, const PointF& position )
+	{
+		auto em = layout.GetHeight();
+		auto text = layout.GetText();
+		auto end = text + layout.GetLength();
+		const auto& size = layout.GetSize();
+
+		auto lineCount = static_cast< float >( std::count( text, end, L'\n' ) + 1 );
+		auto textHeight = lineCount * k_LineHeight * em;
+		float y = position.y;
+		switch ( layout.GetParagraphAlignment() )
+		{
+			case ParagraphAlignment::Far: y += size.h - textHeight; break;
+			case ParagraphAlignment::Center: y += ( size.h - textHeight ) * 0.5f; break;
+			default: break;
+		}
+
+		for ( auto lineBegin = text; ; )
+		{
+			auto lineEnd = std::find( lineBegin, end, L'\n' );
+			auto lineWidth = ( lineEnd - lineBegin ) * k_GlyphAdvance * em;
+
+			float x = position.x;
+			switch ( layout.GetTextAlignment() )
+			{
+				case TextAlignment::Trailing: x += size.w - lineWidth; break;
+				case TextAlignment::Center: x += ( size.w - lineWidth ) * 0.5f; break;
+				default: break;
+			}
+
+			for ( auto it = lineBegin; it != lineEnd; ++it, x += k_GlyphAdvance * em )
+			{
+				if ( *it != L' ' && *it != L'\t' )
+					Fill( paint, RectF{ x + 0.05f * em, y + 0.35f * em, 0.4f * em, 0.6f * em } );
+			}
+
+			if ( lineEnd == end )
+				break;
+			lineBegin = lineEnd + 1;
+			y += k_LineHeight * em;
+		}
+	}
+
+public:
+	static const char* Name() { return "CpuDeviceContext"; }
+
+	DeviceContext( directui::TaskPool& pool, ResourceTracker& deviceResources )
+		: graphics::DeviceContext{ Name(), &deviceResources }
+		, _pool{ pool }
+	{}
+
+	std::unique_ptr<graphics::Brush> CreateSolidBrush( const ColorF& color ) override
+	{
+		return std::unique_ptr<graphics::Brush>( new Brush{ color } );
+	}
+
+	Brush& CreateFrameSolidBrush( const ColorF& color ) override
+	{
+		return *_frameArena.New<Brush>( color );
+	}
+
+	TextLayout& CreateFrameTextLayout( StringView text, const graphics::TextFormat& format, const SizeF& sizeFit ) override
+	{
+		auto pFormat = format.As<TextFormat>();
+		if ( pFormat == nullptr )
+		{
+			throw std::invalid_argument( "TextFormat was not created by this device" );
+		}
+
+		auto chars = static_cast< wchar_t* >( _frameArena.Allocate( ( text.length() + 1 ) * sizeof( wchar_t ), alignof( wchar_t ) ) );
+		std::memcpy( chars, text.data(), text.length() * sizeof( wchar_t ) );
+		chars[ text.length() ] = L'\0';
+		return *_frameArena.New<TextLayout>( chars, text.length(), pFormat->GetHeight(), sizeFit );
+	}
+
+	void BeginDraw( directui::Handle windowHandle ) override
+	{
+		throw std::logic_error( "The CPU backend only draws offscreen" );
+	}
+
+	void BeginDraw( const directui::SizePx& sizePx, float dpi ) override
+	{
+		_frameArena.Reset();
+		_frameNumber++;
+		TrimCaches();
+
+		_dpi = dpi;
+		auto width = std::max( 1, sizePx.w );
+		auto height = std::max( 1, sizePx.h );
+		if ( width != _surface.width || height != _surface.height )
+		{
+			_surfaceCharge.Reset();
+			_surface.Resize( width, height );
+			_surfaceCharge = ResourceCharge{ _resources, ResourceType::Bitmap, SurfaceBytes( _surface ) };
+		}
+
+		_targetDepth = 0;
+		_layerStack.clear();
+		PushTarget( _surface, Matrix3x2F::Scale( GetScale(), GetScale() ) );
+	}
+
+	void EndDraw() override
+	{
+		if ( _targetDepth == 0 )
+			return;
+
+		Rasterize( *_targets[ 0 ] );
+		_targetDepth = 0;
+	}
+
+	// Rasterization finishes in EndDraw, so the copy is done right away.
+	ReadbackId QueueReadback( void* pixels, int stride ) override
+	{
+		auto destination = static_cast< uint8_t* >( pixels );
+		auto rowSize = std::min( static_cast< size_t >( stride ), static_cast< size_t >( _surface.width ) * 4 );
+		for ( int y = 0; y < _surface.height; ++y )
+		{
+			std::memcpy( destination + static_cast< size_t >( y ) * stride, _surface.pixels.data() + static_cast< size_t >( y ) * _surface.width, rowSize );
+		}
+		return _nextReadbackId++;
+	}
+
+	bool PollReadback( ReadbackId id, bool wait ) override { return true; }
+
+	RectF GetDrawRect() override
+	{
+		return RectF{ 0, 0, _surface.width / GetScale(), _surface.height / GetScale() };
+	}
+
+	float GetDpi() override { return _dpi; }
+
+	void Clear( const ColorF& color ) override
+	{
+		auto& target = CurrentTarget();
+		Command command{};
+		command.type = CommandType::Copy;
+		command.color = PremultipliedFromColor( color );
+		command.bounds = target.clips.back();
+		target.Record( command );
+	}
+
+	void FillRect( graphics::Brush& brush, const RectF& rect ) override
+	{
+		Fill( GetPaint( brush ), rect );
+	}
+
+	void DrawRect( graphics::Brush& brush, const RectF& rect, float strokeWidth ) override
+	{
+		Stroke( GetPaint( brush ), rect, strokeWidth );
+	}
+
+	void DrawTextLayout( const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position ) override
+	{
+		if ( auto pLayout = layout.As<TextLayout>() )
+			DrawText( *pLayout, GetPaint( brush ), position );
+	}
+
+	// Overloads taking the backend types, used by Backend without downcasts.
+	void FillRect( Brush& brush, const RectF& rect ) { Fill( Paint{ brush.GetColor(), nullptr }, rect ); }
+	void DrawRect( Brush& brush, const RectF& rect, float strokeWidth ) { Stroke( Paint{ brush.GetColor(), nullptr }, rect, strokeWidth ); }
+
+	void DrawTextLayout( const TextLayout& layout, Brush& brush, const PointF& position )
+	{
+		DrawText( layout, Paint{ brush.GetColor(), nullptr }, position );
+	}
+
+	void PushClip( const RectF& rect ) override
+	{
+		auto& target = CurrentTarget();
+		auto pixels = TransformRect( target.transform, rect );
+		RectI clip{
+			static_cast< int >( std::round( pixels.x ) ), static_cast< int >( std::round( pixels.y ) ),
+			static_cast< int >( std::round( pixels.x + pixels.w ) ), static_cast< int >( std::round( pixels.y + pixels.h ) ) };
+		target.clips.push_back( Intersect( clip, target.clips.back() ) );
+	}
+
+	void PopClip() override
+	{
+		auto& target = CurrentTarget();
+		if ( target.clips.size() > 1 )
+			target.clips.pop_back();
+	}
+
+	bool BeginLayer( LayerId id, const RectF& bounds ) override
+	{
+		auto scale = GetScale();
+		auto width = static_cast< int >( std::max( 1.0f, std::ceil( bounds.w * scale ) ) );
+		auto height = static_cast< int >( std::max( 1.0f, std::ceil( bounds.h * scale ) ) );
+
+		LayerKey key{ id, ToDpiBucket( _dpi ) };
+		if ( std::find( _layerDpis.begin(), _layerDpis.end(), key.dpi ) == _layerDpis.end() )
+			_layerDpis.push_back( key.dpi );
+
+		auto& layer = _layers[ key ];
+		if ( layer.surface.width != width || layer.surface.height != height )
+		{
+			layer.charge.Reset();
+			layer.surface.Resize( width, height );
+			layer.charge = ResourceCharge{ _resources, ResourceType::Bitmap, SurfaceBytes( layer.surface ) };
+			layer.valid = false;
+		}
+		layer.bounds = bounds;
+		layer.lastUsedFrame = _frameNumber;
+
+		LayerScope scope{ key, !layer.valid };
+		if ( scope.recording )
+		{
+			// Content is drawn in layer local coordinates, so moving the layer keeps it valid.
+			std::fill( layer.surface.pixels.begin(), layer.surface.pixels.end(), 0 );
+			PushTarget( layer.surface, Matrix3x2F::Translation( -bounds.x, -bounds.y ) * Matrix3x2F::Scale( scale, scale ) );
+		}
+
+		_layerStack.push_back( scope );
+		return scope.recording;
+	}
+
+	void EndLayer( const Matrix3x2F& transform, float opacity ) override
+	{
+		auto scope = _layerStack.back();
+		_layerStack.pop_back();
+
+		auto& layer = _layers.at( scope.key );
+		if ( scope.recording )
+		{
+			// The parent is rasterized later, the layer has to be complete before that.
+			Rasterize( CurrentTarget() );
+			_targetDepth--;
+			layer.valid = true;
+		}
+
+		auto& target = CurrentTarget();
+		auto scale = GetScale();
+		auto toTarget = Matrix3x2F::Scale( 1.0f / scale, 1.0f / scale ) *
+			Matrix3x2F::Translation( layer.bounds.x, layer.bounds.y ) * transform * target.transform;
+
+		Command command{};
+		command.type = CommandType::Composite;
+		command.opacity = static_cast< uint32_t >( std::min( std::max( opacity, 0.0f ), 1.0f ) * 255.0f + 0.5f );
+		command.source = &layer.surface;
+		command.inverse = toTarget;
+		if ( command.opacity == 0 || !command.inverse.Invert() )
+			return;
+
+		auto destination = TransformRect( toTarget, RectF{ 0, 0, static_cast< float >( layer.surface.width ), static_cast< float >( layer.surface.height ) } );
+		command.bounds = Intersect( OuterPixels( destination ), target.clips.back() );
+		target.Record( command );
+	}
+
+	void InvalidateLayer( LayerId id ) override
+	{
+		for ( auto dpi : _layerDpis )
+		{
+			auto it = _layers.find( LayerKey{ id, dpi } );
+			if ( it != _layers.end() )
+			{
+				it->second.valid = false;
+			}
+		}
+	}
+};
+
+class Device : public graphics::Device
+{
+private:
+	directui::TaskPool _pool;
+	GradientCache<GradientRamp> _gradientCache;
+
+public:
+	Device( unsigned threadCount )
+		: _pool{ threadCount }
+	{}
+
+	std::unique_ptr<graphics::DeviceContext> CreateDeviceContext() override
+	{
+		return std::unique_ptr<graphics::DeviceContext>( new DeviceContext{ _pool, _resources } );
+	}
+
+	std::unique_ptr<graphics::TextFormat> CreateTextFormat( const String& fontFamily, float height ) override
+	{
+		return std::unique_ptr<graphics::TextFormat>( new TextFormat{ height } );
+	}
+
+	std::unique_ptr<graphics::TextLayout> CreateTextLayout( StringView text, const graphics::TextFormat& format, const SizeF& sizeFit ) override
+	{
+		if ( auto pFormat = format.As<TextFormat>() )
+		{
+			return std::unique_ptr<graphics::TextLayout>( new TextLayout{ String{ text }, pFormat->GetHeight(), sizeFit } );
+		}
+		return nullptr;
+	}
+
+	std::unique_ptr<graphics::Brush> CreateSolidBrush( const ColorF& color ) override
+	{
+		return std::unique_ptr<graphics::Brush>( new Brush{ color } );
+	}
+
+	std::unique_ptr<graphics::GradientBrush> CreateGradientBrush( const LinearGradient& gradient, const GradientStops& stops ) override
+	{
+		return std::unique_ptr<graphics::GradientBrush>( new GradientBrush{ _gradientCache, _resources, gradient, stops } );
+	}
+
+	std::unique_ptr<graphics::GradientBrush> CreateGradientBrush( const RadialGradient& gradient, const GradientStops& stops ) override
+	{
+		return std::unique_ptr<graphics::GradientBrush>( new GradientBrush{ _gradientCache, _resources, gradient, stops } );
+	}
+
+	TextMetrics MeasureText( StringView text, const graphics::TextFormat& format, float maxWidth ) override
+	{
+		auto pFormat = format.As<TextFormat>();
+		if ( pFormat == nullptr )
+			return TextMetrics{};
+
+		auto em = pFormat->GetHeight();
+		size_t longestLine = 0;
+		uint32_t lineCount = 0;
+		for ( size_t begin = 0; ; )
+		{
+			auto end = text.find( L'\n', begin );
+			longestLine = std::max( longestLine, ( end == String::npos ? text.length() : end ) - begin );
+			lineCount++;
+			if ( end == String::npos )
+				break;
+			begin = end + 1;
+		}
+		return TextMetrics{ longestLine * k_GlyphAdvance * em, lineCount * k_LineHeight * em, lineCount };
+	}
+};
+
+DeviceContext* Backend::Cast( graphics::DeviceContext& dc ) { return dc.As<DeviceContext>(); }
+Brush* Backend::Cast( graphics::Brush& brush ) { return brush.As<Brush>(); }
+const TextLayout* Backend::Cast( const graphics::TextLayout& layout ) { return layout.As<TextLayout>(); }
+
+// DeviceContext is final, so the calls below are bound statically.
+Brush& Backend::CreateFrameSolidBrush( DeviceContext& dc, const ColorF& color ) { return dc.CreateFrameSolidBrush( color ); }
+TextLayout& Backend::CreateFrameTextLayout( DeviceContext& dc, StringView text, const graphics::TextFormat& format, const SizeF& sizeFit )
+{
+	return dc.CreateFrameTextLayout( text, format, sizeFit );
+}
+
+void Backend::Clear( DeviceContext& dc, const ColorF& color ) { dc.Clear( color ); }
+void Backend::FillRect( DeviceContext& dc, Brush& brush, const RectF& rect ) { dc.FillRect( brush, rect ); }
+void Backend::FillRect( DeviceContext& dc, graphics::Brush& brush, const RectF& rect ) { dc.FillRect( brush, rect ); }
+void Backend::DrawRect( DeviceContext& dc, Brush& brush, const RectF& rect, float strokeWidth ) { dc.DrawRect( brush, rect, strokeWidth ); }
+void Backend::DrawRect( DeviceContext& dc, graphics::Brush& brush, const RectF& rect, float strokeWidth ) { dc.DrawRect( brush, rect, strokeWidth ); }
+void Backend::DrawTextLayout( DeviceContext& dc, const TextLayout& layout, Brush& brush, const PointF& position ) { dc.DrawTextLayout( layout, brush, position ); }
+void Backend::DrawTextLayout( DeviceContext& dc, const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position )
+{
+	dc.DrawTextLayout( layout, brush, position );
+}
+
+// Mixed objects take the virtual path of the context, which downcasts both.
+void Backend::DrawTextLayout( DeviceContext& dc, const graphics::TextLayout& layout, Brush& brush, const PointF& position )
+{
+	dc.DrawTextLayout( layout, static_cast< graphics::Brush& >( brush ), position );
+}
+
+void Backend::DrawTextLayout( DeviceContext& dc, const TextLayout& layout, graphics::Brush& brush, const PointF& position )
+{
+	dc.DrawTextLayout( static_cast< const graphics::TextLayout& >( layout ), brush, position );
+}
+
+std::unique_ptr<graphics::Device> CreateDevice( unsigned threadCount )
+{
+	return std::unique_ptr<graphics::Device>( new Device{ threadCount } );
+}
+
+} // namespace graphics::cpu
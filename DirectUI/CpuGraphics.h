@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Graphics.h"
+
+namespace graphics::cpu
+{
+
+class DeviceContext;
+class Brush;
+class TextLayout;
+
+// Statically bound primitives for graphics::StaticDeviceContext.
+struct Backend
+{
+	using DeviceContext = cpu::DeviceContext;
+	using Brush = cpu::Brush;
+	using TextLayout = cpu::TextLayout;
+
+	// Null when the object was not created by this backend.
+	static DeviceContext* Cast( graphics::DeviceContext& dc );
+	static Brush* Cast( graphics::Brush& brush );
+	static const TextLayout* Cast( const graphics::TextLayout& layout );
+
+	static Brush& CreateFrameSolidBrush( DeviceContext& dc, const ColorF& color );
+	static TextLayout& CreateFrameTextLayout( DeviceContext& dc, StringView text, const graphics::TextFormat& format, const SizeF& sizeFit );
+
+	static void Clear( DeviceContext& dc, const ColorF& color );
+	static void FillRect( DeviceContext& dc, Brush& brush, const RectF& rect );
+	static void FillRect( DeviceContext& dc, graphics::Brush& brush, const RectF& rect );
+	static void DrawRect( DeviceContext& dc, Brush& brush, const RectF& rect, float strokeWidth );
+	static void DrawRect( DeviceContext& dc, graphics::Brush& brush, const RectF& rect, float strokeWidth );
+	static void DrawTextLayout( DeviceContext& dc, const TextLayout& layout, Brush& brush, const PointF& position );
+	static void DrawTextLayout( DeviceContext& dc, const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position );
+	static void DrawTextLayout( DeviceContext& dc, const graphics::TextLayout& layout, Brush& brush, const PointF& position );
+	static void DrawTextLayout( DeviceContext& dc, const TextLayout& layout, graphics::Brush& brush, const PointF& position );
+};
+
+// Software backend for headless rendering. Draw calls are binned into 64x64 pixel tiles
+// while recording and the tiles are rasterized in parallel at EndDraw. Every tile applies
+// its commands in submission order, so the output does not depend on the thread count.
+// Only offscreen drawing is supported, text is drawn as placeholder glyph boxes.
+// Zero threads means one per hardware thread.
+std::unique_ptr<graphics::Device> CreateDevice( unsigned threadCount = 0 );
+
+} // namespace graphics::cpu
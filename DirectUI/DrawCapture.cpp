@@ -0,0 +1,738 @@
+#include "DrawCapture.h"
+
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h> // for file mapping
+#else
+#include <sys/mman.h> // for mmap
+#include <sys/stat.h> // for fstat
+#include <fcntl.h> // for open
+#include <unistd.h> // for close
+#endif
+
+namespace graphics::capture
+{
+
+namespace
+{
+
+size_t Utf16Length( StringView text )
+{
+	if constexpr ( sizeof( wchar_t ) == sizeof( char16_t ) )
+	{
+		return text.length();
+	}
+	else
+	{
+		size_t length = 0;
+		for ( auto ch : text )
+		{
+			length += static_cast< uint32_t >( ch ) > 0xFFFF ? 2 : 1;
+		}
+		return length;
+	}
+}
+
+char16_t* WriteUtf16( StringView text, char16_t* out )
+{
+	for ( auto ch : text )
+	{
+		auto codePoint = static_cast< uint32_t >( ch );
+		if ( codePoint > 0xFFFF )
+		{
+			codePoint -= 0x10000;
+			*out++ = static_cast< char16_t >( 0xD800 + ( codePoint >> 10 ) );
+			*out++ = static_cast< char16_t >( 0xDC00 + ( codePoint & 0x3FF ) );
+		}
+		else
+		{
+			*out++ = static_cast< char16_t >( codePoint );
+		}
+	}
+	return out;
+}
+
+} // namespace
+
+String ToString( const char16_t* text, size_t length )
+{
+	String result;
+	result.reserve( length );
+	for ( size_t i = 0; i < length; ++i )
+	{
+		uint32_t codePoint = text[ i ];
+		if constexpr ( sizeof( wchar_t ) != sizeof( char16_t ) )
+		{
+			if ( codePoint >= 0xD800 && codePoint < 0xDC00 && i + 1 < length )
+			{
+				codePoint = 0x10000 + ( ( codePoint - 0xD800 ) << 10 ) + ( text[ ++i ] - 0xDC00 );
+			}
+		}
+		result.push_back( static_cast< wchar_t >( codePoint ) );
+	}
+	return result;
+}
+
+//------------------------------------------------------------------
+
+CaptureView::CaptureView( const void* data, size_t size )
+{
+	auto header = static_cast< const FileHeader* >( data );
+	if ( data == nullptr || size < sizeof( FileHeader ) ||
+		header->magic != k_Magic || header->version != k_Version ||
+		header->headerSize < sizeof( FileHeader ) || header->headerSize % k_RecordAlignment != 0 ||
+		header->headerSize > size )
+	{
+		return;
+	}
+
+	_data = static_cast< const uint8_t* >( data );
+	_size = size;
+}
+
+CaptureView::Iterator CaptureView::begin() const
+{
+	if ( !IsValid() )
+		return end();
+	return Iterator{ _data + GetHeader()->headerSize, _data + _size };
+}
+
+CaptureView::Iterator CaptureView::end() const
+{
+	return Iterator{ _data + _size, _data + _size };
+}
+
+void CaptureView::Iterator::Validate()
+{
+	if ( _position == _end )
+		return;
+
+	auto remaining = static_cast< size_t >( _end - _position );
+	auto header = reinterpret_cast< const RecordHeader* >( _position );
+	if ( remaining < sizeof( RecordHeader ) ||
+		header->size < sizeof( RecordHeader ) || header->size % k_RecordAlignment != 0 || header->size > remaining )
+	{
+		_position = _end;
+		return;
+	}
+
+	if ( auto text = Record{ header }.As<DrawTextRunRecord>() )
+	{
+		auto textBytes = ( static_cast< uint64_t >( text->familyLength ) + text->textLength ) * sizeof( char16_t );
+		if ( sizeof( DrawTextRunRecord ) + textBytes > header->size )
+		{
+			_position = _end;
+		}
+	}
+	else if ( auto gradient = Record{ header }.As<FillGradientRectRecord>() )
+	{
+		if ( sizeof( FillGradientRectRecord ) + static_cast< uint64_t >( gradient->stopCount ) * sizeof( GradientStop ) > header->size )
+		{
+			_position = _end;
+		}
+	}
+}
+
+CaptureView::Iterator& CaptureView::Iterator::operator++()
+{
+	_position += reinterpret_cast< const RecordHeader* >( _position )->size;
+	Validate();
+	return *this;
+}
+
+//------------------------------------------------------------------
+
+MappedCapture::~MappedCapture()
+{
+	Close();
+}
+
+bool MappedCapture::Open( const std::string& path )
+{
+	Close();
+
+#if defined(_WIN32)
+	HANDLE file = ::CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( file == INVALID_HANDLE_VALUE )
+		return false;
+	_file = file;
+
+	LARGE_INTEGER fileSize;
+	if ( !::GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart == 0 )
+	{
+		Close();
+		return false;
+	}
+
+	_mapping = ::CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( _mapping == nullptr )
+	{
+		Close();
+		return false;
+	}
+
+	_data = ::MapViewOfFile( _mapping, FILE_MAP_READ, 0, 0, 0 );
+	_size = static_cast< size_t >( fileSize.QuadPart );
+#else
+	int fd = ::open( path.c_str(), O_RDONLY );
+	if ( fd < 0 )
+		return false;
+	_file = reinterpret_cast< void* >( static_cast< intptr_t >( fd ) + 1 );
+
+	struct stat fileStat;
+	if ( ::fstat( fd, &fileStat ) != 0 || fileStat.st_size == 0 )
+	{
+		Close();
+		return false;
+	}
+
+	void* data = ::mmap( nullptr, static_cast< size_t >( fileStat.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+	_data = data == MAP_FAILED ? nullptr : data;
+	_size = static_cast< size_t >( fileStat.st_size );
+#endif
+
+	if ( _data == nullptr )
+	{
+		Close();
+		return false;
+	}
+	return GetView().IsValid();
+}
+
+void MappedCapture::Close()
+{
+#if defined(_WIN32)
+	if ( _data )
+		::UnmapViewOfFile( _data );
+	if ( _mapping )
+		::CloseHandle( _mapping );
+	if ( _file )
+		::CloseHandle( _file );
+#else
+	if ( _data )
+		::munmap( const_cast< void* >( _data ), _size );
+	if ( _file )
+		::close( static_cast< int >( reinterpret_cast< intptr_t >( _file ) - 1 ) );
+#endif
+	_data = nullptr;
+	_size = 0;
+	_file = nullptr;
+	_mapping = nullptr;
+}
+
+//------------------------------------------------------------------
+
+CaptureWriter::CaptureWriter()
+{
+	Reset();
+}
+
+void CaptureWriter::Reset()
+{
+	_data.assign( sizeof( FileHeader ), 0 );
+	Header().magic = k_Magic;
+	Header().version = k_Version;
+	Header().headerSize = sizeof( FileHeader );
+	_frameIndex = 0;
+}
+
+void CaptureWriter::BeginFrame( uint32_t contextId, bool offscreen, const SizeF& size, float dpi )
+{
+	auto& record = Append<BeginFrameRecord>();
+	record.contextId = contextId;
+	record.offscreen = offscreen ? 1 : 0;
+	record.size = size;
+	record.dpi = dpi;
+	record.frameIndex = _frameIndex++;
+}
+
+void CaptureWriter::EndFrame()
+{
+	Append<EndFrameRecord>();
+	Header().frameCount++;
+}
+
+void CaptureWriter::Clear( const ColorF& color )
+{
+	Append<ClearRecord>().color = color;
+}
+
+void CaptureWriter::FillRect( const ColorF& color, const RectF& rect )
+{
+	auto& record = Append<FillRectRecord>();
+	record.color = color;
+	record.rect = rect;
+}
+
+void CaptureWriter::FillGradientRect( const GradientBrush& brush, const RectF& rect )
+{
+	const auto& stops = brush.GetStops().stops;
+	auto& record = Append<FillGradientRectRecord>( stops.size() * sizeof( GradientStop ) );
+	record.rect = rect;
+	record.gradientType = static_cast< uint32_t >( brush.GetType() );
+	record.extend = static_cast< uint32_t >( brush.GetStops().extend );
+	record.start = brush.GetLinear().start;
+	record.end = brush.GetLinear().end;
+	record.center = brush.GetRadial().center;
+	record.radiusX = brush.GetRadial().radiusX;
+	record.radiusY = brush.GetRadial().radiusY;
+	record.transform = brush.GetTransform();
+	record.stopCount = static_cast< uint32_t >( stops.size() );
+	if ( !stops.empty() )
+		std::memcpy( const_cast< GradientStop* >( record.Stops() ), stops.data(), stops.size() * sizeof( GradientStop ) );
+}
+
+void CaptureWriter::DrawRect( const ColorF& color, const RectF& rect, float strokeWidth )
+{
+	auto& record = Append<DrawRectRecord>();
+	record.color = color;
+	record.rect = rect;
+	record.strokeWidth = strokeWidth;
+}
+
+void CaptureWriter::DrawTextRun( const ColorF& color, const PointF& position, const SizeF& layoutSize,
+	const String& fontFamily, float fontSize, TextAlignment textAlignment, ParagraphAlignment paragraphAlignment,
+	StringView text )
+{
+	auto familyLength = Utf16Length( fontFamily );
+	auto textLength = Utf16Length( text );
+
+	auto& record = Append<DrawTextRunRecord>( ( familyLength + textLength ) * sizeof( char16_t ) );
+	record.color = color;
+	record.position = position;
+	record.layoutSize = layoutSize;
+	record.fontSize = fontSize;
+	record.textAlignment = static_cast< uint32_t >( textAlignment );
+	record.paragraphAlignment = static_cast< uint32_t >( paragraphAlignment );
+	record.familyLength = static_cast< uint32_t >( familyLength );
+	record.textLength = static_cast< uint32_t >( textLength );
+
+	auto out = const_cast< char16_t* >( record.Family() );
+	WriteUtf16( text, WriteUtf16( fontFamily, out ) );
+}
+
+void CaptureWriter::PushClip( const RectF& rect )
+{
+	Append<PushClipRecord>().rect = rect;
+}
+
+void CaptureWriter::PopClip()
+{
+	Append<PopClipRecord>();
+}
+
+void CaptureWriter::BeginLayer( LayerId id, const RectF& bounds, bool recording )
+{
+	auto& record = Append<BeginLayerRecord>();
+	record.id = id;
+	record.bounds = bounds;
+	record.recording = recording ? 1 : 0;
+}
+
+void CaptureWriter::EndLayer( const Matrix3x2F& transform, float opacity )
+{
+	auto& record = Append<EndLayerRecord>();
+	record.transform = transform;
+	record.opacity = opacity;
+}
+
+void CaptureWriter::InvalidateLayer( LayerId id )
+{
+	Append<InvalidateLayerRecord>().id = id;
+}
+
+bool CaptureWriter::Save( const std::string& path ) const
+{
+	std::ofstream file( path, std::ios::binary | std::ios::trunc );
+	file.write( reinterpret_cast< const char* >( _data.data() ), static_cast< std::streamsize >( _data.size() ) );
+	return file.good();
+}
+
+//------------------------------------------------------------------
+
+class CaptureTextFormat : public graphics::TextFormat
+{
+private:
+	std::unique_ptr<graphics::TextFormat> _inner;
+	String _fontFamily;
+	float _fontSize;
+public:
+	static const char* Name() { return "CaptureTextFormat"; }
+
+	CaptureTextFormat( std::unique_ptr<graphics::TextFormat> inner, const String& fontFamily, float fontSize )
+		: graphics::TextFormat{ Name() }
+		, _inner{ std::move( inner ) }
+		, _fontFamily{ fontFamily }
+		, _fontSize{ fontSize }
+	{}
+
+	const graphics::TextFormat& GetInner() const { return *_inner; }
+	const String& GetFontFamily() const { return _fontFamily; }
+	float GetFontSize() const { return _fontSize; }
+};
+
+class CaptureTextLayout : public graphics::TextLayout
+{
+private:
+	std::unique_ptr<graphics::TextLayout> _owned;
+	graphics::TextLayout& _inner;
+	const CaptureTextFormat& _format;
+	String _text;
+	SizeF _size;
+	TextAlignment _textAlignment{ TextAlignment::Leading };
+	ParagraphAlignment _paragraphAlignment{ ParagraphAlignment::Near };
+public:
+	static const char* Name() { return "CaptureTextLayout"; }
+
+	CaptureTextLayout( std::unique_ptr<graphics::TextLayout> owned, graphics::TextLayout& inner,
+		const CaptureTextFormat& format, StringView text, const SizeF& size )
+		: graphics::TextLayout{ Name() }
+		, _owned{ std::move( owned ) }
+		, _inner{ inner }
+		, _format{ format }
+		, _text{ text }
+		, _size{ size }
+	{}
+
+	void SetTextAlignment( TextAlignment alignment ) override
+	{
+		_textAlignment = alignment;
+		_inner.SetTextAlignment( alignment );
+	}
+
+	void SetParagraphAlignment( ParagraphAlignment alignment ) override
+	{
+		_paragraphAlignment = alignment;
+		_inner.SetParagraphAlignment( alignment );
+	}
+
+	void Write( CaptureWriter& writer, const ColorF& color, const PointF& position ) const
+	{
+		writer.DrawTextRun( color, position, _size, _format.GetFontFamily(), _format.GetFontSize(),
+			_textAlignment, _paragraphAlignment, _text );
+	}
+
+	const graphics::TextLayout& GetInner() const { return _inner; }
+};
+
+class CaptureBrush : public graphics::Brush
+{
+private:
+	std::unique_ptr<graphics::Brush> _owned;
+	graphics::Brush& _inner;
+	ColorF _color;
+public:
+	static const char* Name() { return "CaptureBrush"; }
+
+	CaptureBrush( std::unique_ptr<graphics::Brush> owned, graphics::Brush& inner, const ColorF& color )
+		: graphics::Brush{ Name() }
+		, _owned{ std::move( owned ) }
+		, _inner{ inner }
+		, _color{ color }
+	{}
+
+	graphics::Brush& GetInner() { return _inner; }
+	const ColorF& GetColor() const { return _color; }
+};
+
+// Keeps the inner brush in sync, the capture records the geometry and stops of this one.
+class CaptureGradientBrush : public graphics::GradientBrush
+{
+private:
+	std::unique_ptr<graphics::GradientBrush> _inner;
+
+protected:
+	void OnGeometryChanged() override
+	{
+		if ( GetType() == GradientType::Linear )
+			_inner->SetLinear( GetLinear() );
+		else
+			_inner->SetRadial( GetRadial() );
+		_inner->SetTransform( GetTransform() );
+	}
+
+	void OnStopsChanged() override
+	{
+		_inner->SetStops( GetStops() );
+	}
+
+public:
+	static const char* Name() { return "CaptureGradientBrush"; }
+
+	template< typename TGradient >
+	CaptureGradientBrush( std::unique_ptr<graphics::GradientBrush> inner, const TGradient& gradient, const GradientStops& stops )
+		: graphics::GradientBrush{ Name(), gradient, stops }
+		, _inner{ std::move( inner ) }
+	{}
+
+	graphics::GradientBrush& GetInner() { return *_inner; }
+
+	// Strokes and text are recorded as solid, in the first stop color.
+	ColorF GetFallbackColor() const
+	{
+		const auto& stops = GetStops().stops;
+		return stops.empty() ? ColorF{} : stops.front().color;
+	}
+};
+
+class CaptureDeviceContext : public graphics::DeviceContext
+{
+private:
+	std::unique_ptr<graphics::DeviceContext> _inner;
+	CaptureWriter& _writer;
+	uint32_t _contextId;
+
+	bool IsRecording() const { return _writer.IsRecording(); }
+
+public:
+	static const char* Name() { return "CaptureDeviceContext"; }
+
+	CaptureDeviceContext( std::unique_ptr<graphics::DeviceContext> inner, CaptureWriter& writer, uint32_t contextId )
+		: graphics::DeviceContext{ Name() }
+		, _inner{ std::move( inner ) }
+		, _writer{ writer }
+		, _contextId{ contextId }
+	{}
+
+	std::unique_ptr<graphics::Brush> CreateSolidBrush( const ColorF& color ) override
+	{
+		auto inner = _inner->CreateSolidBrush( color );
+		auto& innerRef = *inner;
+		return std::unique_ptr<graphics::Brush>( new CaptureBrush{ std::move( inner ), innerRef, color } );
+	}
+
+	graphics::Brush& CreateFrameSolidBrush( const ColorF& color ) override
+	{
+		return *_frameArena.New<CaptureBrush>( nullptr, _inner->CreateFrameSolidBrush( color ), color );
+	}
+
+	graphics::TextLayout& CreateFrameTextLayout( StringView text, const graphics::TextFormat& format, const SizeF& sizeFit ) override
+	{
+		auto pFormat = format.As<CaptureTextFormat>();
+		if ( pFormat == nullptr )
+		{
+			throw std::invalid_argument( "TextFormat was not created by the capture device" );
+		}
+		auto& inner = _inner->CreateFrameTextLayout( text, pFormat->GetInner(), sizeFit );
+		return *_frameArena.New<CaptureTextLayout>( nullptr, inner, *pFormat, text, sizeFit );
+	}
+
+	void BeginDraw( directui::Handle windowHandle ) override
+	{
+		_frameArena.Reset();
+		_inner->BeginDraw( windowHandle );
+		if ( IsRecording() )
+		{
+			auto rect = _inner->GetDrawRect();
+			_writer.BeginFrame( _contextId, false, SizeF{ rect.w, rect.h }, _inner->GetDpi() );
+		}
+	}
+
+	void BeginDraw( const directui::SizePx& sizePx, float dpi ) override
+	{
+		_frameArena.Reset();
+		_inner->BeginDraw( sizePx, dpi );
+		if ( IsRecording() )
+		{
+			auto rect = _inner->GetDrawRect();
+			_writer.BeginFrame( _contextId, true, SizeF{ rect.w, rect.h }, dpi );
+		}
+	}
+
+	void EndDraw() override
+	{
+		_inner->EndDraw();
+		if ( IsRecording() )
+			_writer.EndFrame();
+	}
+
+	PresentStatistics GetPresentStatistics() override { return _inner->GetPresentStatistics(); }
+
+	ReadbackId QueueReadback( void* pixels, int stride ) override { return _inner->QueueReadback( pixels, stride ); }
+	bool PollReadback( ReadbackId id, bool wait ) override { return _inner->PollReadback( id, wait ); }
+
+	RectF GetDrawRect() override { return _inner->GetDrawRect(); }
+	float GetDpi() override { return _inner->GetDpi(); }
+
+	ResourceUsage GetResourceUsage() const override { return _inner->GetResourceUsage(); }
+
+	void SetResourceBudget( const ResourceBudget& budget ) override
+	{
+		graphics::DeviceContext::SetResourceBudget( budget );
+		_inner->SetResourceBudget( budget );
+	}
+
+	void Clear( const ColorF& color ) override
+	{
+		_inner->Clear( color );
+		if ( IsRecording() )
+			_writer.Clear( color );
+	}
+
+	void FillRect( graphics::Brush& brush, const RectF& rect ) override
+	{
+		if ( auto pBrush = brush.As<CaptureBrush>() )
+		{
+			_inner->FillRect( pBrush->GetInner(), rect );
+			if ( IsRecording() )
+				_writer.FillRect( pBrush->GetColor(), rect );
+		}
+		else if ( auto pGradientBrush = brush.As<CaptureGradientBrush>() )
+		{
+			_inner->FillRect( pGradientBrush->GetInner(), rect );
+			if ( IsRecording() )
+				_writer.FillGradientRect( *pGradientBrush, rect );
+		}
+	}
+
+	void DrawRect( graphics::Brush& brush, const RectF& rect, float strokeWidth ) override
+	{
+		if ( auto pBrush = brush.As<CaptureBrush>() )
+		{
+			_inner->DrawRect( pBrush->GetInner(), rect, strokeWidth );
+			if ( IsRecording() )
+				_writer.DrawRect( pBrush->GetColor(), rect, strokeWidth );
+		}
+		else if ( auto pGradientBrush = brush.As<CaptureGradientBrush>() )
+		{
+			_inner->DrawRect( pGradientBrush->GetInner(), rect, strokeWidth );
+			if ( IsRecording() )
+				_writer.DrawRect( pGradientBrush->GetFallbackColor(), rect, strokeWidth );
+		}
+	}
+
+	void DrawTextLayout( const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position ) override
+	{
+		auto pTextLayout = layout.As<CaptureTextLayout>();
+		if ( pTextLayout == nullptr )
+			return;
+
+		if ( auto pBrush = brush.As<CaptureBrush>() )
+		{
+			_inner->DrawTextLayout( pTextLayout->GetInner(), pBrush->GetInner(), position );
+			if ( IsRecording() )
+				pTextLayout->Write( _writer, pBrush->GetColor(), position );
+		}
+		else if ( auto pGradientBrush = brush.As<CaptureGradientBrush>() )
+		{
+			_inner->DrawTextLayout( pTextLayout->GetInner(), pGradientBrush->GetInner(), position );
+			if ( IsRecording() )
+				pTextLayout->Write( _writer, pGradientBrush->GetFallbackColor(), position );
+		}
+	}
+
+	void PushClip( const RectF& rect ) override
+	{
+		_inner->PushClip( rect );
+		if ( IsRecording() )
+			_writer.PushClip( rect );
+	}
+
+	void PopClip() override
+	{
+		_inner->PopClip();
+		if ( IsRecording() )
+			_writer.PopClip();
+	}
+
+	bool BeginLayer( LayerId id, const RectF& bounds ) override
+	{
+		bool recording = _inner->BeginLayer( id, bounds );
+		if ( IsRecording() )
+			_writer.BeginLayer( id, bounds, recording );
+		return recording;
+	}
+
+	void EndLayer( const Matrix3x2F& transform, float opacity ) override
+	{
+		_inner->EndLayer( transform, opacity );
+		if ( IsRecording() )
+			_writer.EndLayer( transform, opacity );
+	}
+
+	void InvalidateLayer( LayerId id ) override
+	{
+		_inner->InvalidateLayer( id );
+		if ( IsRecording() )
+			_writer.InvalidateLayer( id );
+	}
+};
+
+class CaptureDevice : public graphics::Device
+{
+private:
+	std::unique_ptr<graphics::Device> _inner;
+	CaptureWriter& _writer;
+	uint32_t _nextContextId{ 0 };
+
+public:
+	CaptureDevice( std::unique_ptr<graphics::Device> inner, CaptureWriter& writer )
+		: _inner{ std::move( inner ) }
+		, _writer{ writer }
+	{}
+
+	std::unique_ptr<graphics::DeviceContext> CreateDeviceContext() override
+	{
+		return std::unique_ptr<graphics::DeviceContext>( new CaptureDeviceContext{ _inner->CreateDeviceContext(), _writer, _nextContextId++ } );
+	}
+
+	std::unique_ptr<graphics::TextFormat> CreateTextFormat( const String& fontFamily, float height ) override
+	{
+		return std::unique_ptr<graphics::TextFormat>( new CaptureTextFormat{ _inner->CreateTextFormat( fontFamily, height ), fontFamily, height } );
+	}
+
+	std::unique_ptr<graphics::TextLayout> CreateTextLayout( StringView text, const graphics::TextFormat& format, const SizeF& sizeFit ) override
+	{
+		if ( auto pFormat = format.As<CaptureTextFormat>() )
+		{
+			auto inner = _inner->CreateTextLayout( text, pFormat->GetInner(), sizeFit );
+			if ( inner == nullptr )
+				return nullptr;
+			auto& innerRef = *inner;
+			return std::unique_ptr<graphics::TextLayout>( new CaptureTextLayout{ std::move( inner ), innerRef, *pFormat, text, sizeFit } );
+		}
+		return nullptr;
+	}
+
+	std::unique_ptr<graphics::Brush> CreateSolidBrush( const ColorF& color ) override
+	{
+		auto inner = _inner->CreateSolidBrush( color );
+		auto& innerRef = *inner;
+		return std::unique_ptr<graphics::Brush>( new CaptureBrush{ std::move( inner ), innerRef, color } );
+	}
+
+	std::unique_ptr<graphics::GradientBrush> CreateGradientBrush( const LinearGradient& gradient, const GradientStops& stops ) override
+	{
+		return std::unique_ptr<graphics::GradientBrush>( new CaptureGradientBrush{ _inner->CreateGradientBrush( gradient, stops ), gradient, stops } );
+	}
+
+	std::unique_ptr<graphics::GradientBrush> CreateGradientBrush( const RadialGradient& gradient, const GradientStops& stops ) override
+	{
+		return std::unique_ptr<graphics::GradientBrush>( new CaptureGradientBrush{ _inner->CreateGradientBrush( gradient, stops ), gradient, stops } );
+	}
+
+	TextMetrics MeasureText( StringView text, const graphics::TextFormat& format, float maxWidth ) override
+	{
+		if ( auto pFormat = format.As<CaptureTextFormat>() )
+		{
+			return _inner->MeasureText( text, pFormat->GetInner(), maxWidth );
+		}
+		return TextMetrics{};
+	}
+
+	ResourceUsage GetResourceUsage() const override { return _inner->GetResourceUsage(); }
+	void SetResourceBudget( uint64_t bytes ) override { _inner->SetResourceBudget( bytes ); }
+	std::vector<StartupPhase> GetStartupPhases() const override { return _inner->GetStartupPhases(); }
+};
+
+std::unique_ptr<Device> CreateCaptureDevice( std::unique_ptr<Device> inner, CaptureWriter& writer )
+{
+	return std::unique_ptr<Device>( new CaptureDevice{ std::move( inner ), writer } );
+}
+
+} // namespace graphics::capture
@@ -0,0 +1,303 @@
+#pragma once
+
+#include "Graphics.h"
+
+#include <vector> // for std::vector
+#include <string> // for std::string
+
+namespace graphics::capture
+{
+
+// Binary capture of draw streams. A capture is a FileHeader followed by records, every record
+// starts with a RecordHeader and is padded to 8 bytes so a mapped file can be read in place.
+// Values are stored little-endian, text is stored as UTF-16.
+
+constexpr uint32_t k_Magic = 0x43495544; // "DUIC"
+constexpr uint16_t k_Version = 1;
+constexpr size_t k_RecordAlignment = 8;
+
+struct FileHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t headerSize;
+	uint32_t frameCount;
+	uint32_t recordCount;
+};
+
+enum class RecordType : uint16_t
+{
+	BeginFrame = 1,
+	EndFrame,
+	Clear,
+	FillRect,
+	DrawRect,
+	DrawTextRun,
+	PushClip,
+	PopClip,
+	BeginLayer,
+	EndLayer,
+	InvalidateLayer,
+	FillGradientRect
+};
+
+struct RecordHeader
+{
+	RecordType type;
+	uint16_t reserved;
+	uint32_t size; // including the header and padding
+};
+
+struct BeginFrameRecord
+{
+	static constexpr RecordType Type = RecordType::BeginFrame;
+	RecordHeader header;
+	uint32_t contextId;
+	uint32_t offscreen;
+	SizeF size;
+	float dpi;
+	uint32_t frameIndex;
+};
+
+struct EndFrameRecord
+{
+	static constexpr RecordType Type = RecordType::EndFrame;
+	RecordHeader header;
+};
+
+struct ClearRecord
+{
+	static constexpr RecordType Type = RecordType::Clear;
+	RecordHeader header;
+	ColorF color;
+};
+
+struct FillRectRecord
+{
+	static constexpr RecordType Type = RecordType::FillRect;
+	RecordHeader header;
+	ColorF color;
+	RectF rect;
+};
+
+struct DrawRectRecord
+{
+	static constexpr RecordType Type = RecordType::DrawRect;
+	RecordHeader header;
+	ColorF color;
+	RectF rect;
+	float strokeWidth;
+};
+
+// Followed by familyLength UTF-16 code units of the font family and textLength code units of text.
+struct DrawTextRunRecord
+{
+	static constexpr RecordType Type = RecordType::DrawTextRun;
+	RecordHeader header;
+	ColorF color;
+	PointF position;
+	SizeF layoutSize;
+	float fontSize;
+	uint32_t textAlignment;
+	uint32_t paragraphAlignment;
+	uint32_t familyLength;
+	uint32_t textLength;
+
+	const char16_t* Family() const { return reinterpret_cast< const char16_t* >( this + 1 ); }
+	const char16_t* Text() const { return Family() + familyLength; }
+};
+
+struct PushClipRecord
+{
+	static constexpr RecordType Type = RecordType::PushClip;
+	RecordHeader header;
+	RectF rect;
+};
+
+struct PopClipRecord
+{
+	static constexpr RecordType Type = RecordType::PopClip;
+	RecordHeader header;
+};
+
+struct BeginLayerRecord
+{
+	static constexpr RecordType Type = RecordType::BeginLayer;
+	RecordHeader header;
+	uint64_t id;
+	RectF bounds;
+	uint32_t recording; // content was drawn into the layer in this frame
+};
+
+struct EndLayerRecord
+{
+	static constexpr RecordType Type = RecordType::EndLayer;
+	RecordHeader header;
+	Matrix3x2F transform;
+	float opacity;
+};
+
+struct InvalidateLayerRecord
+{
+	static constexpr RecordType Type = RecordType::InvalidateLayer;
+	RecordHeader header;
+	uint64_t id;
+};
+
+// Followed by stopCount gradient stops.
+struct FillGradientRectRecord
+{
+	static constexpr RecordType Type = RecordType::FillGradientRect;
+	RecordHeader header;
+	RectF rect;
+	uint32_t gradientType;
+	uint32_t extend;
+	PointF start;
+	PointF end;
+	PointF center;
+	float radiusX;
+	float radiusY;
+	Matrix3x2F transform;
+	uint32_t stopCount;
+	uint32_t reserved;
+
+	const GradientStop* Stops() const { return reinterpret_cast< const GradientStop* >( this + 1 ); }
+};
+
+String ToString( const char16_t* text, size_t length );
+
+//------------------------------------------------------------------
+
+// Read-only view over capture bytes, records are validated while iterating and
+// iteration stops at the first malformed record.
+class CaptureView
+{
+private:
+	const uint8_t* _data{ nullptr };
+	size_t _size{ 0 };
+
+public:
+	class Record
+	{
+	private:
+		const RecordHeader* _header;
+	public:
+		explicit Record( const RecordHeader* header ) : _header{ header } {}
+
+		RecordType GetType() const { return _header->type; }
+		uint32_t GetSize() const { return _header->size; }
+
+		template< typename TRecord >
+		const TRecord* As() const
+		{
+			if ( _header->type != TRecord::Type || _header->size < sizeof( TRecord ) )
+				return nullptr;
+			return reinterpret_cast< const TRecord* >( _header );
+		}
+	};
+
+	class Iterator
+	{
+	private:
+		const uint8_t* _position;
+		const uint8_t* _end;
+
+		void Validate();
+	public:
+		Iterator( const uint8_t* position, const uint8_t* end ) : _position{ position }, _end{ end } { Validate(); }
+
+		Record operator*() const { return Record{ reinterpret_cast< const RecordHeader* >( _position ) }; }
+		Iterator& operator++();
+		bool operator==( const Iterator& other ) const { return _position == other._position; }
+		bool operator!=( const Iterator& other ) const { return _position != other._position; }
+	};
+
+	CaptureView() {}
+	CaptureView( const void* data, size_t size );
+
+	bool IsValid() const { return _data != nullptr; }
+	const FileHeader* GetHeader() const { return reinterpret_cast< const FileHeader* >( _data ); }
+
+	Iterator begin() const;
+	Iterator end() const;
+};
+
+// Memory maps a capture file, nothing is copied or parsed up front.
+class MappedCapture
+{
+private:
+	const void* _data{ nullptr };
+	size_t _size{ 0 };
+	void* _file{ nullptr };
+	void* _mapping{ nullptr };
+
+public:
+	MappedCapture() {}
+	~MappedCapture();
+
+	MappedCapture( const MappedCapture& ) = delete;
+	MappedCapture& operator=( const MappedCapture& ) = delete;
+
+	bool Open( const std::string& path );
+	void Close();
+
+	CaptureView GetView() const { return CaptureView{ _data, _size }; }
+};
+
+//------------------------------------------------------------------
+
+class CaptureWriter
+{
+private:
+	std::vector<uint8_t> _data;
+	bool _recording{ true };
+	uint32_t _frameIndex{ 0 };
+
+	FileHeader& Header() { return *reinterpret_cast< FileHeader* >( _data.data() ); }
+
+	template< typename TRecord >
+	TRecord& Append( size_t extraBytes = 0 )
+	{
+		auto size = ( sizeof( TRecord ) + extraBytes + k_RecordAlignment - 1 ) & ~( k_RecordAlignment - 1 );
+		auto offset = _data.size();
+		_data.resize( offset + size );
+		Header().recordCount++;
+
+		auto record = reinterpret_cast< TRecord* >( _data.data() + offset );
+		record->header.type = TRecord::Type;
+		record->header.size = static_cast< uint32_t >( size );
+		return *record;
+	}
+
+public:
+	CaptureWriter();
+
+	bool IsRecording() const { return _recording; }
+	void SetRecording( bool recording ) { _recording = recording; }
+
+	void Reset();
+
+	void BeginFrame( uint32_t contextId, bool offscreen, const SizeF& size, float dpi );
+	void EndFrame();
+	void Clear( const ColorF& color );
+	void FillRect( const ColorF& color, const RectF& rect );
+	void FillGradientRect( const GradientBrush& brush, const RectF& rect );
+	void DrawRect( const ColorF& color, const RectF& rect, float strokeWidth );
+	void DrawTextRun( const ColorF& color, const PointF& position, const SizeF& layoutSize,
+		const String& fontFamily, float fontSize, TextAlignment textAlignment, ParagraphAlignment paragraphAlignment,
+		StringView text );
+	void PushClip( const RectF& rect );
+	void PopClip();
+	void BeginLayer( LayerId id, const RectF& bounds, bool recording );
+	void EndLayer( const Matrix3x2F& transform, float opacity );
+	void InvalidateLayer( LayerId id );
+
+	CaptureView GetView() const { return CaptureView{ _data.data(), _data.size() }; }
+	bool Save( const std::string& path ) const;
+};
+
+// Wraps a device so every DeviceContext it creates forwards to the inner device and
+// writes its draw calls into the writer.
+std::unique_ptr<Device> CreateCaptureDevice( std::unique_ptr<Device> inner, CaptureWriter& writer );
+
+} // namespace graphics::capture
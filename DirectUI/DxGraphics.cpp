@@ -1,759 +1,1791 @@
-// Based on Dynamic DPI sample from https://github.com/microsoft/Windows-classic-samples/tree/master/Samples/DynamicDPI
-#include "DxGraphics.h"
-
-#include <algorithm>
-
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-#include <windows.h> // for Win32 API
-
-#include <wrl.h> // for ComPtr
-#include <wrl/client.h>
-#include <d3d11_2.h>
-#include <d2d1_2.h>
-#include <dwrite_2.h>
-#include <wincodec.h>
-#include <DirectXMath.h>
-#include <dcomp.h>
-
-#pragma comment(lib, "shcore.lib")
-#pragma comment(lib, "Comctl32.lib")
-#pragma comment(lib, "d2d1.lib")
-#pragma comment(lib, "d3d11.lib")
-#pragma comment(lib, "dxgi.lib")
-#pragma comment(lib, "Dwrite.lib")
-#pragma comment(lib, "dcomp.lib")
-
-namespace graphics::dx
-{
-
-namespace wrl = Microsoft::WRL;
-
-struct CoInit
-{
-	CoInit();
-	~CoInit();
-};
-
-class DeviceContext;
-
-class TextFormat : public graphics::TextFormat
-{
-private:
-	wrl::ComPtr<IDWriteTextFormat> _textFormat;
-public:
-	static const char* Name() { return "DxTextFormat"; }
-
-	TextFormat( wrl::ComPtr<IDWriteTextFormat>&& textFormat )
-		: graphics::TextFormat{ Name() }
-		, _textFormat{ std::move( textFormat ) }
-	{}
-
-	virtual ~TextFormat() {}
-
-	IDWriteTextFormat* Get() const { return _textFormat.Get(); }
-};
-
-class TextLayout : public graphics::TextLayout
-{
-private:
-	wrl::ComPtr<IDWriteTextLayout> _textLayout;
-public:
-	static const char* Name() { return "DxTextLayout"; }
-
-	TextLayout( wrl::ComPtr<IDWriteTextLayout>&& textLayout )
-		: graphics::TextLayout{ Name() }
-		, _textLayout{ std::move( textLayout ) }
-	{}
-
-	virtual ~TextLayout() {}
-
-	IDWriteTextLayout* Get() const { return _textLayout.Get(); }
-
-	void SetTextAlignment( TextAlignment alignment ) override
-	{
-		DWRITE_TEXT_ALIGNMENT dwriteAlignment;
-		switch ( alignment )
-		{
-			case TextAlignment::Leading:	dwriteAlignment = DWRITE_TEXT_ALIGNMENT_LEADING; break;
-			case TextAlignment::Trailing:	dwriteAlignment = DWRITE_TEXT_ALIGNMENT_TRAILING; break;
-			case TextAlignment::Center:		dwriteAlignment = DWRITE_TEXT_ALIGNMENT_CENTER; break;
-			case TextAlignment::Justified:	dwriteAlignment = DWRITE_TEXT_ALIGNMENT_JUSTIFIED; break;
-			default: dwriteAlignment = DWRITE_TEXT_ALIGNMENT_LEADING; break;
-		}
-		_textLayout->SetTextAlignment( dwriteAlignment );
-	}
-
-	void SetParagraphAlignment( ParagraphAlignment alignment ) override
-	{
-		DWRITE_PARAGRAPH_ALIGNMENT dwriteAlignment;
-		switch ( alignment )
-		{
-			case ParagraphAlignment::Near:		dwriteAlignment = DWRITE_PARAGRAPH_ALIGNMENT_NEAR; break;
-			case ParagraphAlignment::Far:		dwriteAlignment = DWRITE_PARAGRAPH_ALIGNMENT_FAR; break;
-			case ParagraphAlignment::Center:	dwriteAlignment = DWRITE_PARAGRAPH_ALIGNMENT_CENTER; break;
-			default: dwriteAlignment = DWRITE_PARAGRAPH_ALIGNMENT_NEAR; break;
-		}
-		_textLayout->SetParagraphAlignment( dwriteAlignment );
-	}
-};
-
-class Device : public graphics::Device
-{
-private:
-	friend class DeviceContext;
-
-	CoInit _coInit;
-
-	// Direct3D
-	wrl::ComPtr<ID3D11Device2>        _d3dDevice;
-	wrl::ComPtr<ID3D11DeviceContext2> _d3dContext;
-	D3D_FEATURE_LEVEL                 _d3dFeatureLevel;
-
-	// Direct2D
-	wrl::ComPtr<ID2D1Factory2>        _d2dFactory;
-	wrl::ComPtr<ID2D1Device1>         _d2dDevice;
-
-	// DirectWrite + Windows Imaging Component
-	wrl::ComPtr<IDWriteFactory2>      _dwriteFactory;
-	wrl::ComPtr<IWICImagingFactory2>  _wicFactory;
-
-	void CreateIndependent();
-	void CreateDevice();
-public:
-	Device();
-	virtual ~Device();
-
-	std::unique_ptr<graphics::DeviceContext> CreateDeviceContext() override;
-	std::unique_ptr<graphics::TextFormat> CreateTextFormat( const String& fontFamily, float height ) override;
-	std::unique_ptr<graphics::TextLayout> CreateTextLayout( const String& text, const graphics::TextFormat& format, const SizeF& sizeFit ) override;
-};
-
-using BrushBuilder = std::function<void( ID2D1DeviceContext1& d2dContext, wrl::ComPtr<ID2D1Brush>& outBrush )>;
-
-class Brush : public graphics::Brush
-{
-private:
-	wrl::ComPtr<ID2D1Brush> _brush;
-	BrushBuilder _builder;
-public:
-	static const char* Name() { return "DxBrush"; }
-
-	Brush( BrushBuilder builder )
-		: graphics::Brush{ Name() }
-		, _builder{ builder }
-	{
-	}
-
-	virtual ~Brush() {}
-
-	ID2D1Brush* GetOrCreate( ID2D1DeviceContext1& d2dContext )
-	{
-		if ( _brush == nullptr )
-		{
-			_builder( d2dContext, _brush );
-		}
-		return _brush.Get();
-	}
-};
-
-class DeviceContext : public graphics::DeviceContext
-{
-private:
-	Device& _device;
-	// DXGI
-	wrl::ComPtr<IDXGISwapChain1>		_swapChain;
-
-	// Direct3D
-	wrl::ComPtr<ID3D11RenderTargetView> _d3dRenderTargetView;
-	wrl::ComPtr<ID3D11DepthStencilView> _d3dDepthStencilView;
-	D3D11_VIEWPORT                      _viewport;
-	SizeF                               _d3dRenderTargetSize;
-
-	// Direct2D
-	wrl::ComPtr<ID2D1DeviceContext1>	_d2dContext;
-	wrl::ComPtr<ID2D1Bitmap1>			_d2dTargetBitmap;
-
-	// Direct Composition
-	wrl::ComPtr<IDCompositionDevice>	_dcompDevice;
-	wrl::ComPtr<IDCompositionTarget>	_dcompTarget;
-	wrl::ComPtr<IDCompositionVisual>	_dcompVisual;
-
-
-	HWND _hwnd;
-	HDC _hdc;
-	PAINTSTRUCT _ps;
-
-	bool Present();
-public:
-	DeviceContext( Device& device );
-	virtual ~DeviceContext();
-
-	void Resize( HWND hwnd );
-
-	std::unique_ptr<graphics::Brush> CreateSolidBrush( const ColorF& color ) override;
-	
-	void BeginDraw( directui::Handle windowHandle ) override;
-	void EndDraw() override;
-
-	RectF GetDrawRect() override;
-
-	void Clear( const ColorF& color ) override;
-	void FillRect( graphics::Brush& brush, const RectF& rect ) override;
-	void DrawRect( graphics::Brush& brush, const RectF& rect, float strokeWidth ) override;
-	void DrawTextLayout( const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position ) override;
-};
-
-inline void ThrowIfFailed( HRESULT hr )
-{
-	if ( FAILED( hr ) )
-	{
-		struct ComException
-		{
-			HRESULT const hr;
-			ComException( HRESULT const value ) : hr( value ) {}
-		};
-
-		if ( S_OK != hr )
-		{
-			throw ComException( hr );
-		}
-	}
-}
-
-CoInit::CoInit()
-{
-	ThrowIfFailed( ::CoInitializeEx( nullptr, COINIT_APARTMENTTHREADED ) );
-}
-
-CoInit::~CoInit()
-{
-	::CoUninitialize();
-}
-
-Device::Device()
-	: _d3dFeatureLevel{ D3D_FEATURE_LEVEL_9_1 }
-{
-	CreateIndependent();
-	CreateDevice();
-}
-
-Device::~Device()
-{
-
-}
-
-std::unique_ptr<graphics::DeviceContext> Device::CreateDeviceContext()
-{
-	return std::unique_ptr<graphics::DeviceContext>( new DeviceContext( *this ) );
-}
-
-std::unique_ptr<graphics::TextFormat> Device::CreateTextFormat( const String& fontFamily, float height )
-{
-	wrl::ComPtr<IDWriteTextFormat> textFormat;
-	ThrowIfFailed( _dwriteFactory->CreateTextFormat( fontFamily.c_str(), nullptr,
-		DWRITE_FONT_WEIGHT_NORMAL,
-		DWRITE_FONT_STYLE_NORMAL,
-		DWRITE_FONT_STRETCH_NORMAL,
-		height, L"", &textFormat ) );
-	return std::unique_ptr<graphics::TextFormat>( new TextFormat{ std::move( textFormat ) } );
-}
-
-std::unique_ptr<graphics::TextLayout> Device::CreateTextLayout( const String& text, const graphics::TextFormat& format, const SizeF& sizeFit )
-{
-	if ( auto pFormat = format.As<TextFormat>() )
-	{
-		wrl::ComPtr<IDWriteTextLayout> textLayout;
-		ThrowIfFailed( _dwriteFactory->CreateTextLayout( text.c_str(), text.length(),
-			pFormat->Get(), sizeFit.w, sizeFit.h, &textLayout ) );
-		return std::unique_ptr<graphics::TextLayout>( new TextLayout{ std::move( textLayout ) } );
-	}
-	return nullptr;
-}
-
-void Device::CreateIndependent()
-{
-	// Initialize Direct2D resources.
-	D2D1_FACTORY_OPTIONS options;
-	::ZeroMemory( &options, sizeof( D2D1_FACTORY_OPTIONS ) );
-
-#if defined(_DEBUG)
-	// If the project is in a debug build, enable Direct2D debugging via SDK Layers.
-	options.debugLevel = D2D1_DEBUG_LEVEL_INFORMATION;
-#endif
-
-	// Initialize the Direct2D Factory.
-	ThrowIfFailed(
-		::D2D1CreateFactory(
-			D2D1_FACTORY_TYPE_MULTI_THREADED,
-			__uuidof( ID2D1Factory2 ),
-			&options,
-			&_d2dFactory
-		)
-	);
-
-	// Initialize the DirectWrite Factory.
-	ThrowIfFailed(
-		::DWriteCreateFactory(
-			DWRITE_FACTORY_TYPE_ISOLATED,
-			__uuidof( IDWriteFactory2 ),
-			&_dwriteFactory
-		)
-	);
-
-	// Initialize the Windows Imaging Component (WIC) Factory.
-	ThrowIfFailed(
-		::CoCreateInstance(
-			CLSID_WICImagingFactory2,
-			nullptr,
-			CLSCTX_INPROC_SERVER,
-			IID_PPV_ARGS( &_wicFactory )
-		)
-	);
-}
-
-#if defined(_DEBUG)
-// Check for SDK Layer support.
-inline bool SdkLayersAvailable()
-{
-	HRESULT hr = D3D11CreateDevice(
-		nullptr,
-		D3D_DRIVER_TYPE_NULL,       // There is no need to create a real hardware device.
-		0,
-		D3D11_CREATE_DEVICE_DEBUG,  // Check for the SDK layers.
-		nullptr,                    // Any feature level will do.
-		0,
-		D3D11_SDK_VERSION,          // Always set this to D3D11_SDK_VERSION for Windows Store apps.
-		nullptr,                    // No need to keep the D3D device reference.
-		nullptr,                    // No need to know the feature level.
-		nullptr                     // No need to keep the D3D device context reference.
-	);
-
-	return SUCCEEDED( hr );
-}
-#endif
-
-void Device::CreateDevice()
-{
-	// This flag adds support for surfaces with a different color channel ordering
-	// than the API default. It is required for compatibility with Direct2D.
-	UINT creationFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
-
-#if defined(_DEBUG)
-	if ( SdkLayersAvailable() )
-	{
-		// If the project is in a debug build, enable debugging via SDK Layers with this flag.
-		creationFlags |= D3D11_CREATE_DEVICE_DEBUG;
-	}
-#endif
-
-	// This array defines the set of DirectX hardware feature levels this app will support.
-	// Note the ordering should be preserved.
-	// Don't forget to declare your application's minimum required feature level in its
-	// description.  All applications are assumed to support 9.1 unless otherwise stated.
-	D3D_FEATURE_LEVEL featureLevels[] =
-	{
-		//D3D_FEATURE_LEVEL_12_0,
-		D3D_FEATURE_LEVEL_11_1,
-		D3D_FEATURE_LEVEL_11_0,
-		D3D_FEATURE_LEVEL_10_1,
-		D3D_FEATURE_LEVEL_10_0,
-		D3D_FEATURE_LEVEL_9_3,
-		D3D_FEATURE_LEVEL_9_2,
-		D3D_FEATURE_LEVEL_9_1
-	};
-
-	// Create the Direct3D 11 API device object and a corresponding context.
-	wrl::ComPtr<ID3D11Device> device;
-	wrl::ComPtr<ID3D11DeviceContext> context;
-
-	HRESULT hr = ::D3D11CreateDevice(
-		nullptr,                    // Specify nullptr to use the default adapter.
-		D3D_DRIVER_TYPE_HARDWARE,   // Create a device using the hardware graphics driver.
-		0,                          // Should be 0 unless the driver is D3D_DRIVER_TYPE_SOFTWARE.
-		creationFlags,              // Set debug and Direct2D compatibility flags.
-		featureLevels,              // List of feature levels this app can support.
-		ARRAYSIZE( featureLevels ), // Size of the list above.
-		D3D11_SDK_VERSION,          // Always set this to D3D11_SDK_VERSION for Windows Store apps.
-		&device,                    // Returns the Direct3D device created.
-		&_d3dFeatureLevel,          // Returns feature level of device created.
-		&context                    // Returns the device immediate context.
-	);
-
-	if ( FAILED( hr ) )
-	{
-		// If the initialization fails, fall back to the WARP device.
-		// For more information on WARP, see: 
-		// http://go.microsoft.com/fwlink/?LinkId=286690
-		ThrowIfFailed(
-			::D3D11CreateDevice(
-				nullptr,
-				D3D_DRIVER_TYPE_WARP, // Create a WARP device instead of a hardware device.
-				0,
-				creationFlags,
-				featureLevels,
-				ARRAYSIZE( featureLevels ),
-				D3D11_SDK_VERSION,
-				&device,
-				&_d3dFeatureLevel,
-				&context
-			)
-		);
-	}
-
-	// Store pointers to the Direct3D 11.1 API device and immediate context.
-	ThrowIfFailed(
-		device.As( &_d3dDevice )
-	);
-
-	ThrowIfFailed(
-		context.As( &_d3dContext )
-	);
-
-	// Create the Direct2D device object and a corresponding context.
-	wrl::ComPtr<IDXGIDevice3> dxgiDevice;
-	ThrowIfFailed(
-		_d3dDevice.As( &dxgiDevice )
-	);
-
-	ThrowIfFailed(
-		_d2dFactory->CreateDevice( dxgiDevice.Get(), &_d2dDevice )
-	);
-}
-
-DeviceContext::DeviceContext( Device& device )
-	: _device{ device }
-	, _viewport{}
-	, _d3dRenderTargetSize{}
-	, _hwnd{ nullptr }
-{
-	ThrowIfFailed(
-		_device._d2dDevice->CreateDeviceContext(
-			D2D1_DEVICE_CONTEXT_OPTIONS_NONE,
-			&_d2dContext
-		)
-	);
-}
-
-DeviceContext::~DeviceContext()
-{
-
-}
-
-void DeviceContext::Resize( HWND hwnd )
-{
-	RECT rc;
-	::GetClientRect( hwnd, &rc );
-
-	auto width = static_cast< float >( std::max( 1L, rc.right ) );
-	auto height = static_cast< float >( std::max( 1L, rc.bottom ) );
-
-	if ( _hwnd == hwnd && width == _d3dRenderTargetSize.w && height == _d3dRenderTargetSize.h )
-		return;
-
-	_hwnd = hwnd;
-
-	auto dpi = ::GetDpiForWindow( _hwnd );
-
-	// Clear the previous window size specific context.
-	ID3D11RenderTargetView* nullViews[] = { nullptr };
-	_device._d3dContext->OMSetRenderTargets( ARRAYSIZE( nullViews ), nullViews, nullptr );
-	_d3dRenderTargetView = nullptr;
-	_d2dContext->SetTarget( nullptr );
-	_d2dTargetBitmap = nullptr;
-	_d3dDepthStencilView = nullptr;
-	_device._d3dContext->Flush();
-	
-	_d3dRenderTargetSize.w = width;
-	_d3dRenderTargetSize.h = height;
-
-	if ( _swapChain != nullptr )
-	{
-		// If the swap chain already exists, resize it.
-		HRESULT hr = _swapChain->ResizeBuffers(
-			2, // Double-buffered swap chain.
-			static_cast< UINT >( _d3dRenderTargetSize.w ),
-			static_cast< UINT >( _d3dRenderTargetSize.h ),
-			DXGI_FORMAT_B8G8R8A8_UNORM,
-			0
-		);
-
-		if ( hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET )
-		{
-			// If the device was removed for any reason, a new device and swap chain will need to be created.
-			//HandleDeviceLost();
-
-			// Everything is set up now. Do not continue execution of this method. HandleDeviceLost will reenter this method
-			// and correctly set up the new device.
-			return;
-		}
-		else
-		{
-			ThrowIfFailed( hr );
-		}
-	}
-	else
-	{
-		// Otherwise, create a new one using the same adapter as the existing Direct3D device.
-		DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
-		swapChainDesc.Width = static_cast< UINT >( _d3dRenderTargetSize.w ); // Match the size of the window.
-		swapChainDesc.Height = static_cast< UINT >( _d3dRenderTargetSize.h );
-		swapChainDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM; // This is the most common swap chain format.
-		swapChainDesc.Stereo = false;
-		swapChainDesc.SampleDesc.Count = 1; // Don't use multi-sampling.
-		swapChainDesc.SampleDesc.Quality = 0;
-		swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-		swapChainDesc.BufferCount = 2; // Use double-buffering to minimize latency.
-		swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL; // All Windows Store apps must use this SwapEffect.
-		swapChainDesc.Flags = 0;
-		swapChainDesc.Scaling = DXGI_SCALING_STRETCH;
-		swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_PREMULTIPLIED;
-
-		// This sequence obtains the DXGI factory that was used to create the Direct3D device above.
-		wrl::ComPtr<IDXGIDevice3> dxgiDevice;
-		ThrowIfFailed(
-			_device._d3dDevice.As( &dxgiDevice )
-		);
-
-		wrl::ComPtr<IDXGIAdapter> dxgiAdapter;
-		ThrowIfFailed(
-			dxgiDevice->GetAdapter( &dxgiAdapter )
-		);
-
-		wrl::ComPtr<IDXGIFactory2> dxgiFactory;
-		ThrowIfFailed(
-			dxgiAdapter->GetParent( IID_PPV_ARGS( &dxgiFactory ) )
-		);
-
-		ThrowIfFailed(
-			dxgiFactory->CreateSwapChainForComposition(
-				_device._d3dDevice.Get(),
-				&swapChainDesc,
-				nullptr,
-				&_swapChain
-			)
-		);
-
-		// Create the DirectComposition device
-		ThrowIfFailed( DCompositionCreateDevice(
-			nullptr,
-			IID_PPV_ARGS( &_dcompDevice ) ) );
-
-		// Create a DirectComposition target associated with the window (pass in hWnd here)
-		ThrowIfFailed( _dcompDevice->CreateTargetForHwnd(
-			_hwnd,
-			true,
-			&_dcompTarget ) );
-
-		// Create a DirectComposition "visual"
-		ThrowIfFailed( _dcompDevice->CreateVisual( &_dcompVisual ) );
-
-		// Associate the visual with the swap chain
-		ThrowIfFailed( _dcompVisual->SetContent( _swapChain.Get() ) );
-
-		// Set the visual as the root of the DirectComposition target's composition tree
-		ThrowIfFailed( _dcompTarget->SetRoot( _dcompVisual.Get() ) );
-		ThrowIfFailed( _dcompDevice->Commit() );
-	}
-
-
-	// Create a render target view of the swap chain back buffer.
-	wrl::ComPtr<ID3D11Texture2D> backBuffer;
-	ThrowIfFailed(
-		_swapChain->GetBuffer( 0, IID_PPV_ARGS( &backBuffer ) )
-	);
-
-	ThrowIfFailed(
-		_device._d3dDevice->CreateRenderTargetView(
-			backBuffer.Get(),
-			nullptr,
-			&_d3dRenderTargetView
-		)
-	);
-
-	// Create a depth stencil view for use with 3D rendering if needed.
-	CD3D11_TEXTURE2D_DESC depthStencilDesc(
-		DXGI_FORMAT_D24_UNORM_S8_UINT,
-		static_cast< UINT >( _d3dRenderTargetSize.w ),
-		static_cast< UINT >( _d3dRenderTargetSize.h ),
-		1, // This depth stencil view has only one texture.
-		1, // Use a single mipmap level.
-		D3D11_BIND_DEPTH_STENCIL
-	);
-
-	wrl::ComPtr<ID3D11Texture2D> depthStencil;
-	ThrowIfFailed(
-		_device._d3dDevice->CreateTexture2D(
-			&depthStencilDesc,
-			nullptr,
-			&depthStencil
-		)
-	);
-
-	CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc( D3D11_DSV_DIMENSION_TEXTURE2D );
-	ThrowIfFailed(
-		_device._d3dDevice->CreateDepthStencilView(
-			depthStencil.Get(),
-			&depthStencilViewDesc,
-			&_d3dDepthStencilView
-		)
-	);
-
-	// Create a Direct2D target bitmap associated with the
-	// swap chain back buffer and set it as the current target.
-	D2D1_BITMAP_PROPERTIES1 bitmapProperties =
-		D2D1::BitmapProperties1(
-			D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
-			D2D1::PixelFormat( DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED ),
-			96.0f,
-			96.0f
-		);
-
-	wrl::ComPtr<IDXGISurface2> dxgiBackBuffer;
-	ThrowIfFailed(
-		_swapChain->GetBuffer( 0, IID_PPV_ARGS( &dxgiBackBuffer ) )
-	);
-
-	ThrowIfFailed(
-		_d2dContext->CreateBitmapFromDxgiSurface(
-			dxgiBackBuffer.Get(),
-			&bitmapProperties,
-			&_d2dTargetBitmap
-		)
-	);
-
-	_d2dContext->SetTarget( _d2dTargetBitmap.Get() );
-	_d2dContext->SetDpi( static_cast< float >( dpi ), static_cast< float >( dpi ) );
-}
-
-bool DeviceContext::Present()
-{
-	// The first argument instructs DXGI to block until VSync, putting the application
-	// to sleep until the next VSync. This ensures we don't waste any cycles rendering
-	// frames that will never be displayed to the screen.
-	HRESULT hr = _swapChain->Present( 1, 0 );
-
-	// Discard the contents of the render target.
-	// This is a valid operation only when the existing contents will be entirely
-	// overwritten. If dirty or scroll rects are used, this call should be removed.
-	_device._d3dContext->DiscardView( _d3dRenderTargetView.Get() );
-
-	// Discard the contents of the depth stencil.
-	_device._d3dContext->DiscardView( _d3dDepthStencilView.Get() );
-
-	// If the device was removed either by a disconnection or a driver upgrade, we
-	// must recreate all device resources.
-	if ( hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET )
-	{
-		//HandleDeviceLost();
-	}
-	else if ( hr == DXGI_STATUS_OCCLUDED )
-	{
-		return false;
-	}
-	else
-	{
-		ThrowIfFailed( hr );
-	}
-	return true;
-}
-
-std::unique_ptr<graphics::Brush> DeviceContext::CreateSolidBrush( const ColorF& color )
-{
-	return std::unique_ptr<graphics::Brush>( new Brush( 
-		[color] ( ID2D1DeviceContext1& d2dContext, wrl::ComPtr<ID2D1Brush>& outBrush ) {
-			
-			wrl::ComPtr<ID2D1SolidColorBrush> brush;
-			d2dContext.CreateSolidColorBrush(
-				D2D1::ColorF( color.r, color.g, color.b, color.a ),
-				&brush );
-			ThrowIfFailed( brush.As( &outBrush ) );
-		} ) );
-}
-
-void DeviceContext::BeginDraw(directui::Handle windowHandle)
-{
-	Resize( static_cast< HWND >( windowHandle ) );
-
-	//_hdc = ::BeginPaint( _hwnd, &_ps );
-
-	// Set the 3D rendering viewport to target the entire window.
-	_viewport = CD3D11_VIEWPORT(
-		0.0f,
-		0.0f,
-		_d3dRenderTargetSize.w,
-		_d3dRenderTargetSize.h
-	);
-
-	_device._d3dContext->RSSetViewports( 1, &_viewport );
-
-	_d2dContext->BeginDraw();
-}
-
-void DeviceContext::EndDraw()
-{
-	auto hr = _d2dContext->EndDraw();
-	Present();
-
-	//::EndPaint( _hwnd, &_ps );
-}
-
-RectF DeviceContext::GetDrawRect()
-{
-	FLOAT scaleX, scaleY;
-	_d2dContext->GetDpi( &scaleX, &scaleY );
-	scaleX /= 96.0f;
-	scaleY /= 96.0f;
-
-	return RectF{ _viewport.TopLeftX / scaleX, _viewport.TopLeftY / scaleY, _viewport.Width / scaleX, _viewport.Height / scaleY };
-}
-
-void DeviceContext::Clear( const ColorF& color )
-{
-	_d2dContext->Clear( D2D1::ColorF( color.r, color.g, color.b, color.a ) );
-}
-
-void DeviceContext::FillRect( graphics::Brush& brush, const RectF& rect )
-{
-	if ( auto pBrush = brush.As<Brush>() )
-	{
-		_d2dContext->FillRectangle(
-			D2D1::RectF( rect.x, rect.y, rect.x + rect.w, rect.y + rect.h ),
-			pBrush->GetOrCreate( *_d2dContext.Get() ) );
-	}
-}
-
-void DeviceContext::DrawRect( graphics::Brush& brush, const RectF& rect, float strokeWidth )
-{
-	if ( auto pBrush = brush.As<Brush>() )
-	{
-		_d2dContext->DrawRectangle(
-			D2D1::RectF( rect.x, rect.y, rect.x + rect.w, rect.y + rect.h ),
-			pBrush->GetOrCreate( *_d2dContext.Get() ),
-			strokeWidth
-		);
-	}
-}
-
-void DeviceContext::DrawTextLayout( const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position )
-{
-	if ( auto pBrush = brush.As<Brush>() )
-	{
-		if ( auto pTextLayout = layout.As<TextLayout>() )
-		{
-			_d2dContext->DrawTextLayout(
-				D2D1::Point2F( position.x, position.y ),
-				pTextLayout->Get(),
-				pBrush->GetOrCreate( *_d2dContext.Get() ),
-				D2D1_DRAW_TEXT_OPTIONS_ENABLE_COLOR_FONT
-			);
-		}
-	}
-}
-
-std::unique_ptr<graphics::Device> CreateDevice()
-{
-	return std::unique_ptr<graphics::Device>( new Device() );
-}
-
-} // namespace graphics::dx
+// Based on Dynamic DPI sample from https://github.com/microsoft/Windows-classic-samples/tree/master/Samples/DynamicDPI
+#include "DxGraphics.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <cfloat>
+#include <cstring>
+#include <mutex>
+#include <future>
+#include <chrono>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h> // for Win32 API
+
+#include <wrl.h> // for ComPtr
+#include <wrl/client.h>
+#include <d3d11_2.h>
+#include <d2d1_2.h>
+#include <dwrite_2.h>
+#include <wincodec.h>
+#include <DirectXMath.h>
+#include <dcomp.h>
+
+#pragma comment(lib, "shcore.lib")
+#pragma comment(lib, "Comctl32.lib")
+#pragma comment(lib, "d2d1.lib")
+#pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "dxgi.lib")
+#pragma comment(lib, "Dwrite.lib")
+#pragma comment(lib, "dcomp.lib")
+
+namespace graphics::dx
+{
+
+namespace wrl = Microsoft::WRL;
+
+struct CoInit
+{
+	CoInit();
+	~CoInit();
+};
+
+class DeviceContext;
+
+// DirectWrite and Direct2D do not report memory use, these are rough averages.
+constexpr uint64_t k_BrushBytes = 64;
+constexpr uint64_t k_GradientStopCollectionBytes = 256 * 4; // realized as a ramp texture
+
+inline D2D1::Matrix3x2F ToD2DMatrix( const Matrix3x2F& m )
+{
+	return D2D1::Matrix3x2F( m.m11, m.m12, m.m21, m.m22, m.dx, m.dy );
+}
+
+inline uint64_t EstimateTextLayoutBytes( size_t length )
+{
+	return 256 + length * 32;
+}
+
+// Fast path for MeasureText. Simple text is measured by summing design advances of the
+// format's font, complex scripts and characters missing in the font use a full TextLayout.
+// Kerning is not applied, which matches TextLayout closely enough for sizing.
+class TextMeasurer
+{
+private:
+	static constexpr UINT32 k_TableSize = 0x250; // Basic Latin up to Latin Extended-B
+	static constexpr size_t k_MaxCachedWidths = 64 * 1024;
+
+	wrl::ComPtr<IDWriteFontFace> _fontFace;
+	std::vector<float> _advances;
+	std::unordered_map<String, float> _widthCache;
+	std::mutex _widthCacheMutex;
+	float _lineHeight{ 0 };
+	float _spaceAdvance{ 0 };
+	bool _wordWrap{ true };
+
+	bool MeasureLine( const wchar_t* begin, const wchar_t* end, float& width ) const;
+	bool WrapLine( const wchar_t* begin, const wchar_t* end, float maxWidth, float& width, uint32_t& lineCount ) const;
+
+public:
+	TextMeasurer( IDWriteFactory2& factory, IDWriteTextFormat& format );
+
+	bool IsAvailable() const { return _fontFace != nullptr; }
+
+	// Returns false when the text needs a full layout.
+	bool Measure( StringView text, float maxWidth, TextMetrics& metrics );
+};
+
+class TextFormat : public graphics::TextFormat
+{
+private:
+	wrl::ComPtr<IDWriteTextFormat> _textFormat;
+	mutable std::unique_ptr<TextMeasurer> _measurer;
+	mutable std::once_flag _measurerCreated;
+public:
+	static const char* Name() { return "DxTextFormat"; }
+
+	TextFormat( wrl::ComPtr<IDWriteTextFormat>&& textFormat )
+		: graphics::TextFormat{ Name() }
+		, _textFormat{ std::move( textFormat ) }
+	{}
+
+	virtual ~TextFormat() {}
+
+	IDWriteTextFormat* Get() const { return _textFormat.Get(); }
+
+	TextMeasurer& GetMeasurer( IDWriteFactory2& factory ) const
+	{
+		// Formats are shared by windows drawing on different threads.
+		std::call_once( _measurerCreated, [this, &factory] {
+			_measurer.reset( new TextMeasurer{ factory, *_textFormat.Get() } );
+		} );
+		return *_measurer;
+	}
+};
+
+class TextLayout : public graphics::TextLayout
+{
+private:
+	wrl::ComPtr<IDWriteTextLayout> _textLayout;
+	ResourceCharge _charge;
+public:
+	static const char* Name() { return "DxTextLayout"; }
+
+	TextLayout( wrl::ComPtr<IDWriteTextLayout>&& textLayout, ResourceCharge&& charge )
+		: graphics::TextLayout{ Name() }
+		, _textLayout{ std::move( textLayout ) }
+		, _charge{ std::move( charge ) }
+	{}
+
+	virtual ~TextLayout() {}
+
+	IDWriteTextLayout* Get() const { return _textLayout.Get(); }
+
+	void SetTextAlignment( TextAlignment alignment ) override
+	{
+		DWRITE_TEXT_ALIGNMENT dwriteAlignment;
+		switch ( alignment )
+		{
+			case TextAlignment::Leading:	dwriteAlignment = DWRITE_TEXT_ALIGNMENT_LEADING; break;
+			case TextAlignment::Trailing:	dwriteAlignment = DWRITE_TEXT_ALIGNMENT_TRAILING; break;
+			case TextAlignment::Center:		dwriteAlignment = DWRITE_TEXT_ALIGNMENT_CENTER; break;
+			case TextAlignment::Justified:	dwriteAlignment = DWRITE_TEXT_ALIGNMENT_JUSTIFIED; break;
+			default: dwriteAlignment = DWRITE_TEXT_ALIGNMENT_LEADING; break;
+		}
+		_textLayout->SetTextAlignment( dwriteAlignment );
+	}
+
+	void SetParagraphAlignment( ParagraphAlignment alignment ) override
+	{
+		DWRITE_PARAGRAPH_ALIGNMENT dwriteAlignment;
+		switch ( alignment )
+		{
+			case ParagraphAlignment::Near:		dwriteAlignment = DWRITE_PARAGRAPH_ALIGNMENT_NEAR; break;
+			case ParagraphAlignment::Far:		dwriteAlignment = DWRITE_PARAGRAPH_ALIGNMENT_FAR; break;
+			case ParagraphAlignment::Center:	dwriteAlignment = DWRITE_PARAGRAPH_ALIGNMENT_CENTER; break;
+			default: dwriteAlignment = DWRITE_PARAGRAPH_ALIGNMENT_NEAR; break;
+		}
+		_textLayout->SetParagraphAlignment( dwriteAlignment );
+	}
+};
+
+struct GradientStopCollection
+{
+	wrl::ComPtr<ID2D1GradientStopCollection> collection;
+	ResourceCharge charge;
+};
+
+class Device : public graphics::Device
+{
+private:
+	friend class DeviceContext;
+	friend class GradientBrush;
+
+	CoInit _coInit;
+
+	// Direct3D
+	wrl::ComPtr<ID3D11Device2>        _d3dDevice;
+	wrl::ComPtr<ID3D11DeviceContext2> _d3dContext;
+	D3D_FEATURE_LEVEL                 _d3dFeatureLevel;
+
+	// Direct2D
+	wrl::ComPtr<ID2D1Factory2>        _d2dFactory;
+	wrl::ComPtr<ID2D1Device1>         _d2dDevice;
+	wrl::ComPtr<ID2D1Multithread>     _d2dMultithread;
+	wrl::ComPtr<ID2D1DeviceContext1>  _d2dResourceContext; // creates device brushes
+
+	// DirectWrite + Windows Imaging Component
+	wrl::ComPtr<IDWriteFactory2>      _dwriteFactory;
+	wrl::ComPtr<IWICImagingFactory2>  _wicFactory;
+	std::once_flag                    _wicCreated;
+
+	GradientCache<GradientStopCollection> _gradientCache;
+	std::vector<StartupPhase> _startupPhases;
+
+	void CreateIndependent();
+	void CreateDevice();
+	void CreateD2DDevice();
+	// Created on first use, only image loading needs it. COM has to be initialized on the calling thread.
+	IWICImagingFactory2* GetWicFactory();
+	std::shared_ptr<const GradientStopCollection> GetGradientStopCollection( const GradientStops& stops );
+public:
+	Device();
+	virtual ~Device();
+
+	std::unique_ptr<graphics::DeviceContext> CreateDeviceContext() override;
+	std::unique_ptr<graphics::TextFormat> CreateTextFormat( const String& fontFamily, float height ) override;
+	std::unique_ptr<graphics::TextLayout> CreateTextLayout( StringView text, const graphics::TextFormat& format, const SizeF& sizeFit ) override;
+	std::unique_ptr<graphics::Brush> CreateSolidBrush( const ColorF& color ) override;
+	std::unique_ptr<graphics::GradientBrush> CreateGradientBrush( const LinearGradient& gradient, const GradientStops& stops ) override;
+	std::unique_ptr<graphics::GradientBrush> CreateGradientBrush( const RadialGradient& gradient, const GradientStops& stops ) override;
+	TextMetrics MeasureText( StringView text, const graphics::TextFormat& format, float maxWidth ) override;
+	std::vector<StartupPhase> GetStartupPhases() const override { return _startupPhases; }
+};
+
+// Direct2D locks the D3D immediate context while drawing, every direct use of the immediate
+// context takes the same lock so windows can draw on their own render threads.
+class D3DContextLock
+{
+private:
+	ID2D1Multithread* _multithread;
+public:
+	explicit D3DContextLock( ID2D1Multithread* multithread )
+		: _multithread{ multithread }
+	{
+		_multithread->Enter();
+	}
+
+	~D3DContextLock()
+	{
+		_multithread->Leave();
+	}
+
+	D3DContextLock( const D3DContextLock& ) = delete;
+	D3DContextLock& operator=( const D3DContextLock& ) = delete;
+};
+
+using BrushBuilder = std::function<void( ID2D1DeviceContext1& d2dContext, wrl::ComPtr<ID2D1Brush>& outBrush )>;
+
+class Brush : public graphics::Brush
+{
+private:
+	wrl::ComPtr<ID2D1Brush> _brush;
+	BrushBuilder _builder;
+	ResourceCharge _charge;
+public:
+	static const char* Name() { return "DxBrush"; }
+
+	Brush( BrushBuilder builder, ResourceCharge&& charge )
+		: graphics::Brush{ Name() }
+		, _builder{ builder }
+		, _charge{ std::move( charge ) }
+	{
+	}
+
+	Brush( wrl::ComPtr<ID2D1Brush> brush, ResourceCharge&& charge )
+		: graphics::Brush{ Name() }
+		, _brush{ std::move( brush ) }
+		, _charge{ std::move( charge ) }
+	{
+	}
+
+	Brush( wrl::ComPtr<ID2D1Brush> brush )
+		: graphics::Brush{ Name() }
+		, _brush{ std::move( brush ) }
+	{
+	}
+
+	virtual ~Brush() {}
+
+	ID2D1Brush* GetOrCreate( ID2D1DeviceContext1& d2dContext )
+	{
+		if ( _brush == nullptr )
+		{
+			_builder( d2dContext, _brush );
+		}
+		return _brush.Get();
+	}
+};
+
+// Device brush, created up front on the resource context like device solid brushes.
+class GradientBrush : public graphics::GradientBrush
+{
+private:
+	Device& _device;
+	std::shared_ptr<const GradientStopCollection> _stopCollection;
+	wrl::ComPtr<ID2D1LinearGradientBrush> _linearBrush;
+	wrl::ComPtr<ID2D1RadialGradientBrush> _radialBrush;
+	ResourceCharge _charge;
+
+	void CreateBrush();
+
+protected:
+	void OnGeometryChanged() override;
+	void OnStopsChanged() override { CreateBrush(); }
+
+public:
+	static const char* Name() { return "DxGradientBrush"; }
+
+	template< typename TGradient >
+	GradientBrush( Device& device, const TGradient& gradient, const GradientStops& stops )
+		: graphics::GradientBrush{ Name(), gradient, stops }
+		, _device{ device }
+		, _charge{ device._resources, ResourceType::Brush, k_BrushBytes }
+	{
+		CreateBrush();
+	}
+
+	ID2D1Brush* Get() const
+	{
+		return _linearBrush != nullptr ? static_cast< ID2D1Brush* >( _linearBrush.Get() ) : _radialBrush.Get();
+	}
+};
+
+class DeviceContext final : public graphics::DeviceContext
+{
+private:
+	Device& _device;
+	// DXGI
+	wrl::ComPtr<IDXGISwapChain1>		_swapChain;
+	HANDLE								_frameLatencyWaitable{ nullptr };
+
+	// Direct3D
+	wrl::ComPtr<ID3D11RenderTargetView> _d3dRenderTargetView;
+	wrl::ComPtr<ID3D11DepthStencilView> _d3dDepthStencilView;
+	D3D11_VIEWPORT                      _viewport;
+	ResourceCharge                      _swapChainCharge;
+	ResourceCharge                      _depthBufferCharge;
+	SizeF                               _d3dRenderTargetSize;
+
+	// Direct2D
+	wrl::ComPtr<ID2D1DeviceContext1>	_d2dContext;
+	wrl::ComPtr<ID2D1Bitmap1>			_d2dTargetBitmap;
+
+	// Direct Composition
+	wrl::ComPtr<IDCompositionDevice>	_dcompDevice;
+	wrl::ComPtr<IDCompositionTarget>	_dcompTarget;
+	wrl::ComPtr<IDCompositionVisual>	_dcompVisual;
+
+
+	// Cached layers
+	struct Layer
+	{
+		wrl::ComPtr<ID2D1Bitmap1> bitmap;
+		ResourceCharge charge;
+		RectF bounds;
+		bool valid{ false };
+		uint64_t lastUsedFrame{ 0 };
+	};
+
+	struct LayerScope
+	{
+		LayerKey key;
+		bool recording;
+		wrl::ComPtr<ID2D1Image> previousTarget;
+		D2D1::Matrix3x2F previousTransform;
+	};
+
+	std::unordered_map<LayerKey, Layer, LayerKeyHash> _layers;
+	std::vector<DpiBucket> _layerDpis; // every bucket in _layers, for InvalidateLayer
+	std::vector<LayerScope> _layerStack;
+
+	// Offscreen target and pending readbacks
+	struct StagingTexture
+	{
+		wrl::ComPtr<ID3D11Texture2D> texture;
+		ResourceCharge charge;
+	};
+
+	struct Readback
+	{
+		ReadbackId id;
+		StagingTexture staging;
+		void* pixels;
+		int stride;
+	};
+
+	wrl::ComPtr<ID3D11Texture2D>		_offscreenTexture;
+	wrl::ComPtr<ID2D1Bitmap1>			_offscreenBitmap;
+	ResourceCharge						_offscreenCharge;
+	std::vector<StagingTexture>			_freeStagingTextures;
+	std::vector<Readback>				_readbacks;
+	ReadbackId							_nextReadbackId{ 1 };
+	bool								_offscreen{ false };
+	float								_windowDpi{ 96.0f };
+
+	// Solid color brushes reused by frame brushes, recolored on every use
+	std::vector<wrl::ComPtr<ID2D1SolidColorBrush>> _frameSolidBrushes;
+	std::vector<ResourceCharge> _frameSolidBrushCharges;
+	size_t _frameSolidBrushCount{ 0 };
+
+	uint64_t _frameNumber{ 0 };
+
+	HWND _hwnd;
+	HDC _hdc;
+	PAINTSTRUCT _ps;
+
+	bool Present();
+	void TrimCaches();
+	ID2D1Brush* GetBrush( graphics::Brush& brush );
+	void FillRect( ID2D1Brush* d2dBrush, const RectF& rect );
+	void DrawRect( ID2D1Brush* d2dBrush, const RectF& rect, float strokeWidth );
+	void DrawTextLayout( const TextLayout& layout, ID2D1Brush* d2dBrush, const PointF& position );
+public:
+	static const char* Name() { return "DxDeviceContext"; }
+
+	DeviceContext( Device& device );
+	virtual ~DeviceContext();
+
+	void Resize( HWND hwnd );
+
+	std::unique_ptr<graphics::Brush> CreateSolidBrush( const ColorF& color ) override;
+	Brush& CreateFrameSolidBrush( const ColorF& color ) override;
+	TextLayout& CreateFrameTextLayout( StringView text, const graphics::TextFormat& format, const SizeF& sizeFit ) override;
+	
+	void BeginDraw( directui::Handle windowHandle ) override;
+	void BeginDraw( const directui::SizePx& sizePx, float dpi ) override;
+	void EndDraw() override;
+	PresentStatistics GetPresentStatistics() override;
+
+	ReadbackId QueueReadback( void* pixels, int stride ) override;
+	bool PollReadback( ReadbackId id, bool wait ) override;
+
+	RectF GetDrawRect() override;
+	float GetDpi() override;
+
+	void Clear( const ColorF& color ) override;
+	void FillRect( graphics::Brush& brush, const RectF& rect ) override;
+	void DrawRect( graphics::Brush& brush, const RectF& rect, float strokeWidth ) override;
+	void DrawTextLayout( const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position ) override;
+
+	// Overloads taking the backend types, used by Backend without downcasts.
+	void FillRect( Brush& brush, const RectF& rect );
+	void DrawRect( Brush& brush, const RectF& rect, float strokeWidth );
+	void DrawTextLayout( const TextLayout& layout, Brush& brush, const PointF& position );
+
+	void PushClip( const RectF& rect ) override;
+	void PopClip() override;
+
+	bool BeginLayer( LayerId id, const RectF& bounds ) override;
+	void EndLayer( const Matrix3x2F& transform, float opacity ) override;
+	void InvalidateLayer( LayerId id ) override;
+};
+
+inline void ThrowIfFailed( HRESULT hr )
+{
+	if ( FAILED( hr ) )
+	{
+		struct ComException
+		{
+			HRESULT const hr;
+			ComException( HRESULT const value ) : hr( value ) {}
+		};
+
+		if ( S_OK != hr )
+		{
+			throw ComException( hr );
+		}
+	}
+}
+
+CoInit::CoInit()
+{
+	ThrowIfFailed( ::CoInitializeEx( nullptr, COINIT_APARTMENTTHREADED ) );
+}
+
+CoInit::~CoInit()
+{
+	::CoUninitialize();
+}
+
+template< typename TCreate >
+StartupPhase MeasurePhase( const char* name, TCreate&& create )
+{
+	auto begin = std::chrono::steady_clock::now();
+	create();
+	return StartupPhase{ name, begin, std::chrono::steady_clock::now() - begin };
+}
+
+Device::Device()
+	: _d3dFeatureLevel{ D3D_FEATURE_LEVEL_9_1 }
+{
+	// The D3D device does not depend on the factories, it is created on another thread meanwhile.
+	auto d3dPhase = std::async( std::launch::async, [this] { return MeasurePhase( "D3D device", [this] { CreateDevice(); } ); } );
+	_startupPhases.push_back( MeasurePhase( "D2D and DirectWrite factories", [this] { CreateIndependent(); } ) );
+	_startupPhases.push_back( d3dPhase.get() );
+	_startupPhases.push_back( MeasurePhase( "D2D device", [this] { CreateD2DDevice(); } ) );
+}
+
+Device::~Device()
+{
+
+}
+
+std::unique_ptr<graphics::DeviceContext> Device::CreateDeviceContext()
+{
+	return std::unique_ptr<graphics::DeviceContext>( new DeviceContext( *this ) );
+}
+
+std::unique_ptr<graphics::TextFormat> Device::CreateTextFormat( const String& fontFamily, float height )
+{
+	wrl::ComPtr<IDWriteTextFormat> textFormat;
+	ThrowIfFailed( _dwriteFactory->CreateTextFormat( fontFamily.c_str(), nullptr,
+		DWRITE_FONT_WEIGHT_NORMAL,
+		DWRITE_FONT_STYLE_NORMAL,
+		DWRITE_FONT_STRETCH_NORMAL,
+		height, L"", &textFormat ) );
+	return std::unique_ptr<graphics::TextFormat>( new TextFormat{ std::move( textFormat ) } );
+}
+
+std::unique_ptr<graphics::TextLayout> Device::CreateTextLayout( StringView text, const graphics::TextFormat& format, const SizeF& sizeFit )
+{
+	if ( auto pFormat = format.As<TextFormat>() )
+	{
+		wrl::ComPtr<IDWriteTextLayout> textLayout;
+		ThrowIfFailed( _dwriteFactory->CreateTextLayout( text.data(), static_cast< UINT32 >( text.length() ),
+			pFormat->Get(), sizeFit.w, sizeFit.h, &textLayout ) );
+		return std::unique_ptr<graphics::TextLayout>( new TextLayout{ std::move( textLayout ),
+			ResourceCharge{ _resources, ResourceType::TextLayout, EstimateTextLayoutBytes( text.length() ) } } );
+	}
+	return nullptr;
+}
+
+std::unique_ptr<graphics::Brush> Device::CreateSolidBrush( const ColorF& color )
+{
+	// Created up front, a lazily built brush could be built by two render threads at once.
+	wrl::ComPtr<ID2D1SolidColorBrush> brush;
+	ThrowIfFailed( _d2dResourceContext->CreateSolidColorBrush( D2D1::ColorF( color.r, color.g, color.b, color.a ), &brush ) );
+	return std::unique_ptr<graphics::Brush>( new Brush( wrl::ComPtr<ID2D1Brush>( brush.Get() ),
+		ResourceCharge{ _resources, ResourceType::Brush, k_BrushBytes } ) );
+}
+
+std::shared_ptr<const GradientStopCollection> Device::GetGradientStopCollection( const GradientStops& stops )
+{
+	return _gradientCache.GetOrCreate( stops, [this] ( const GradientStops& stops ) {
+		std::vector<D2D1_GRADIENT_STOP> d2dStops;
+		d2dStops.reserve( stops.stops.size() );
+		for ( const auto& stop : stops.stops )
+		{
+			d2dStops.push_back( D2D1::GradientStop( stop.position, D2D1::ColorF( stop.color.r, stop.color.g, stop.color.b, stop.color.a ) ) );
+		}
+
+		D2D1_EXTEND_MODE extend;
+		switch ( stops.extend )
+		{
+			case GradientExtend::Repeat:	extend = D2D1_EXTEND_MODE_WRAP; break;
+			case GradientExtend::Mirror:	extend = D2D1_EXTEND_MODE_MIRROR; break;
+			default:						extend = D2D1_EXTEND_MODE_CLAMP; break;
+		}
+
+		std::unique_ptr<GradientStopCollection> entry{ new GradientStopCollection{} };
+		ThrowIfFailed( _d2dResourceContext->CreateGradientStopCollection( d2dStops.data(), static_cast< UINT32 >( d2dStops.size() ),
+			D2D1_GAMMA_2_2, extend, &entry->collection ) );
+		entry->charge = ResourceCharge{ _resources, ResourceType::Brush, k_GradientStopCollectionBytes };
+		return entry.release();
+	} );
+}
+
+std::unique_ptr<graphics::GradientBrush> Device::CreateGradientBrush( const LinearGradient& gradient, const GradientStops& stops )
+{
+	return std::unique_ptr<graphics::GradientBrush>( new GradientBrush{ *this, gradient, stops } );
+}
+
+std::unique_ptr<graphics::GradientBrush> Device::CreateGradientBrush( const RadialGradient& gradient, const GradientStops& stops )
+{
+	return std::unique_ptr<graphics::GradientBrush>( new GradientBrush{ *this, gradient, stops } );
+}
+
+void GradientBrush::CreateBrush()
+{
+	_stopCollection = _device.GetGradientStopCollection( GetStops() );
+	_linearBrush = nullptr;
+	_radialBrush = nullptr;
+
+	auto properties = D2D1::BrushProperties( 1.0f, ToD2DMatrix( GetTransform() ) );
+	if ( GetType() == GradientType::Linear )
+	{
+		const auto& linear = GetLinear();
+		ThrowIfFailed( _device._d2dResourceContext->CreateLinearGradientBrush(
+			D2D1::LinearGradientBrushProperties( D2D1::Point2F( linear.start.x, linear.start.y ), D2D1::Point2F( linear.end.x, linear.end.y ) ),
+			properties, _stopCollection->collection.Get(), &_linearBrush ) );
+	}
+	else
+	{
+		const auto& radial = GetRadial();
+		ThrowIfFailed( _device._d2dResourceContext->CreateRadialGradientBrush(
+			D2D1::RadialGradientBrushProperties( D2D1::Point2F( radial.center.x, radial.center.y ), D2D1::Point2F( 0, 0 ), radial.radiusX, radial.radiusY ),
+			properties, _stopCollection->collection.Get(), &_radialBrush ) );
+	}
+}
+
+void GradientBrush::OnGeometryChanged()
+{
+	if ( _linearBrush != nullptr )
+	{
+		const auto& linear = GetLinear();
+		_linearBrush->SetStartPoint( D2D1::Point2F( linear.start.x, linear.start.y ) );
+		_linearBrush->SetEndPoint( D2D1::Point2F( linear.end.x, linear.end.y ) );
+		_linearBrush->SetTransform( ToD2DMatrix( GetTransform() ) );
+	}
+	else if ( _radialBrush != nullptr )
+	{
+		const auto& radial = GetRadial();
+		_radialBrush->SetCenter( D2D1::Point2F( radial.center.x, radial.center.y ) );
+		_radialBrush->SetRadiusX( radial.radiusX );
+		_radialBrush->SetRadiusY( radial.radiusY );
+		_radialBrush->SetTransform( ToD2DMatrix( GetTransform() ) );
+	}
+}
+
+TextMetrics Device::MeasureText( StringView text, const graphics::TextFormat& format, float maxWidth )
+{
+	auto pFormat = format.As<TextFormat>();
+	if ( pFormat == nullptr )
+		return TextMetrics{};
+
+	TextMetrics metrics;
+	if ( pFormat->GetMeasurer( *_dwriteFactory.Get() ).Measure( text, maxWidth, metrics ) )
+		return metrics;
+
+	wrl::ComPtr<IDWriteTextLayout> textLayout;
+	ThrowIfFailed( _dwriteFactory->CreateTextLayout( text.data(), static_cast< UINT32 >( text.length() ),
+		pFormat->Get(), std::min( maxWidth, FLT_MAX ), FLT_MAX, &textLayout ) );
+
+	DWRITE_TEXT_METRICS layoutMetrics;
+	ThrowIfFailed( textLayout->GetMetrics( &layoutMetrics ) );
+	return TextMetrics{ layoutMetrics.width, layoutMetrics.height, layoutMetrics.lineCount };
+}
+
+TextMeasurer::TextMeasurer( IDWriteFactory2& factory, IDWriteTextFormat& format )
+{
+	_wordWrap = format.GetWordWrapping() != DWRITE_WORD_WRAPPING_NO_WRAP;
+
+	wrl::ComPtr<IDWriteFontCollection> collection;
+	format.GetFontCollection( &collection );
+	if ( collection == nullptr )
+	{
+		ThrowIfFailed( factory.GetSystemFontCollection( &collection ) );
+	}
+
+	std::wstring familyName( format.GetFontFamilyNameLength() + 1, L'\0' );
+	ThrowIfFailed( format.GetFontFamilyName( &familyName[ 0 ], static_cast< UINT32 >( familyName.size() ) ) );
+
+	UINT32 familyIndex = 0;
+	BOOL exists = FALSE;
+	if ( FAILED( collection->FindFamilyName( familyName.c_str(), &familyIndex, &exists ) ) || !exists )
+		return; // font fallback decides the face, always use the full layout
+
+	wrl::ComPtr<IDWriteFontFamily> family;
+	wrl::ComPtr<IDWriteFont> font;
+	ThrowIfFailed( collection->GetFontFamily( familyIndex, &family ) );
+	ThrowIfFailed( family->GetFirstMatchingFont( format.GetFontWeight(), format.GetFontStretch(), format.GetFontStyle(), &font ) );
+	ThrowIfFailed( font->CreateFontFace( &_fontFace ) );
+
+	DWRITE_FONT_METRICS fontMetrics;
+	_fontFace->GetMetrics( &fontMetrics );
+	float scale = format.GetFontSize() / fontMetrics.designUnitsPerEm;
+	_lineHeight = ( fontMetrics.ascent + fontMetrics.descent + fontMetrics.lineGap ) * scale;
+
+	std::vector<UINT32> codePoints( k_TableSize );
+	for ( UINT32 i = 0; i < k_TableSize; ++i )
+	{
+		codePoints[ i ] = i;
+	}
+
+	std::vector<UINT16> glyphIndices( k_TableSize );
+	std::vector<DWRITE_GLYPH_METRICS> glyphMetrics( k_TableSize );
+	ThrowIfFailed( _fontFace->GetGlyphIndices( codePoints.data(), k_TableSize, glyphIndices.data() ) );
+	ThrowIfFailed( _fontFace->GetDesignGlyphMetrics( glyphIndices.data(), k_TableSize, glyphMetrics.data(), FALSE ) );
+
+	// Negative advance marks characters that need the full layout.
+	_advances.resize( k_TableSize, -1.0f );
+	for ( UINT32 i = 0x20; i < k_TableSize; ++i )
+	{
+		if ( glyphIndices[ i ] != 0 )
+		{
+			_advances[ i ] = glyphMetrics[ i ].advanceWidth * scale;
+		}
+	}
+	_spaceAdvance = _advances[ L' ' ];
+}
+
+bool TextMeasurer::MeasureLine( const wchar_t* begin, const wchar_t* end, float& width ) const
+{
+	// Trailing whitespace is not part of the width, same as DWRITE_TEXT_METRICS::width.
+	while ( end > begin && end[ -1 ] == L' ' )
+	{
+		--end;
+	}
+
+	width = 0;
+	for ( auto it = begin; it != end; ++it )
+	{
+		auto ch = static_cast< UINT32 >( *it );
+		if ( ch >= k_TableSize || _advances[ ch ] < 0 )
+			return false;
+		width += _advances[ ch ];
+	}
+	return true;
+}
+
+bool TextMeasurer::WrapLine( const wchar_t* begin, const wchar_t* end, float maxWidth, float& width, uint32_t& lineCount ) const
+{
+	// Greedy word wrap at spaces, words wider than maxWidth would need emergency breaks.
+	float lineWidth = 0;
+	bool lineEmpty = true;
+	for ( auto wordBegin = begin; ; )
+	{
+		auto wordEnd = std::find( wordBegin, end, L' ' );
+
+		float wordWidth;
+		if ( !MeasureLine( wordBegin, wordEnd, wordWidth ) || wordWidth > maxWidth )
+			return false;
+
+		float widthWithWord = lineEmpty ? wordWidth : lineWidth + _spaceAdvance + wordWidth;
+		if ( !lineEmpty && wordWidth > 0 && widthWithWord > maxWidth )
+		{
+			width = std::max( width, lineWidth );
+			lineCount++;
+			lineWidth = wordWidth;
+		}
+		else
+		{
+			lineWidth = widthWithWord;
+		}
+		lineEmpty = false;
+
+		if ( wordEnd == end )
+			break;
+		wordBegin = wordEnd + 1;
+	}
+
+	width = std::max( width, lineWidth );
+	lineCount++;
+	return true;
+}
+
+bool TextMeasurer::Measure( StringView text, float maxWidth, TextMetrics& metrics )
+{
+	if ( !IsAvailable() )
+		return false;
+
+	// Looked up by a reused key, heterogeneous lookup of unordered_map needs C++20 and the
+	// replay tool builds as C++17. The key only allocates when a longer text comes along.
+	thread_local String t_key;
+	t_key.assign( text.data(), text.length() );
+
+	{
+		std::lock_guard<std::mutex> lock{ _widthCacheMutex };
+		auto cached = _widthCache.find( t_key );
+		if ( cached != _widthCache.end() && cached->second <= maxWidth )
+		{
+			metrics = TextMetrics{ cached->second, _lineHeight, 1 };
+			return true;
+		}
+	}
+
+	float width = 0;
+	uint32_t lineCount = 0;
+	bool singleLine = true;
+
+	auto begin = text.data();
+	auto end = begin + text.length();
+	for ( auto lineBegin = begin; ; )
+	{
+		auto lineEnd = std::find( lineBegin, end, L'\n' );
+		singleLine = singleLine && lineEnd == end;
+
+		float lineWidth;
+		if ( !MeasureLine( lineBegin, lineEnd, lineWidth ) )
+			return false;
+
+		if ( lineWidth <= maxWidth || !_wordWrap )
+		{
+			width = std::max( width, lineWidth );
+			lineCount++;
+		}
+		else if ( !WrapLine( lineBegin, lineEnd, maxWidth, width, lineCount ) )
+		{
+			return false;
+		}
+
+		if ( lineEnd == end )
+			break;
+		lineBegin = lineEnd + 1;
+	}
+
+	if ( singleLine && lineCount == 1 )
+	{
+		std::lock_guard<std::mutex> lock{ _widthCacheMutex };
+		if ( _widthCache.size() >= k_MaxCachedWidths )
+		{
+			_widthCache.clear();
+		}
+		_widthCache.emplace( t_key, width );
+	}
+
+	metrics = TextMetrics{ width, lineCount * _lineHeight, lineCount };
+	return true;
+}
+
+void Device::CreateIndependent()
+{
+	// Initialize Direct2D resources.
+	D2D1_FACTORY_OPTIONS options;
+	::ZeroMemory( &options, sizeof( D2D1_FACTORY_OPTIONS ) );
+
+#if defined(_DEBUG)
+	// If the project is in a debug build, enable Direct2D debugging via SDK Layers.
+	options.debugLevel = D2D1_DEBUG_LEVEL_INFORMATION;
+#endif
+
+	// Initialize the Direct2D Factory.
+	ThrowIfFailed(
+		::D2D1CreateFactory(
+			D2D1_FACTORY_TYPE_MULTI_THREADED,
+			__uuidof( ID2D1Factory2 ),
+			&options,
+			&_d2dFactory
+		)
+	);
+
+	// Initialize the DirectWrite Factory.
+	ThrowIfFailed(
+		::DWriteCreateFactory(
+			DWRITE_FACTORY_TYPE_ISOLATED,
+			__uuidof( IDWriteFactory2 ),
+			&_dwriteFactory
+		)
+	);
+
+}
+
+IWICImagingFactory2* Device::GetWicFactory()
+{
+	// Retried on the next call when creation throws.
+	std::call_once( _wicCreated, [this] {
+		ThrowIfFailed(
+			::CoCreateInstance(
+				CLSID_WICImagingFactory2,
+				nullptr,
+				CLSCTX_INPROC_SERVER,
+				IID_PPV_ARGS( &_wicFactory )
+			)
+		);
+	} );
+	return _wicFactory.Get();
+}
+
+#if defined(_DEBUG)
+// Check for SDK Layer support.
+inline bool SdkLayersAvailable()
+{
+	HRESULT hr = D3D11CreateDevice(
+		nullptr,
+		D3D_DRIVER_TYPE_NULL,       // There is no need to create a real hardware device.
+		0,
+		D3D11_CREATE_DEVICE_DEBUG,  // Check for the SDK layers.
+		nullptr,                    // Any feature level will do.
+		0,
+		D3D11_SDK_VERSION,          // Always set this to D3D11_SDK_VERSION for Windows Store apps.
+		nullptr,                    // No need to keep the D3D device reference.
+		nullptr,                    // No need to know the feature level.
+		nullptr                     // No need to keep the D3D device context reference.
+	);
+
+	return SUCCEEDED( hr );
+}
+#endif
+
+void Device::CreateDevice()
+{
+	// This flag adds support for surfaces with a different color channel ordering
+	// than the API default. It is required for compatibility with Direct2D.
+	UINT creationFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+
+#if defined(_DEBUG)
+	if ( SdkLayersAvailable() )
+	{
+		// If the project is in a debug build, enable debugging via SDK Layers with this flag.
+		creationFlags |= D3D11_CREATE_DEVICE_DEBUG;
+	}
+#endif
+
+	// This array defines the set of DirectX hardware feature levels this app will support.
+	// Note the ordering should be preserved.
+	// Don't forget to declare your application's minimum required feature level in its
+	// description.  All applications are assumed to support 9.1 unless otherwise stated.
+	D3D_FEATURE_LEVEL featureLevels[] =
+	{
+		//D3D_FEATURE_LEVEL_12_0,
+		D3D_FEATURE_LEVEL_11_1,
+		D3D_FEATURE_LEVEL_11_0,
+		D3D_FEATURE_LEVEL_10_1,
+		D3D_FEATURE_LEVEL_10_0,
+		D3D_FEATURE_LEVEL_9_3,
+		D3D_FEATURE_LEVEL_9_2,
+		D3D_FEATURE_LEVEL_9_1
+	};
+
+	// Create the Direct3D 11 API device object and a corresponding context.
+	wrl::ComPtr<ID3D11Device> device;
+	wrl::ComPtr<ID3D11DeviceContext> context;
+
+	HRESULT hr = ::D3D11CreateDevice(
+		nullptr,                    // Specify nullptr to use the default adapter.
+		D3D_DRIVER_TYPE_HARDWARE,   // Create a device using the hardware graphics driver.
+		0,                          // Should be 0 unless the driver is D3D_DRIVER_TYPE_SOFTWARE.
+		creationFlags,              // Set debug and Direct2D compatibility flags.
+		featureLevels,              // List of feature levels this app can support.
+		ARRAYSIZE( featureLevels ), // Size of the list above.
+		D3D11_SDK_VERSION,          // Always set this to D3D11_SDK_VERSION for Windows Store apps.
+		&device,                    // Returns the Direct3D device created.
+		&_d3dFeatureLevel,          // Returns feature level of device created.
+		&context                    // Returns the device immediate context.
+	);
+
+	if ( FAILED( hr ) )
+	{
+		// If the initialization fails, fall back to the WARP device.
+		// For more information on WARP, see: 
+		// http://go.microsoft.com/fwlink/?LinkId=286690
+		ThrowIfFailed(
+			::D3D11CreateDevice(
+				nullptr,
+				D3D_DRIVER_TYPE_WARP, // Create a WARP device instead of a hardware device.
+				0,
+				creationFlags,
+				featureLevels,
+				ARRAYSIZE( featureLevels ),
+				D3D11_SDK_VERSION,
+				&device,
+				&_d3dFeatureLevel,
+				&context
+			)
+		);
+	}
+
+	// Store pointers to the Direct3D 11.1 API device and immediate context.
+	ThrowIfFailed(
+		device.As( &_d3dDevice )
+	);
+
+	ThrowIfFailed(
+		context.As( &_d3dContext )
+	);
+}
+
+void Device::CreateD2DDevice()
+{
+	// Create the Direct2D device object and a corresponding context.
+	wrl::ComPtr<IDXGIDevice3> dxgiDevice;
+	ThrowIfFailed(
+		_d3dDevice.As( &dxgiDevice )
+	);
+
+	ThrowIfFailed(
+		_d2dFactory->CreateDevice( dxgiDevice.Get(), &_d2dDevice )
+	);
+
+	ThrowIfFailed(
+		_d2dFactory.As( &_d2dMultithread )
+	);
+
+	ThrowIfFailed(
+		_d2dDevice->CreateDeviceContext( D2D1_DEVICE_CONTEXT_OPTIONS_NONE, &_d2dResourceContext )
+	);
+}
+
+DeviceContext::DeviceContext( Device& device )
+	: graphics::DeviceContext{ Name(), &device._resources }
+	, _device{ device }
+	, _viewport{}
+	, _d3dRenderTargetSize{}
+	, _hwnd{ nullptr }
+{
+	ThrowIfFailed(
+		_device._d2dDevice->CreateDeviceContext(
+			D2D1_DEVICE_CONTEXT_OPTIONS_NONE,
+			&_d2dContext
+		)
+	);
+}
+
+DeviceContext::~DeviceContext()
+{
+	if ( _frameLatencyWaitable != nullptr )
+		::CloseHandle( _frameLatencyWaitable );
+}
+
+void DeviceContext::Resize( HWND hwnd )
+{
+	RECT rc;
+	::GetClientRect( hwnd, &rc );
+
+	auto width = static_cast< float >( std::max( 1L, rc.right ) );
+	auto height = static_cast< float >( std::max( 1L, rc.bottom ) );
+	auto dpi = static_cast< float >( ::GetDpiForWindow( hwnd ) );
+
+	auto depthBuffer = _budget.depthBuffer;
+	if ( _hwnd == hwnd && width == _d3dRenderTargetSize.w && height == _d3dRenderTargetSize.h &&
+		( _d3dDepthStencilView != nullptr ) == depthBuffer )
+	{
+		// Moving to a monitor of another scale can keep the pixel size, the buffers stay.
+		if ( dpi != _windowDpi )
+		{
+			_windowDpi = dpi;
+			_d2dContext->SetDpi( _windowDpi, _windowDpi );
+		}
+		return;
+	}
+
+	_hwnd = hwnd;
+
+	D3DContextLock lock{ _device._d2dMultithread.Get() };
+
+	// Clear the previous window size specific context.
+	ID3D11RenderTargetView* nullViews[] = { nullptr };
+	_device._d3dContext->OMSetRenderTargets( ARRAYSIZE( nullViews ), nullViews, nullptr );
+	_d3dRenderTargetView = nullptr;
+	_d2dContext->SetTarget( nullptr );
+	_d2dTargetBitmap = nullptr;
+	_d3dDepthStencilView = nullptr;
+	_depthBufferCharge.Reset();
+	_device._d3dContext->Flush();
+	
+	_d3dRenderTargetSize.w = width;
+	_d3dRenderTargetSize.h = height;
+
+	if ( _swapChain != nullptr )
+	{
+		// If the swap chain already exists, resize it.
+		HRESULT hr = _swapChain->ResizeBuffers(
+			2, // Double-buffered swap chain.
+			static_cast< UINT >( _d3dRenderTargetSize.w ),
+			static_cast< UINT >( _d3dRenderTargetSize.h ),
+			DXGI_FORMAT_B8G8R8A8_UNORM,
+			DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT
+		);
+
+		if ( hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET )
+		{
+			// If the device was removed for any reason, a new device and swap chain will need to be created.
+			//HandleDeviceLost();
+
+			// Everything is set up now. Do not continue execution of this method. HandleDeviceLost will reenter this method
+			// and correctly set up the new device.
+			return;
+		}
+		else
+		{
+			ThrowIfFailed( hr );
+		}
+	}
+	else
+	{
+		// Otherwise, create a new one using the same adapter as the existing Direct3D device.
+		DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
+		swapChainDesc.Width = static_cast< UINT >( _d3dRenderTargetSize.w ); // Match the size of the window.
+		swapChainDesc.Height = static_cast< UINT >( _d3dRenderTargetSize.h );
+		swapChainDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM; // This is the most common swap chain format.
+		swapChainDesc.Stereo = false;
+		swapChainDesc.SampleDesc.Count = 1; // Don't use multi-sampling.
+		swapChainDesc.SampleDesc.Quality = 0;
+		swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+		swapChainDesc.BufferCount = 2; // Use double-buffering to minimize latency.
+		swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL; // All Windows Store apps must use this SwapEffect.
+		swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+		swapChainDesc.Scaling = DXGI_SCALING_STRETCH;
+		swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_PREMULTIPLIED;
+
+		// This sequence obtains the DXGI factory that was used to create the Direct3D device above.
+		wrl::ComPtr<IDXGIDevice3> dxgiDevice;
+		ThrowIfFailed(
+			_device._d3dDevice.As( &dxgiDevice )
+		);
+
+		wrl::ComPtr<IDXGIAdapter> dxgiAdapter;
+		ThrowIfFailed(
+			dxgiDevice->GetAdapter( &dxgiAdapter )
+		);
+
+		wrl::ComPtr<IDXGIFactory2> dxgiFactory;
+		ThrowIfFailed(
+			dxgiAdapter->GetParent( IID_PPV_ARGS( &dxgiFactory ) )
+		);
+
+		ThrowIfFailed(
+			dxgiFactory->CreateSwapChainForComposition(
+				_device._d3dDevice.Get(),
+				&swapChainDesc,
+				nullptr,
+				&_swapChain
+			)
+		);
+
+		// Frames are throttled by waiting on this handle in BeginDraw, outside the context lock,
+		// so Present does not block until VSync while other windows wait for the lock.
+		wrl::ComPtr<IDXGISwapChain2> swapChain2;
+		ThrowIfFailed( _swapChain.As( &swapChain2 ) );
+		ThrowIfFailed( swapChain2->SetMaximumFrameLatency( 1 ) );
+		_frameLatencyWaitable = swapChain2->GetFrameLatencyWaitableObject();
+
+		// Create the DirectComposition device
+		ThrowIfFailed( DCompositionCreateDevice(
+			nullptr,
+			IID_PPV_ARGS( &_dcompDevice ) ) );
+
+		// Create a DirectComposition target associated with the window (pass in hWnd here)
+		ThrowIfFailed( _dcompDevice->CreateTargetForHwnd(
+			_hwnd,
+			true,
+			&_dcompTarget ) );
+
+		// Create a DirectComposition "visual"
+		ThrowIfFailed( _dcompDevice->CreateVisual( &_dcompVisual ) );
+
+		// Associate the visual with the swap chain
+		ThrowIfFailed( _dcompVisual->SetContent( _swapChain.Get() ) );
+
+		// Set the visual as the root of the DirectComposition target's composition tree
+		ThrowIfFailed( _dcompTarget->SetRoot( _dcompVisual.Get() ) );
+		ThrowIfFailed( _dcompDevice->Commit() );
+	}
+
+
+	// Create a render target view of the swap chain back buffer.
+	wrl::ComPtr<ID3D11Texture2D> backBuffer;
+	ThrowIfFailed(
+		_swapChain->GetBuffer( 0, IID_PPV_ARGS( &backBuffer ) )
+	);
+
+	ThrowIfFailed(
+		_device._d3dDevice->CreateRenderTargetView(
+			backBuffer.Get(),
+			nullptr,
+			&_d3dRenderTargetView
+		)
+	);
+
+	auto pixelCount = static_cast< uint64_t >( _d3dRenderTargetSize.w ) * static_cast< uint64_t >( _d3dRenderTargetSize.h );
+	_swapChainCharge = ResourceCharge{ _resources, ResourceType::SwapChain, pixelCount * 4 * 2 };
+
+	// Create a depth stencil view for use with 3D rendering if needed.
+	if ( depthBuffer )
+	{
+		CD3D11_TEXTURE2D_DESC depthStencilDesc(
+			DXGI_FORMAT_D24_UNORM_S8_UINT,
+			static_cast< UINT >( _d3dRenderTargetSize.w ),
+			static_cast< UINT >( _d3dRenderTargetSize.h ),
+			1, // This depth stencil view has only one texture.
+			1, // Use a single mipmap level.
+			D3D11_BIND_DEPTH_STENCIL
+		);
+
+		wrl::ComPtr<ID3D11Texture2D> depthStencil;
+		ThrowIfFailed(
+			_device._d3dDevice->CreateTexture2D(
+				&depthStencilDesc,
+				nullptr,
+				&depthStencil
+			)
+		);
+
+		CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc( D3D11_DSV_DIMENSION_TEXTURE2D );
+		ThrowIfFailed(
+			_device._d3dDevice->CreateDepthStencilView(
+				depthStencil.Get(),
+				&depthStencilViewDesc,
+				&_d3dDepthStencilView
+			)
+		);
+
+		_depthBufferCharge = ResourceCharge{ _resources, ResourceType::DepthBuffer, pixelCount * 4 };
+	}
+
+	// Create a Direct2D target bitmap associated with the
+	// swap chain back buffer and set it as the current target.
+	D2D1_BITMAP_PROPERTIES1 bitmapProperties =
+		D2D1::BitmapProperties1(
+			D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
+			D2D1::PixelFormat( DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED ),
+			96.0f,
+			96.0f
+		);
+
+	wrl::ComPtr<IDXGISurface2> dxgiBackBuffer;
+	ThrowIfFailed(
+		_swapChain->GetBuffer( 0, IID_PPV_ARGS( &dxgiBackBuffer ) )
+	);
+
+	ThrowIfFailed(
+		_d2dContext->CreateBitmapFromDxgiSurface(
+			dxgiBackBuffer.Get(),
+			&bitmapProperties,
+			&_d2dTargetBitmap
+		)
+	);
+
+	_windowDpi = dpi;
+	_d2dContext->SetTarget( _d2dTargetBitmap.Get() );
+	_d2dContext->SetDpi( _windowDpi, _windowDpi );
+}
+
+bool DeviceContext::Present()
+{
+	D3DContextLock lock{ _device._d2dMultithread.Get() };
+
+	// The first argument synchronizes presentation with VSync. BeginDraw waited for the
+	// frame latency object, so the queue has room and Present returns without blocking.
+	HRESULT hr = _swapChain->Present( 1, 0 );
+
+	// Discard the contents of the render target.
+	// This is a valid operation only when the existing contents will be entirely
+	// overwritten. If dirty or scroll rects are used, this call should be removed.
+	_device._d3dContext->DiscardView( _d3dRenderTargetView.Get() );
+
+	// Discard the contents of the depth stencil.
+	if ( _d3dDepthStencilView != nullptr )
+		_device._d3dContext->DiscardView( _d3dDepthStencilView.Get() );
+
+	// If the device was removed either by a disconnection or a driver upgrade, we
+	// must recreate all device resources.
+	if ( hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET )
+	{
+		//HandleDeviceLost();
+	}
+	else if ( hr == DXGI_STATUS_OCCLUDED )
+	{
+		return false;
+	}
+	else
+	{
+		ThrowIfFailed( hr );
+	}
+	return true;
+}
+
+std::unique_ptr<graphics::Brush> DeviceContext::CreateSolidBrush( const ColorF& color )
+{
+	return std::unique_ptr<graphics::Brush>( new Brush( 
+		[color] ( ID2D1DeviceContext1& d2dContext, wrl::ComPtr<ID2D1Brush>& outBrush ) {
+			
+			wrl::ComPtr<ID2D1SolidColorBrush> brush;
+			d2dContext.CreateSolidColorBrush(
+				D2D1::ColorF( color.r, color.g, color.b, color.a ),
+				&brush );
+			ThrowIfFailed( brush.As( &outBrush ) );
+		}, ResourceCharge{ _device._resources, ResourceType::Brush, k_BrushBytes } ) );
+}
+
+Brush& DeviceContext::CreateFrameSolidBrush( const ColorF& color )
+{
+	auto d2dColor = D2D1::ColorF( color.r, color.g, color.b, color.a );
+
+	if ( _frameSolidBrushCount == _frameSolidBrushes.size() )
+	{
+		wrl::ComPtr<ID2D1SolidColorBrush> brush;
+		ThrowIfFailed( _d2dContext->CreateSolidColorBrush( d2dColor, &brush ) );
+		_frameSolidBrushes.push_back( std::move( brush ) );
+		_frameSolidBrushCharges.emplace_back( _resources, ResourceType::Brush, k_BrushBytes );
+	}
+	else
+	{
+		_frameSolidBrushes[ _frameSolidBrushCount ]->SetColor( d2dColor );
+	}
+
+	auto& solidBrush = _frameSolidBrushes[ _frameSolidBrushCount++ ];
+	return *_frameArena.New<Brush>( wrl::ComPtr<ID2D1Brush>( solidBrush.Get() ) );
+}
+
+TextLayout& DeviceContext::CreateFrameTextLayout( StringView text, const graphics::TextFormat& format, const SizeF& sizeFit )
+{
+	auto pFormat = format.As<TextFormat>();
+	if ( pFormat == nullptr )
+	{
+		throw std::invalid_argument( "TextFormat was not created by this device" );
+	}
+
+	wrl::ComPtr<IDWriteTextLayout> textLayout;
+	ThrowIfFailed( _device._dwriteFactory->CreateTextLayout( text.data(), static_cast< UINT32 >( text.length() ),
+		pFormat->Get(), sizeFit.w, sizeFit.h, &textLayout ) );
+	return *_frameArena.New<TextLayout>( std::move( textLayout ),
+		ResourceCharge{ _resources, ResourceType::TextLayout, EstimateTextLayoutBytes( text.length() ) } );
+}
+
+void DeviceContext::BeginDraw(directui::Handle windowHandle)
+{
+	_frameArena.Reset();
+	_frameSolidBrushCount = 0;
+	_frameNumber++;
+	TrimCaches();
+
+	Resize( static_cast< HWND >( windowHandle ) );
+
+	// Sleeps until the swap chain can take another frame, at most one frame is queued.
+	if ( _frameLatencyWaitable != nullptr )
+		::WaitForSingleObjectEx( _frameLatencyWaitable, 1000, TRUE );
+
+	if ( _offscreen )
+	{
+		_offscreen = false;
+		_d2dContext->SetTarget( _d2dTargetBitmap.Get() );
+		_d2dContext->SetDpi( _windowDpi, _windowDpi );
+	}
+
+	//_hdc = ::BeginPaint( _hwnd, &_ps );
+
+	// Set the 3D rendering viewport to target the entire window.
+	_viewport = CD3D11_VIEWPORT(
+		0.0f,
+		0.0f,
+		_d3dRenderTargetSize.w,
+		_d3dRenderTargetSize.h
+	);
+
+	{
+		D3DContextLock lock{ _device._d2dMultithread.Get() };
+		_device._d3dContext->RSSetViewports( 1, &_viewport );
+	}
+
+	_d2dContext->BeginDraw();
+}
+
+void DeviceContext::BeginDraw( const directui::SizePx& sizePx, float dpi )
+{
+	_frameArena.Reset();
+	_frameSolidBrushCount = 0;
+	_frameNumber++;
+	TrimCaches();
+
+	auto width = static_cast< UINT >( std::max( 1, sizePx.w ) );
+	auto height = static_cast< UINT >( std::max( 1, sizePx.h ) );
+
+	D3D11_TEXTURE2D_DESC desc{};
+	if ( _offscreenTexture != nullptr )
+	{
+		_offscreenTexture->GetDesc( &desc );
+	}
+
+	if ( _offscreenTexture == nullptr || desc.Width != width || desc.Height != height )
+	{
+		_offscreenBitmap = nullptr;
+		_offscreenTexture = nullptr;
+		_offscreenCharge.Reset();
+
+		CD3D11_TEXTURE2D_DESC textureDesc(
+			DXGI_FORMAT_B8G8R8A8_UNORM,
+			width,
+			height,
+			1, // One texture.
+			1, // Use a single mipmap level.
+			D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE
+		);
+
+		ThrowIfFailed(
+			_device._d3dDevice->CreateTexture2D( &textureDesc, nullptr, &_offscreenTexture )
+		);
+
+		wrl::ComPtr<IDXGISurface2> dxgiSurface;
+		ThrowIfFailed(
+			_offscreenTexture.As( &dxgiSurface )
+		);
+
+		D2D1_BITMAP_PROPERTIES1 bitmapProperties =
+			D2D1::BitmapProperties1(
+				D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
+				D2D1::PixelFormat( DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED ),
+				96.0f,
+				96.0f
+			);
+
+		ThrowIfFailed(
+			_d2dContext->CreateBitmapFromDxgiSurface( dxgiSurface.Get(), &bitmapProperties, &_offscreenBitmap )
+		);
+
+		_offscreenCharge = ResourceCharge{ _resources, ResourceType::Bitmap, static_cast< uint64_t >( width ) * height * 4 };
+	}
+
+	_offscreen = true;
+	_d2dContext->SetTarget( _offscreenBitmap.Get() );
+	_d2dContext->SetDpi( dpi, dpi );
+
+	_viewport = CD3D11_VIEWPORT( 0.0f, 0.0f, static_cast< float >( width ), static_cast< float >( height ) );
+
+	_d2dContext->BeginDraw();
+}
+
+void DeviceContext::EndDraw()
+{
+	auto hr = _d2dContext->EndDraw();
+	if ( !_offscreen )
+	{
+		Present();
+	}
+
+	//::EndPaint( _hwnd, &_ps );
+}
+
+PresentStatistics DeviceContext::GetPresentStatistics()
+{
+	PresentStatistics statistics;
+	if ( _offscreen || _swapChain == nullptr )
+		return statistics;
+
+	UINT presentCount = 0;
+	if ( SUCCEEDED( _swapChain->GetLastPresentCount( &presentCount ) ) )
+		statistics.presentCount = presentCount;
+
+	// Fails until the first present reached the screen and after mode changes.
+	DXGI_FRAME_STATISTICS frameStatistics;
+	if ( SUCCEEDED( _swapChain->GetFrameStatistics( &frameStatistics ) ) && frameStatistics.PresentCount != 0 )
+	{
+		// steady_clock of MSVC counts QueryPerformanceCounter ticks, converted to nanoseconds.
+		LARGE_INTEGER frequency;
+		::QueryPerformanceFrequency( &frequency );
+		auto ticks = frameStatistics.SyncQPCTime.QuadPart;
+		auto nanoseconds = ticks / frequency.QuadPart * 1000000000 + ticks % frequency.QuadPart * 1000000000 / frequency.QuadPart;
+
+		statistics.displayedPresentCount = frameStatistics.PresentCount;
+		statistics.displayedTime = std::chrono::steady_clock::time_point{
+			std::chrono::duration_cast< std::chrono::steady_clock::duration >( std::chrono::nanoseconds{ nanoseconds } ) };
+	}
+	return statistics;
+}
+
+ReadbackId DeviceContext::QueueReadback( void* pixels, int stride )
+{
+	// The texture outlives window frames, it only holds the last frame while drawing offscreen.
+	if ( !_offscreen || _offscreenTexture == nullptr )
+		return 0;
+
+	D3D11_TEXTURE2D_DESC desc;
+	_offscreenTexture->GetDesc( &desc );
+
+	StagingTexture staging;
+	for ( auto it = _freeStagingTextures.begin(); it != _freeStagingTextures.end(); ++it )
+	{
+		D3D11_TEXTURE2D_DESC stagingDesc;
+		it->texture->GetDesc( &stagingDesc );
+		if ( stagingDesc.Width == desc.Width && stagingDesc.Height == desc.Height )
+		{
+			staging = std::move( *it );
+			_freeStagingTextures.erase( it );
+			break;
+		}
+	}
+
+	if ( staging.texture == nullptr )
+	{
+		CD3D11_TEXTURE2D_DESC stagingDesc(
+			desc.Format,
+			desc.Width,
+			desc.Height,
+			1,
+			1,
+			0,
+			D3D11_USAGE_STAGING,
+			D3D11_CPU_ACCESS_READ
+		);
+
+		ThrowIfFailed(
+			_device._d3dDevice->CreateTexture2D( &stagingDesc, nullptr, &staging.texture )
+		);
+		staging.charge = ResourceCharge{ _resources, ResourceType::Bitmap, static_cast< uint64_t >( desc.Width ) * desc.Height * 4 };
+	}
+
+	// The copy is queued behind the drawing, Flush submits it so polling can make progress.
+	D3DContextLock lock{ _device._d2dMultithread.Get() };
+	_device._d3dContext->CopyResource( staging.texture.Get(), _offscreenTexture.Get() );
+	_device._d3dContext->Flush();
+
+	auto id = _nextReadbackId++;
+	_readbacks.push_back( Readback{ id, std::move( staging ), pixels, stride } );
+	return id;
+}
+
+bool DeviceContext::PollReadback( ReadbackId id, bool wait )
+{
+	auto it = std::find_if( _readbacks.begin(), _readbacks.end(), [id] ( const Readback& readback ) { return readback.id == id; } );
+	if ( it == _readbacks.end() )
+		return true;
+
+	D3DContextLock lock{ _device._d2dMultithread.Get() };
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT hr = _device._d3dContext->Map( it->staging.texture.Get(), 0, D3D11_MAP_READ, wait ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped );
+	if ( hr == DXGI_ERROR_WAS_STILL_DRAWING )
+		return false;
+	ThrowIfFailed( hr );
+
+	D3D11_TEXTURE2D_DESC desc;
+	it->staging.texture->GetDesc( &desc );
+
+	auto rowSize = std::min( static_cast< UINT >( it->stride ), desc.Width * 4 );
+	auto source = static_cast< const uint8_t* >( mapped.pData );
+	auto destination = static_cast< uint8_t* >( it->pixels );
+	for ( UINT y = 0; y < desc.Height; ++y )
+	{
+		memcpy( destination + y * it->stride, source + y * mapped.RowPitch, rowSize );
+	}
+
+	_device._d3dContext->Unmap( it->staging.texture.Get(), 0 );
+
+	_freeStagingTextures.push_back( std::move( it->staging ) );
+	_readbacks.erase( it );
+	return true;
+}
+
+RectF DeviceContext::GetDrawRect()
+{
+	FLOAT scaleX, scaleY;
+	_d2dContext->GetDpi( &scaleX, &scaleY );
+	scaleX /= 96.0f;
+	scaleY /= 96.0f;
+
+	return RectF{ _viewport.TopLeftX / scaleX, _viewport.TopLeftY / scaleY, _viewport.Width / scaleX, _viewport.Height / scaleY };
+}
+
+float DeviceContext::GetDpi()
+{
+	FLOAT dpiX, dpiY;
+	_d2dContext->GetDpi( &dpiX, &dpiY );
+	return dpiX;
+}
+
+void DeviceContext::Clear( const ColorF& color )
+{
+	_d2dContext->Clear( D2D1::ColorF( color.r, color.g, color.b, color.a ) );
+}
+
+ID2D1Brush* DeviceContext::GetBrush( graphics::Brush& brush )
+{
+	if ( auto pBrush = brush.As<Brush>() )
+		return pBrush->GetOrCreate( *_d2dContext.Get() );
+	if ( auto pGradientBrush = brush.As<GradientBrush>() )
+		return pGradientBrush->Get();
+	return nullptr;
+}
+
+void DeviceContext::FillRect( ID2D1Brush* d2dBrush, const RectF& rect )
+{
+	if ( d2dBrush )
+	{
+		_d2dContext->FillRectangle(
+			D2D1::RectF( rect.x, rect.y, rect.x + rect.w, rect.y + rect.h ),
+			d2dBrush );
+	}
+}
+
+void DeviceContext::DrawRect( ID2D1Brush* d2dBrush, const RectF& rect, float strokeWidth )
+{
+	if ( d2dBrush )
+	{
+		_d2dContext->DrawRectangle(
+			D2D1::RectF( rect.x, rect.y, rect.x + rect.w, rect.y + rect.h ),
+			d2dBrush,
+			strokeWidth
+		);
+	}
+}
+
+void DeviceContext::DrawTextLayout( const TextLayout& layout, ID2D1Brush* d2dBrush, const PointF& position )
+{
+	if ( d2dBrush )
+	{
+		_d2dContext->DrawTextLayout(
+			D2D1::Point2F( position.x, position.y ),
+			layout.Get(),
+			d2dBrush,
+			D2D1_DRAW_TEXT_OPTIONS_ENABLE_COLOR_FONT
+		);
+	}
+}
+
+void DeviceContext::FillRect( graphics::Brush& brush, const RectF& rect )
+{
+	FillRect( GetBrush( brush ), rect );
+}
+
+void DeviceContext::DrawRect( graphics::Brush& brush, const RectF& rect, float strokeWidth )
+{
+	DrawRect( GetBrush( brush ), rect, strokeWidth );
+}
+
+void DeviceContext::DrawTextLayout( const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position )
+{
+	if ( auto pTextLayout = layout.As<TextLayout>() )
+		DrawTextLayout( *pTextLayout, GetBrush( brush ), position );
+}
+
+void DeviceContext::FillRect( Brush& brush, const RectF& rect )
+{
+	FillRect( brush.GetOrCreate( *_d2dContext.Get() ), rect );
+}
+
+void DeviceContext::DrawRect( Brush& brush, const RectF& rect, float strokeWidth )
+{
+	DrawRect( brush.GetOrCreate( *_d2dContext.Get() ), rect, strokeWidth );
+}
+
+void DeviceContext::DrawTextLayout( const TextLayout& layout, Brush& brush, const PointF& position )
+{
+	DrawTextLayout( layout, brush.GetOrCreate( *_d2dContext.Get() ), position );
+}
+
+void DeviceContext::PushClip( const RectF& rect )
+{
+	_d2dContext->PushAxisAlignedClip(
+		D2D1::RectF( rect.x, rect.y, rect.x + rect.w, rect.y + rect.h ),
+		D2D1_ANTIALIAS_MODE_PER_PRIMITIVE
+	);
+}
+
+void DeviceContext::PopClip()
+{
+	_d2dContext->PopAxisAlignedClip();
+}
+
+bool DeviceContext::BeginLayer( LayerId id, const RectF& bounds )
+{
+	FLOAT dpiX, dpiY;
+	_d2dContext->GetDpi( &dpiX, &dpiY );
+
+	auto sizePx = D2D1::SizeU(
+		static_cast< UINT32 >( std::max( 1.0f, std::ceil( bounds.w * dpiX / 96.0f ) ) ),
+		static_cast< UINT32 >( std::max( 1.0f, std::ceil( bounds.h * dpiY / 96.0f ) ) ) );
+
+	LayerKey key{ id, ToDpiBucket( dpiX ) };
+	if ( std::find( _layerDpis.begin(), _layerDpis.end(), key.dpi ) == _layerDpis.end() )
+		_layerDpis.push_back( key.dpi );
+
+	auto& layer = _layers[ key ];
+	if ( layer.bitmap == nullptr ||
+		layer.bitmap->GetPixelSize().width != sizePx.width ||
+		layer.bitmap->GetPixelSize().height != sizePx.height )
+	{
+		D2D1_BITMAP_PROPERTIES1 bitmapProperties =
+			D2D1::BitmapProperties1(
+				D2D1_BITMAP_OPTIONS_TARGET,
+				D2D1::PixelFormat( DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED ),
+				dpiX,
+				dpiY
+			);
+
+		layer.bitmap = nullptr;
+		layer.charge.Reset();
+		ThrowIfFailed( _d2dContext->CreateBitmap( sizePx, nullptr, 0, &bitmapProperties, &layer.bitmap ) );
+		layer.charge = ResourceCharge{ _resources, ResourceType::Bitmap, static_cast< uint64_t >( sizePx.width ) * sizePx.height * 4 };
+		layer.valid = false;
+	}
+	layer.bounds = bounds;
+	layer.lastUsedFrame = _frameNumber;
+
+	LayerScope scope{ key, !layer.valid };
+	if ( scope.recording )
+	{
+		// Content is drawn in layer local coordinates, so moving the layer keeps it valid.
+		_d2dContext->GetTarget( &scope.previousTarget );
+		_d2dContext->GetTransform( &scope.previousTransform );
+		_d2dContext->SetTarget( layer.bitmap.Get() );
+		_d2dContext->SetTransform( D2D1::Matrix3x2F::Translation( -bounds.x, -bounds.y ) );
+		_d2dContext->Clear( D2D1::ColorF( 0, 0, 0, 0 ) );
+	}
+
+	_layerStack.push_back( std::move( scope ) );
+	return _layerStack.back().recording;
+}
+
+void DeviceContext::EndLayer( const Matrix3x2F& transform, float opacity )
+{
+	auto scope = std::move( _layerStack.back() );
+	_layerStack.pop_back();
+
+	auto& layer = _layers.at( scope.key );
+	if ( scope.recording )
+	{
+		_d2dContext->SetTarget( scope.previousTarget.Get() );
+		_d2dContext->SetTransform( scope.previousTransform );
+		layer.valid = true;
+	}
+
+	D2D1::Matrix3x2F baseTransform;
+	_d2dContext->GetTransform( &baseTransform );
+
+	auto layerTransform = ToD2DMatrix( transform );
+	_d2dContext->SetTransform( layerTransform * baseTransform );
+	_d2dContext->DrawBitmap(
+		layer.bitmap.Get(),
+		D2D1::RectF( layer.bounds.x, layer.bounds.y, layer.bounds.x + layer.bounds.w, layer.bounds.y + layer.bounds.h ),
+		opacity,
+		D2D1_INTERPOLATION_MODE_LINEAR
+	);
+	_d2dContext->SetTransform( baseTransform );
+}
+
+void DeviceContext::InvalidateLayer( LayerId id )
+{
+	for ( auto dpi : _layerDpis )
+	{
+		auto it = _layers.find( LayerKey{ id, dpi } );
+		if ( it != _layers.end() )
+		{
+			it->second.valid = false;
+		}
+	}
+}
+
+void DeviceContext::TrimCaches()
+{
+	uint64_t cacheBytes = 0;
+	for ( const auto& staging : _freeStagingTextures )
+	{
+		cacheBytes += staging.charge.GetBytes();
+	}
+	for ( const auto& entry : _layers )
+	{
+		cacheBytes += entry.second.charge.GetBytes();
+	}
+
+	if ( !IsOverBudget( cacheBytes ) )
+		return;
+
+	// Staging textures are cheap to recreate, layers cost a redraw of their content.
+	while ( !_freeStagingTextures.empty() && IsOverBudget( cacheBytes ) )
+	{
+		cacheBytes -= _freeStagingTextures.back().charge.GetBytes();
+		_freeStagingTextures.pop_back();
+	}
+
+	std::vector<std::pair<uint64_t, LayerKey>> unused;
+	for ( const auto& entry : _layers )
+	{
+		if ( entry.second.lastUsedFrame + 1 < _frameNumber )
+			unused.emplace_back( entry.second.lastUsedFrame, entry.first );
+	}
+	std::sort( unused.begin(), unused.end(), [] ( const auto& a, const auto& b ) { return a.first < b.first; } );
+
+	for ( const auto& candidate : unused )
+	{
+		if ( !IsOverBudget( cacheBytes ) )
+			break;
+
+		auto it = _layers.find( candidate.second );
+		cacheBytes -= it->second.charge.GetBytes();
+		_layers.erase( it );
+	}
+}
+
+DeviceContext* Backend::Cast( graphics::DeviceContext& dc ) { return dc.As<DeviceContext>(); }
+Brush* Backend::Cast( graphics::Brush& brush ) { return brush.As<Brush>(); }
+const TextLayout* Backend::Cast( const graphics::TextLayout& layout ) { return layout.As<TextLayout>(); }
+
+// DeviceContext is final, so the calls below are bound statically.
+Brush& Backend::CreateFrameSolidBrush( DeviceContext& dc, const ColorF& color ) { return dc.CreateFrameSolidBrush( color ); }
+TextLayout& Backend::CreateFrameTextLayout( DeviceContext& dc, StringView text, const graphics::TextFormat& format, const SizeF& sizeFit )
+{
+	return dc.CreateFrameTextLayout( text, format, sizeFit );
+}
+
+void Backend::Clear( DeviceContext& dc, const ColorF& color ) { dc.Clear( color ); }
+void Backend::FillRect( DeviceContext& dc, Brush& brush, const RectF& rect ) { dc.FillRect( brush, rect ); }
+void Backend::FillRect( DeviceContext& dc, graphics::Brush& brush, const RectF& rect ) { dc.FillRect( brush, rect ); }
+void Backend::DrawRect( DeviceContext& dc, Brush& brush, const RectF& rect, float strokeWidth ) { dc.DrawRect( brush, rect, strokeWidth ); }
+void Backend::DrawRect( DeviceContext& dc, graphics::Brush& brush, const RectF& rect, float strokeWidth ) { dc.DrawRect( brush, rect, strokeWidth ); }
+void Backend::DrawTextLayout( DeviceContext& dc, const TextLayout& layout, Brush& brush, const PointF& position ) { dc.DrawTextLayout( layout, brush, position ); }
+void Backend::DrawTextLayout( DeviceContext& dc, const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position )
+{
+	dc.DrawTextLayout( layout, brush, position );
+}
+
+// Mixed objects take the virtual path of the context, which downcasts both.
+void Backend::DrawTextLayout( DeviceContext& dc, const graphics::TextLayout& layout, Brush& brush, const PointF& position )
+{
+	dc.DrawTextLayout( layout, static_cast< graphics::Brush& >( brush ), position );
+}
+
+void Backend::DrawTextLayout( DeviceContext& dc, const TextLayout& layout, graphics::Brush& brush, const PointF& position )
+{
+	dc.DrawTextLayout( static_cast< const graphics::TextLayout& >( layout ), brush, position );
+}
+
+std::unique_ptr<graphics::Device> CreateDevice()
+{
+	return std::unique_ptr<graphics::Device>( new Device() );
+}
+
+} // namespace graphics::dx
@@ -0,0 +1,83 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+
+namespace graphics
+{
+
+FrameArena::FrameArena( size_t initialSize )
+{
+	AddBlock( initialSize );
+}
+
+FrameArena::~FrameArena()
+{
+	RunDestructors();
+}
+
+void FrameArena::AddBlock( size_t minimumSize )
+{
+	size_t size = std::max( minimumSize, _blocks.empty() ? size_t{ 0 } : _blocks.back().size * 2 );
+	_blocks.push_back( Block{ std::unique_ptr<uint8_t[]>( new uint8_t[ size ] ), size } );
+	_stats.capacity += size;
+	_stats.heapAllocations++;
+}
+
+void* FrameArena::Allocate( size_t size, size_t alignment )
+{
+	for ( ;; )
+	{
+		auto& block = _blocks[ _blockIndex ];
+		auto base = reinterpret_cast< uintptr_t >( block.memory.get() );
+		auto aligned = ( base + _offset + alignment - 1 ) & ~( static_cast< uintptr_t >( alignment ) - 1 );
+		auto end = aligned - base + size;
+
+		if ( end <= block.size )
+		{
+			_offset = end;
+			_stats.bytesUsed = _usedInPreviousBlocks + _offset;
+			_stats.highWaterMark = std::max( _stats.highWaterMark, _stats.bytesUsed );
+			return reinterpret_cast< void* >( aligned );
+		}
+
+		_usedInPreviousBlocks += block.size;
+		if ( ++_blockIndex == _blocks.size() )
+		{
+			AddBlock( size + alignment );
+		}
+		_offset = 0;
+	}
+}
+
+void FrameArena::RunDestructors()
+{
+	// Objects are destroyed in reverse order of allocation.
+	for ( auto node = _destructors; node; node = node->next )
+	{
+		node->destroy( node->object );
+	}
+	_destructors = nullptr;
+}
+
+void FrameArena::Reset()
+{
+	RunDestructors();
+
+	if ( _blocks.size() > 1 )
+	{
+		// The frame overflowed into more blocks, replace them with a single block of the same
+		// total size so the next frame fits without chaining.
+		auto capacity = _stats.capacity;
+		_blocks.clear();
+		_stats.capacity = 0;
+		AddBlock( capacity );
+	}
+
+	_blockIndex = 0;
+	_offset = 0;
+	_usedInPreviousBlocks = 0;
+	_stats.bytesUsed = 0;
+	_stats.frames++;
+}
+
+} // namespace graphics
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <memory> // for std::unique_ptr
+#include <vector> // for std::vector
+#include <cstdint> // for uint8_t
+#include <cstddef> // for size_t, max_align_t
+#include <type_traits> // for std::is_trivially_destructible
+#include <utility> // for std::forward
+#include <new> // for placement new
+
+namespace graphics
+{
+
+// Bump allocator for objects that live for a single frame. Reset releases everything at once
+// and keeps the memory, so once the arena has grown to the frame working set it never
+// touches the heap again.
+class FrameArena
+{
+public:
+	struct Stats
+	{
+		size_t bytesUsed{ 0 };
+		size_t highWaterMark{ 0 };
+		size_t capacity{ 0 };
+		size_t heapAllocations{ 0 };
+		size_t frames{ 0 };
+	};
+
+private:
+	struct Block
+	{
+		std::unique_ptr<uint8_t[]> memory;
+		size_t size;
+	};
+
+	// Destructors are linked through headers stored in the arena itself.
+	struct DestructorNode
+	{
+		DestructorNode* next;
+		void ( *destroy )( void* object );
+		void* object;
+	};
+
+	std::vector<Block> _blocks;
+	size_t _blockIndex{ 0 };
+	size_t _offset{ 0 };
+	size_t _usedInPreviousBlocks{ 0 };
+	DestructorNode* _destructors{ nullptr };
+	Stats _stats;
+
+	void AddBlock( size_t minimumSize );
+	void RunDestructors();
+
+public:
+	explicit FrameArena( size_t initialSize = 64 * 1024 );
+	~FrameArena();
+
+	FrameArena( const FrameArena& ) = delete;
+	FrameArena& operator=( const FrameArena& ) = delete;
+
+	void* Allocate( size_t size, size_t alignment = alignof( std::max_align_t ) );
+
+	template< typename T, typename... TArgs >
+	T* New( TArgs&&... args )
+	{
+		if constexpr ( std::is_trivially_destructible_v<T> )
+		{
+			return new ( Allocate( sizeof( T ), alignof( T ) ) ) T( std::forward<TArgs>( args )... );
+		}
+		else
+		{
+			auto node = static_cast< DestructorNode* >( Allocate( sizeof( DestructorNode ), alignof( DestructorNode ) ) );
+			auto object = new ( Allocate( sizeof( T ), alignof( T ) ) ) T( std::forward<TArgs>( args )... );
+			node->next = _destructors;
+			node->destroy = [] ( void* p ) { static_cast< T* >( p )->~T(); };
+			node->object = object;
+			_destructors = node;
+			return object;
+		}
+	}
+
+	// Destroys all objects allocated since the previous Reset.
+	void Reset();
+
+	const Stats& GetStats() const { return _stats; }
+};
+
+} // namespace graphics
@@ -1,20 +1,130 @@
-#include "Graphics.h"
-#include "Application.h"
-
-namespace graphics
-{
-
-void DeviceContext::FillSolidRect( const ColorF& color, const RectF& rect )
-{
-	auto brush = CreateSolidBrush( color );
-	FillRect( *brush, rect );
-}
-
-void DeviceContext::DrawSolidRect( const ColorF& color, const RectF& rect, float strokeWidth )
-{
-	auto brush = CreateSolidBrush( color );
-	DrawRect( *brush, rect, strokeWidth );
-}
-
-} // namespace graphics
-
+#include "Graphics.h"
+#include "Application.h"
+
+namespace graphics
+{
+
+uint64_t ResourceUsage::GetTotalBytes() const
+{
+	uint64_t total = 0;
+	for ( auto value : bytes )
+	{
+		total += value;
+	}
+	return total;
+}
+
+void ResourceTracker::Add( ResourceType type, uint64_t bytes )
+{
+	auto index = static_cast< size_t >( type );
+	_bytes[ index ].fetch_add( bytes, std::memory_order_relaxed );
+	_count[ index ].fetch_add( 1, std::memory_order_relaxed );
+	if ( _parent )
+		_parent->Add( type, bytes );
+}
+
+void ResourceTracker::Remove( ResourceType type, uint64_t bytes )
+{
+	auto index = static_cast< size_t >( type );
+	_bytes[ index ].fetch_sub( bytes, std::memory_order_relaxed );
+	_count[ index ].fetch_sub( 1, std::memory_order_relaxed );
+	if ( _parent )
+		_parent->Remove( type, bytes );
+}
+
+ResourceUsage ResourceTracker::GetUsage() const
+{
+	ResourceUsage usage;
+	for ( size_t i = 0; i < k_ResourceTypeCount; ++i )
+	{
+		usage.bytes[ i ] = _bytes[ i ].load( std::memory_order_relaxed );
+		usage.count[ i ] = _count[ i ].load( std::memory_order_relaxed );
+	}
+	return usage;
+}
+
+uint64_t ResourceTracker::GetTotalBytes() const
+{
+	uint64_t total = 0;
+	for ( const auto& value : _bytes )
+	{
+		total += value.load( std::memory_order_relaxed );
+	}
+	return total;
+}
+
+bool GradientStops::operator==( const GradientStops& other ) const
+{
+	if ( extend != other.extend || stops.size() != other.stops.size() )
+		return false;
+
+	for ( size_t i = 0; i < stops.size(); ++i )
+	{
+		const auto& a = stops[ i ];
+		const auto& b = other.stops[ i ];
+		if ( a.position != b.position || a.color.r != b.color.r || a.color.g != b.color.g ||
+			a.color.b != b.color.b || a.color.a != b.color.a )
+			return false;
+	}
+	return true;
+}
+
+size_t GradientStops::Hash() const
+{
+	auto hash = std::hash<size_t>{}( static_cast< size_t >( extend ) );
+	auto combine = [&hash] ( float value ) {
+		hash ^= std::hash<float>{}( value ) + 0x9E3779B9 + ( hash << 6 ) + ( hash >> 2 );
+	};
+	for ( const auto& stop : stops )
+	{
+		combine( stop.position );
+		combine( stop.color.r );
+		combine( stop.color.g );
+		combine( stop.color.b );
+		combine( stop.color.a );
+	}
+	return hash;
+}
+
+void GradientBrush::SetLinear( const LinearGradient& gradient )
+{
+	if ( _type != GradientType::Linear )
+		return;
+	_linear = gradient;
+	OnGeometryChanged();
+}
+
+void GradientBrush::SetRadial( const RadialGradient& gradient )
+{
+	if ( _type != GradientType::Radial )
+		return;
+	_radial = gradient;
+	OnGeometryChanged();
+}
+
+void GradientBrush::SetTransform( const Matrix3x2F& transform )
+{
+	_transform = transform;
+	OnGeometryChanged();
+}
+
+void GradientBrush::SetStops( const GradientStops& stops )
+{
+	if ( stops == _stops )
+		return;
+	_stops = stops;
+	OnStopsChanged();
+}
+
+void DeviceContext::FillSolidRect( const ColorF& color, const RectF& rect )
+{
+	FillRect( CreateFrameSolidBrush( color ), rect );
+}
+
+void DeviceContext::DrawSolidRect( const ColorF& color, const RectF& rect, float strokeWidth )
+{
+	DrawRect( CreateFrameSolidBrush( color ), rect, strokeWidth );
+}
+
+} // namespace graphics
+
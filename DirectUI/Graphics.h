@@ -1,96 +1,454 @@
-#pragma once
-
-#include "CoreTypes.h"
-#include <memory> // for std::unique_ptr
-#include <functional> // for std::function
-#include <string> // for std::wstring
-
-namespace graphics
-{
-
-using String = std::wstring;
-
-struct ColorF
-{
-	float r, g, b, a;
-	ColorF() : r{ 0 }, g{ 0 }, b{ 0 }, a{ 0 } {}
-	ColorF( float r, float g, float b, float a ) : r{ r }, g{ g }, b{ b }, a{ a } {}
-	ColorF( uint32_t hex, float a )
-		: r{ ( ( hex >> 16 ) & 0xFF ) / 255.0f }
-		, g{ ( ( hex >> 8 ) & 0xFF ) / 255.0f }
-		, b{ ( ( hex ) & 0xFF ) / 255.0f }
-		, a{ a }
-	{}
-};
-
-class DeviceContext;
-
-class Brush : public directui::NamedBase
-{
-public:
-	using NamedBase::NamedBase;
-};
-
-class TextFormat : public directui::NamedBase
-{
-public:
-	using NamedBase::NamedBase;
-};
-
-enum class TextAlignment
-{
-	Leading,
-	Trailing,
-	Center,
-	Justified
-};
-
-enum class ParagraphAlignment
-{
-	Near,
-	Far,
-	Center
-};
-
-class TextLayout : public directui::NamedBase
-{
-public:
-	using NamedBase::NamedBase;
-
-public:
-	virtual void SetTextAlignment( TextAlignment alignment ) = 0;
-	virtual void SetParagraphAlignment( ParagraphAlignment alignment ) = 0;
-};
-
-class Device
-{
-public:
-	virtual ~Device() {}
-
-	virtual std::unique_ptr<DeviceContext> CreateDeviceContext() = 0;
-	virtual std::unique_ptr<TextFormat> CreateTextFormat( const String& fontFamily, float height ) = 0;
-	virtual std::unique_ptr<TextLayout> CreateTextLayout( const String& text, const TextFormat& format, const SizeF& sizeFit ) = 0;
-};
-
-class DeviceContext
-{
-public:
-	virtual ~DeviceContext() {}
-
-	virtual std::unique_ptr<Brush> CreateSolidBrush( const ColorF& color ) = 0;
-
-	virtual void BeginDraw( directui::Handle windowHandle ) = 0;
-	virtual void EndDraw() = 0;
-
-	virtual RectF GetDrawRect() = 0;
-
-	virtual void Clear( const ColorF& color ) = 0;
-	virtual void FillRect( Brush& brush, const RectF& rect ) = 0;
-	virtual void DrawRect( Brush& brush, const RectF& rect, float strokeWidth = 1.0f ) = 0;
-	virtual void DrawTextLayout( const TextLayout& layout, Brush& brush, const PointF& position ) = 0;
-
-	void FillSolidRect( const ColorF& color, const RectF& rect );
-	void DrawSolidRect( const ColorF& color, const RectF& rect, float strokeWidth = 1.0f );
-};
-
+#pragma once
+
+#include "CoreTypes.h"
+#include "FrameArena.h"
+#include <memory> // for std::unique_ptr
+#include <functional> // for std::function, std::hash
+#include <string> // for std::wstring
+#include <string_view> // for std::wstring_view
+#include <cstdint> // for uint64_t
+#include <limits> // for std::numeric_limits
+#include <atomic> // for std::atomic
+#include <vector> // for std::vector
+#include <unordered_map> // for std::unordered_map
+#include <mutex> // for std::mutex
+#include <chrono> // for std::chrono::steady_clock
+
+namespace graphics
+{
+
+using String = std::wstring;
+// Text parameters are views, callers keep any string type (String, InternedString, literals) without copying.
+using StringView = std::wstring_view;
+
+struct ColorF
+{
+	float r, g, b, a;
+	ColorF() : r{ 0 }, g{ 0 }, b{ 0 }, a{ 0 } {}
+	ColorF( float r, float g, float b, float a ) : r{ r }, g{ g }, b{ b }, a{ a } {}
+	ColorF( uint32_t hex, float a )
+		: r{ ( ( hex >> 16 ) & 0xFF ) / 255.0f }
+		, g{ ( ( hex >> 8 ) & 0xFF ) / 255.0f }
+		, b{ ( ( hex ) & 0xFF ) / 255.0f }
+		, a{ a }
+	{}
+};
+
+class DeviceContext;
+
+using LayerId = uint64_t;
+using ReadbackId = uint64_t;
+
+// Layer caches keep one rasterization per DPI bucket, so a window moving between monitors
+// of different scale reuses what was drawn for each of them instead of redrawing.
+using DpiBucket = uint32_t;
+
+inline DpiBucket ToDpiBucket( float dpi ) { return static_cast< DpiBucket >( dpi + 0.5f ); }
+
+struct LayerKey
+{
+	LayerId id;
+	DpiBucket dpi;
+
+	bool operator==( const LayerKey& other ) const { return id == other.id && dpi == other.dpi; }
+};
+
+struct LayerKeyHash
+{
+	size_t operator()( const LayerKey& key ) const
+	{
+		return std::hash<uint64_t>{}( key.id ^ ( static_cast< uint64_t >( key.dpi ) << 48 ) );
+	}
+};
+
+class Brush : public directui::NamedBase
+{
+public:
+	using NamedBase::NamedBase;
+};
+
+struct GradientStop
+{
+	float position; // 0 to 1 along the gradient
+	ColorF color;
+};
+
+enum class GradientExtend
+{
+	Clamp,
+	Repeat,
+	Mirror
+};
+
+// Compared by value, brushes with equal stops share one stop collection cached on the device.
+struct GradientStops
+{
+	std::vector<GradientStop> stops;
+	GradientExtend extend{ GradientExtend::Clamp };
+
+	bool operator==( const GradientStops& other ) const;
+	bool operator!=( const GradientStops& other ) const { return !( *this == other ); }
+	size_t Hash() const;
+};
+
+struct GradientStopsHash
+{
+	size_t operator()( const GradientStops& stops ) const { return stops.Hash(); }
+};
+
+enum class GradientType
+{
+	Linear,
+	Radial
+};
+
+// Gradient geometry is in brush space, the brush transform maps it to DIPs.
+struct LinearGradient
+{
+	PointF start;
+	PointF end;
+};
+
+struct RadialGradient
+{
+	PointF center;
+	float radiusX;
+	float radiusY;
+};
+
+// Geometry and transform changes update the platform brush in place, only changed stops
+// recreate it. The type is fixed at creation, setting the geometry of the other type is ignored.
+class GradientBrush : public Brush
+{
+private:
+	GradientType _type;
+	LinearGradient _linear{};
+	RadialGradient _radial{};
+	Matrix3x2F _transform;
+	GradientStops _stops;
+
+protected:
+	virtual void OnGeometryChanged() = 0; // geometry or transform
+	virtual void OnStopsChanged() = 0;
+
+public:
+	GradientBrush( const char* name, const LinearGradient& gradient, const GradientStops& stops )
+		: Brush{ name }, _type{ GradientType::Linear }, _linear{ gradient }, _stops{ stops }
+	{}
+
+	GradientBrush( const char* name, const RadialGradient& gradient, const GradientStops& stops )
+		: Brush{ name }, _type{ GradientType::Radial }, _radial{ gradient }, _stops{ stops }
+	{}
+
+	GradientType GetType() const { return _type; }
+	const LinearGradient& GetLinear() const { return _linear; }
+	const RadialGradient& GetRadial() const { return _radial; }
+	const Matrix3x2F& GetTransform() const { return _transform; }
+	const GradientStops& GetStops() const { return _stops; }
+
+	void SetLinear( const LinearGradient& gradient );
+	void SetRadial( const RadialGradient& gradient );
+	void SetTransform( const Matrix3x2F& transform );
+	// Does nothing when the stops are equal to the current ones.
+	void SetStops( const GradientStops& stops );
+};
+
+// Stop collections of a device keyed by their stops. Entries no brush refers to any more are
+// dropped once the cache holds k_Capacity of them.
+template< typename T >
+class GradientCache
+{
+private:
+	static constexpr size_t k_Capacity = 256;
+
+	std::mutex _mutex;
+	std::unordered_map<GradientStops, std::shared_ptr<const T>, GradientStopsHash> _entries;
+
+public:
+	// create( stops ) returns a new T, it is only called for stops not in the cache.
+	template< typename TCreate >
+	std::shared_ptr<const T> GetOrCreate( const GradientStops& stops, TCreate&& create )
+	{
+		std::lock_guard<std::mutex> lock{ _mutex };
+		auto it = _entries.find( stops );
+		if ( it != _entries.end() )
+			return it->second;
+
+		if ( _entries.size() >= k_Capacity )
+		{
+			for ( auto entry = _entries.begin(); entry != _entries.end(); )
+			{
+				entry = entry->second.use_count() == 1 ? _entries.erase( entry ) : std::next( entry );
+			}
+		}
+
+		std::shared_ptr<const T> value{ create( stops ) };
+		_entries.emplace( stops, value );
+		return value;
+	}
+
+	size_t GetCount()
+	{
+		std::lock_guard<std::mutex> lock{ _mutex };
+		return _entries.size();
+	}
+};
+
+class TextFormat : public directui::NamedBase
+{
+public:
+	using NamedBase::NamedBase;
+};
+
+enum class TextAlignment
+{
+	Leading,
+	Trailing,
+	Center,
+	Justified
+};
+
+enum class ParagraphAlignment
+{
+	Near,
+	Far,
+	Center
+};
+
+struct TextMetrics
+{
+	float width, height;
+	uint32_t lineCount;
+	TextMetrics() : width{ 0 }, height{ 0 }, lineCount{ 0 } {}
+	TextMetrics( float width, float height, uint32_t lineCount ) : width{ width }, height{ height }, lineCount{ lineCount } {}
+};
+
+class TextLayout : public directui::NamedBase
+{
+public:
+	using NamedBase::NamedBase;
+
+public:
+	virtual void SetTextAlignment( TextAlignment alignment ) = 0;
+	virtual void SetParagraphAlignment( ParagraphAlignment alignment ) = 0;
+};
+
+enum class ResourceType
+{
+	SwapChain,
+	DepthBuffer,
+	Bitmap, // offscreen targets, cached layers and readback staging
+	TextLayout,
+	Brush
+};
+
+constexpr size_t k_ResourceTypeCount = 5;
+
+// Sizes of text layouts and brushes are estimates, DirectWrite and Direct2D do not report them.
+struct ResourceUsage
+{
+	uint64_t bytes[ k_ResourceTypeCount ]{};
+	uint32_t count[ k_ResourceTypeCount ]{};
+
+	uint64_t GetBytes( ResourceType type ) const { return bytes[ static_cast< size_t >( type ) ]; }
+	uint32_t GetCount( ResourceType type ) const { return count[ static_cast< size_t >( type ) ]; }
+	uint64_t GetTotalBytes() const;
+};
+
+struct ResourceBudget
+{
+	// Cached layers unused in the last frame are evicted, least recently used first, above this size.
+	uint64_t cacheBytes{ std::numeric_limits<uint64_t>::max() };
+	// Only 3D content drawn with Direct3D uses a depth buffer, 2D surfaces skip it.
+	bool depthBuffer{ false };
+};
+
+// Thread-safe counters. A context tracker also counts into the tracker of its device,
+// so the device reports the sum of all its contexts.
+class ResourceTracker
+{
+private:
+	ResourceTracker* _parent;
+	std::atomic<uint64_t> _bytes[ k_ResourceTypeCount ]{};
+	std::atomic<uint32_t> _count[ k_ResourceTypeCount ]{};
+	std::atomic<uint64_t> _budgetBytes{ std::numeric_limits<uint64_t>::max() };
+
+public:
+	explicit ResourceTracker( ResourceTracker* parent = nullptr ) : _parent{ parent } {}
+
+	ResourceTracker( const ResourceTracker& ) = delete;
+	ResourceTracker& operator=( const ResourceTracker& ) = delete;
+
+	void Add( ResourceType type, uint64_t bytes );
+	void Remove( ResourceType type, uint64_t bytes );
+
+	ResourceUsage GetUsage() const;
+	uint64_t GetTotalBytes() const;
+
+	ResourceTracker* GetParent() const { return _parent; }
+
+	void SetBudget( uint64_t bytes ) { _budgetBytes.store( bytes, std::memory_order_relaxed ); }
+	uint64_t GetBudget() const { return _budgetBytes.load( std::memory_order_relaxed ); }
+	bool IsOverBudget() const { return GetTotalBytes() > GetBudget(); }
+};
+
+// Counts one resource in a tracker for as long as it lives.
+class ResourceCharge
+{
+private:
+	ResourceTracker* _tracker{ nullptr };
+	ResourceType _type{ ResourceType::Bitmap };
+	uint64_t _bytes{ 0 };
+
+public:
+	ResourceCharge() {}
+	ResourceCharge( ResourceTracker& tracker, ResourceType type, uint64_t bytes )
+		: _tracker{ &tracker }, _type{ type }, _bytes{ bytes }
+	{
+		_tracker->Add( _type, _bytes );
+	}
+
+	ResourceCharge( ResourceCharge&& other ) noexcept
+		: _tracker{ other._tracker }, _type{ other._type }, _bytes{ other._bytes }
+	{
+		other._tracker = nullptr;
+	}
+
+	ResourceCharge& operator=( ResourceCharge&& other ) noexcept
+	{
+		if ( this != &other )
+		{
+			Reset();
+			_tracker = other._tracker;
+			_type = other._type;
+			_bytes = other._bytes;
+			other._tracker = nullptr;
+		}
+		return *this;
+	}
+
+	~ResourceCharge() { Reset(); }
+
+	void Reset()
+	{
+		if ( _tracker )
+			_tracker->Remove( _type, _bytes );
+		_tracker = nullptr;
+		_bytes = 0;
+	}
+
+	uint64_t GetBytes() const { return _bytes; }
+};
+
+// Part of startup, phases that ran in parallel overlap.
+struct StartupPhase
+{
+	const char* name;
+	std::chrono::steady_clock::time_point begin;
+	std::chrono::steady_clock::duration duration;
+};
+
+class Device
+{
+protected:
+	ResourceTracker _resources;
+
+public:
+	virtual ~Device() {}
+
+	virtual std::unique_ptr<DeviceContext> CreateDeviceContext() = 0;
+	virtual std::unique_ptr<TextFormat> CreateTextFormat( const String& fontFamily, float height ) = 0;
+	virtual std::unique_ptr<TextLayout> CreateTextLayout( StringView text, const TextFormat& format, const SizeF& sizeFit ) = 0;
+
+	// Device brushes can be used by every DeviceContext of the device, including contexts drawn on render threads.
+	virtual std::unique_ptr<Brush> CreateSolidBrush( const ColorF& color ) = 0;
+	virtual std::unique_ptr<GradientBrush> CreateGradientBrush( const LinearGradient& gradient, const GradientStops& stops ) = 0;
+	virtual std::unique_ptr<GradientBrush> CreateGradientBrush( const RadialGradient& gradient, const GradientStops& stops ) = 0;
+
+	// Measures text without building a TextLayout where possible, meant for layout passes.
+	virtual TextMetrics MeasureText( StringView text, const TextFormat& format,
+		float maxWidth = std::numeric_limits<float>::infinity() ) = 0;
+
+	// Sum of the device resources and of all its contexts.
+	virtual ResourceUsage GetResourceUsage() const { return _resources.GetUsage(); }
+	// Contexts evict cached layers while the device total is above the budget.
+	virtual void SetResourceBudget( uint64_t bytes ) { _resources.SetBudget( bytes ); }
+
+	// Phases of creating the device, empty when the backend does not report them.
+	virtual std::vector<StartupPhase> GetStartupPhases() const { return {}; }
+};
+
+// Presents of a window context. Backends that do not present to the screen report zero counts.
+struct PresentStatistics
+{
+	uint64_t presentCount{ 0 }; // number of the last present
+	uint64_t displayedPresentCount{ 0 }; // last present known to be on screen, 0 when unknown
+	std::chrono::steady_clock::time_point displayedTime;
+};
+
+class DeviceContext : public directui::NamedBase
+{
+protected:
+	FrameArena _frameArena;
+	ResourceTracker _resources;
+	ResourceBudget _budget;
+
+	// Layer caches are trimmed at BeginDraw, only while this returns true.
+	bool IsOverBudget( uint64_t cacheBytes ) const
+	{
+		auto device = _resources.GetParent();
+		return cacheBytes > _budget.cacheBytes || ( device && device->IsOverBudget() );
+	}
+
+public:
+	explicit DeviceContext( const char* name, ResourceTracker* deviceResources = nullptr ) : NamedBase{ name }, _resources{ deviceResources } {}
+	virtual ~DeviceContext() {}
+
+	virtual std::unique_ptr<Brush> CreateSolidBrush( const ColorF& color ) = 0;
+
+	// Frame objects are allocated from the frame arena and stay valid until the next BeginDraw.
+	virtual Brush& CreateFrameSolidBrush( const ColorF& color ) = 0;
+	virtual TextLayout& CreateFrameTextLayout( StringView text, const TextFormat& format, const SizeF& sizeFit ) = 0;
+
+	const FrameArena::Stats& GetFrameArenaStats() const { return _frameArena.GetStats(); }
+
+	virtual ResourceUsage GetResourceUsage() const { return _resources.GetUsage(); }
+	// Takes effect at the next BeginDraw, a changed depth buffer setting recreates the window buffers.
+	virtual void SetResourceBudget( const ResourceBudget& budget ) { _budget = budget; }
+	const ResourceBudget& GetResourceBudget() const { return _budget; }
+
+	virtual void BeginDraw( directui::Handle windowHandle ) = 0;
+	// Draws into an offscreen bitmap of the given size instead of a window.
+	virtual void BeginDraw( const directui::SizePx& sizePx, float dpi ) = 0;
+	virtual void EndDraw() = 0;
+	virtual PresentStatistics GetPresentStatistics() { return PresentStatistics{}; }
+
+	// Copies the last offscreen frame into staging memory without waiting for the GPU.
+	// Pixels are 32-bit BGRA with premultiplied alpha, the buffer has to stay valid until
+	// PollReadback returns true for the id. Returns 0 when the last frame was not drawn offscreen.
+	virtual ReadbackId QueueReadback( void* pixels, int stride ) = 0;
+	virtual bool PollReadback( ReadbackId id, bool wait = false ) = 0;
+
+	virtual RectF GetDrawRect() = 0;
+	virtual float GetDpi() = 0;
+
+	virtual void Clear( const ColorF& color ) = 0;
+	virtual void FillRect( Brush& brush, const RectF& rect ) = 0;
+	virtual void DrawRect( Brush& brush, const RectF& rect, float strokeWidth = 1.0f ) = 0;
+	virtual void DrawTextLayout( const TextLayout& layout, Brush& brush, const PointF& position ) = 0;
+
+	virtual void PushClip( const RectF& rect ) = 0;
+	virtual void PopClip() = 0;
+
+	// Layers cache their content in an offscreen surface per DPI, InvalidateLayer drops all of them.
+	// BeginLayer returns true when the content is missing or was invalidated and has to be drawn,
+	// otherwise drawing can be skipped. EndLayer composites the cached content in both cases.
+	virtual bool BeginLayer( LayerId id, const RectF& bounds ) = 0;
+	virtual void EndLayer( const Matrix3x2F& transform = Matrix3x2F::Identity(), float opacity = 1.0f ) = 0;
+	virtual void InvalidateLayer( LayerId id ) = 0;
+
+	void FillSolidRect( const ColorF& color, const RectF& rect );
+	void DrawSolidRect( const ColorF& color, const RectF& rect, float strokeWidth = 1.0f );
+};
+
 } // namespace graphics
\ No newline at end of file
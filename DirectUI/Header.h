@@ -1,11 +1,11 @@
-#pragma once
-
-namespace directui
-{
-
-enum class MessageType
-{
-
-};
-
-} // namespace directui
+#pragma once
+
+namespace directui
+{
+
+enum class MessageType
+{
+
+};
+
+} // namespace directui
@@ -0,0 +1,151 @@
+#include "HitTestMap.h"
+#include "Dpi.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace directui
+{
+
+HitTestMap HitTestMap::Standard( float resizeBorder, float captionHeight, float buttonWidth )
+{
+	HitTestMap map;
+	map.AddCaption( captionHeight );
+
+	auto button = [&map, captionHeight, buttonWidth] ( HitTest hit, int index ) {
+		map.AddRegion( HitTestRegion{ hit,
+			HitTestEdge::Far( buttonWidth * ( index + 1 ) ), HitTestEdge::Near( 0 ),
+			HitTestEdge::Far( buttonWidth * index ), HitTestEdge::Near( captionHeight ) } );
+	};
+	button( HitTest::CloseButton, 0 );
+	button( HitTest::MaximizeButton, 1 );
+	button( HitTest::MinimizeButton, 2 );
+
+	map.AddResizeBorders( resizeBorder );
+	return map;
+}
+
+void HitTestMap::AddRegion( const HitTestRegion& region )
+{
+	_regions.push_back( region );
+}
+
+void HitTestMap::AddRegion( HitTest hit, const graphics::RectF& rect )
+{
+	AddRegion( HitTestRegion{ hit,
+		HitTestEdge::Near( rect.x ), HitTestEdge::Near( rect.y ),
+		HitTestEdge::Near( rect.x + rect.w ), HitTestEdge::Near( rect.y + rect.h ) } );
+}
+
+void HitTestMap::AddResizeBorders( float thickness )
+{
+	auto nearEdge = HitTestEdge::Near( 0 );
+	auto farEdge = HitTestEdge::Far( 0 );
+	auto inner = HitTestEdge::Near( thickness );
+	auto farInner = HitTestEdge::Far( thickness );
+	auto corner = HitTestEdge::Near( thickness * 2 );
+	auto farCorner = HitTestEdge::Far( thickness * 2 );
+
+	AddRegion( HitTestRegion{ HitTest::Left, nearEdge, nearEdge, inner, farEdge } );
+	AddRegion( HitTestRegion{ HitTest::Right, farInner, nearEdge, farEdge, farEdge } );
+	AddRegion( HitTestRegion{ HitTest::Top, nearEdge, nearEdge, farEdge, inner } );
+	AddRegion( HitTestRegion{ HitTest::Bottom, nearEdge, farInner, farEdge, farEdge } );
+
+	AddRegion( HitTestRegion{ HitTest::TopLeft, nearEdge, nearEdge, corner, inner } );
+	AddRegion( HitTestRegion{ HitTest::TopLeft, nearEdge, nearEdge, inner, corner } );
+	AddRegion( HitTestRegion{ HitTest::TopRight, farCorner, nearEdge, farEdge, inner } );
+	AddRegion( HitTestRegion{ HitTest::TopRight, farInner, nearEdge, farEdge, corner } );
+	AddRegion( HitTestRegion{ HitTest::BottomLeft, nearEdge, farInner, corner, farEdge } );
+	AddRegion( HitTestRegion{ HitTest::BottomLeft, nearEdge, farCorner, inner, farEdge } );
+	AddRegion( HitTestRegion{ HitTest::BottomRight, farCorner, farInner, farEdge, farEdge } );
+	AddRegion( HitTestRegion{ HitTest::BottomRight, farInner, farCorner, farEdge, farEdge } );
+}
+
+void HitTestMap::AddCaption( float height )
+{
+	AddRegion( HitTestRegion{ HitTest::Caption,
+		HitTestEdge::Near( 0 ), HitTestEdge::Near( 0 ), HitTestEdge::Far( 0 ), HitTestEdge::Near( height ) } );
+}
+
+void HitTestMap::Clear()
+{
+	_regions.clear();
+	_size = SizePx{};
+	_columnOf.clear();
+	_rowOf.clear();
+	_cells.clear();
+	_columnCount = 0;
+}
+
+void HitTestMap::Update( const SizePx& size, float dpi )
+{
+	_size = SizePx{ std::max( size.w, 0 ), std::max( size.h, 0 ) };
+
+	auto toPixels = [dpi] ( const HitTestEdge& edge, int extent ) {
+		auto pixels = static_cast< int >( std::lround( edge.offset * dpi / k_DefaultDpi ) );
+		return std::clamp( edge.fromFar ? extent - pixels : pixels, 0, extent );
+	};
+
+	struct PixelRegion
+	{
+		HitTest hit;
+		int left, top, right, bottom;
+	};
+
+	std::vector<PixelRegion> regions;
+	regions.reserve( _regions.size() );
+	std::vector<int> columns{ 0, _size.w };
+	std::vector<int> rows{ 0, _size.h };
+	for ( const auto& region : _regions )
+	{
+		PixelRegion pixels{ region.hit,
+			toPixels( region.left, _size.w ), toPixels( region.top, _size.h ),
+			toPixels( region.right, _size.w ), toPixels( region.bottom, _size.h ) };
+		if ( pixels.left >= pixels.right || pixels.top >= pixels.bottom )
+			continue;
+
+		regions.push_back( pixels );
+		columns.push_back( pixels.left );
+		columns.push_back( pixels.right );
+		rows.push_back( pixels.top );
+		rows.push_back( pixels.bottom );
+	}
+
+	auto toBoundaries = [] ( std::vector<int>& values ) {
+		std::sort( values.begin(), values.end() );
+		values.erase( std::unique( values.begin(), values.end() ), values.end() );
+	};
+	toBoundaries( columns );
+	toBoundaries( rows );
+
+	// Boundaries start at 0 and end at the extent, cell i covers [boundaries[i], boundaries[i + 1]).
+	auto fillIndices = [] ( const std::vector<int>& boundaries, std::vector<uint16_t>& indices ) {
+		indices.assign( boundaries.back(), 0 );
+		for ( size_t i = 0; i + 1 < boundaries.size(); ++i )
+		{
+			std::fill( indices.begin() + boundaries[ i ], indices.begin() + boundaries[ i + 1 ], static_cast< uint16_t >( i ) );
+		}
+	};
+	fillIndices( columns, _columnOf );
+	fillIndices( rows, _rowOf );
+
+	_columnCount = columns.size() - 1;
+	auto rowCount = rows.size() - 1;
+	_cells.assign( _columnCount * rowCount, HitTest::Client );
+	for ( size_t row = 0; row < rowCount; ++row )
+	{
+		for ( size_t column = 0; column < _columnCount; ++column )
+		{
+			auto x = columns[ column ];
+			auto y = rows[ row ];
+			auto& cell = _cells[ row * _columnCount + column ];
+			for ( const auto& region : regions )
+			{
+				if ( x >= region.left && x < region.right && y >= region.top && y < region.bottom )
+					cell = region.hit;
+			}
+		}
+	}
+}
+
+} // namespace directui
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "CoreTypes.h"
+
+#include <vector> // for std::vector
+#include <cstdint> // for uint8_t, uint16_t
+#include <cstddef> // for size_t
+
+namespace directui
+{
+
+// Non-client area a point of the window belongs to, maps to the HT* codes of WM_NCHITTEST.
+enum class HitTest : uint8_t
+{
+	Nowhere,
+	Client,
+	Caption,
+	SystemMenu,
+	MinimizeButton,
+	MaximizeButton,
+	CloseButton,
+	Left,
+	Right,
+	Top,
+	Bottom,
+	TopLeft,
+	TopRight,
+	BottomLeft,
+	BottomRight
+};
+
+// Offset in DIPs from the left or top window edge, or from the right or bottom edge when fromFar is set.
+struct HitTestEdge
+{
+	float offset;
+	bool fromFar;
+
+	static HitTestEdge Near( float offset ) { return HitTestEdge{ offset, false }; }
+	static HitTestEdge Far( float offset ) { return HitTestEdge{ offset, true }; }
+};
+
+struct HitTestRegion
+{
+	HitTest hit;
+	HitTestEdge left, top, right, bottom;
+};
+
+// Declarative hit-test regions, later regions are on top of earlier ones and points outside all
+// regions are client area. Update resolves the regions for a window size into a grid: the region
+// edges split the window into cells, and per-pixel tables map a coordinate to its column and row,
+// so Lookup is three array reads regardless of the number of regions.
+class HitTestMap
+{
+private:
+	std::vector<HitTestRegion> _regions;
+
+	SizePx _size;
+	std::vector<uint16_t> _columnOf; // by pixel x
+	std::vector<uint16_t> _rowOf; // by pixel y
+	std::vector<HitTest> _cells; // row major
+	size_t _columnCount{ 0 };
+
+public:
+	// Resize borders, a caption and the minimize, maximize and close buttons right in the caption.
+	static HitTestMap Standard( float resizeBorder, float captionHeight, float buttonWidth );
+
+	void AddRegion( const HitTestRegion& region );
+	void AddRegion( HitTest hit, const graphics::RectF& rect );
+	// Edges and corners of the given thickness, corners extend along the edges by the same amount.
+	void AddResizeBorders( float thickness );
+	void AddCaption( float height );
+	// Client area punched through the regions added before, e.g. a menu bar in the caption.
+	void AddClientHole( const graphics::RectF& rect ) { AddRegion( HitTest::Client, rect ); }
+	void Clear();
+
+	bool IsEmpty() const { return _regions.empty(); }
+
+	// Rebuilds the grid, called when the window size or DPI changes.
+	void Update( const SizePx& size, float dpi );
+
+	// Point in client pixels.
+	HitTest Lookup( const PointPx& point ) const
+	{
+		if ( point.x < 0 || point.y < 0 || point.x >= _size.w || point.y >= _size.h )
+			return HitTest::Nowhere;
+		return _cells[ _rowOf[ point.y ] * _columnCount + _columnOf[ point.x ] ];
+	}
+};
+
+} // namespace directui
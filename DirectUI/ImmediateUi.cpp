@@ -0,0 +1,317 @@
+#include "ImmediateUi.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace directui
+{
+
+using namespace graphics;
+
+namespace
+{
+
+uint64_t HashText( StringView text, uint64_t seed )
+{
+	// FNV-1a over code units
+	uint64_t hash = seed ^ 14695981039346656037ull;
+	for ( auto c : text )
+	{
+		hash = ( hash ^ static_cast< uint64_t >( c ) ) * 1099511628211ull;
+	}
+	return hash;
+}
+
+uint64_t Combine( uint64_t seed, uint64_t value )
+{
+	return seed ^ ( value + 0x9E3779B97F4A7C15ull + ( seed << 6 ) + ( seed >> 2 ) );
+}
+
+uint64_t Combine( uint64_t seed, float value )
+{
+	uint32_t bits;
+	std::memcpy( &bits, &value, sizeof( bits ) );
+	return Combine( seed, static_cast< uint64_t >( bits ) );
+}
+
+uint64_t Combine( uint64_t seed, const RectF& rect )
+{
+	return Combine( Combine( Combine( Combine( seed, rect.x ), rect.y ), rect.w ), rect.h );
+}
+
+} // namespace
+
+ImmediateUi::ImmediateUi( Device& device, LayerId panelId, const UiStyle& style )
+	: _device{ device }
+	, _panelId{ panelId }
+{
+	SetStyle( style );
+}
+
+void ImmediateUi::SetStyle( const UiStyle& style )
+{
+	_style = style;
+	_textFormat = _device.CreateTextFormat( _style.fontFamily, _style.fontSize );
+	_widgets.clear();
+	_panelSignature = 0;
+}
+
+UiId ImmediateUi::MakeId( StringView label ) const
+{
+	return HashText( label, _idStack.empty() ? _panelId : _idStack.back() );
+}
+
+void ImmediateUi::PushId( StringView id )
+{
+	_idStack.push_back( MakeId( id ) );
+}
+
+void ImmediateUi::PushId( uint64_t id )
+{
+	_idStack.push_back( Combine( _idStack.empty() ? _panelId : _idStack.back(), id ) );
+}
+
+void ImmediateUi::PopId()
+{
+	_idStack.pop_back();
+}
+
+ImmediateUi::Widget& ImmediateUi::Prepare( UiId id, StringView text, TextAlignment alignment, const SizeF& size )
+{
+	auto& widget = _widgets[ id ];
+	widget.lastFrame = _frame;
+	if ( widget.textLayout == nullptr || widget.text != text )
+	{
+		widget.text.assign( text );
+		widget.textSize = SizeF{ std::ceil( _device.MeasureText( text, *_textFormat ).width ), _style.fontSize };
+		widget.textLayout = _device.CreateTextLayout( text, *_textFormat, SizeF{ widget.textSize.w + size.w, widget.textSize.h + size.h } );
+		if ( widget.textLayout )
+		{
+			widget.textLayout->SetTextAlignment( alignment );
+			widget.textLayout->SetParagraphAlignment( ParagraphAlignment::Center );
+		}
+	}
+	return widget;
+}
+
+RectF ImmediateUi::NextRect( const SizeF& size )
+{
+	RectF rect{ _bounds.x + _style.spacing, _rowBottom + _style.spacing, size.w, size.h };
+	if ( _sameLine && !_items.empty() )
+	{
+		rect.x = _lastRect.x + _lastRect.w + _style.spacing;
+		rect.y = _lastRect.y;
+	}
+	_sameLine = false;
+
+	_lastRect = rect;
+	_rowBottom = std::max( _rowBottom, rect.y + rect.h );
+	return rect;
+}
+
+bool ImmediateUi::Interact( UiId id, const RectF& rect, uint8_t& state )
+{
+	bool hovered = rect.HasPoint( _mouse ) && _bounds.HasPoint( _mouse );
+	if ( hovered )
+	{
+		_nextHot = id;
+		if ( _mousePressed )
+			_active = id;
+	}
+
+	if ( hovered && ( _active == 0 || _active == id ) )
+		state |= k_StateHovered;
+	if ( hovered && _active == id && !_mouseReleased )
+		state |= k_StatePressed;
+
+	return hovered && _active == id && _mouseReleased;
+}
+
+UiId ImmediateUi::HitTest( const PointF& position ) const
+{
+	if ( !_bounds.HasPoint( position ) )
+		return 0;
+
+	for ( const auto& item : _items )
+	{
+		if ( item.kind != WidgetKind::Label && item.rect.HasPoint( position ) )
+			return item.id;
+	}
+	return 0;
+}
+
+bool ImmediateUi::OnMouse( MouseState state, MouseButton button, const PointF& position )
+{
+	_mouse = position;
+	// Presses outside widgets are dropped, the next frame may be long after them.
+	if ( button == MouseButton::Left && ( state == MouseState::Down || state == MouseState::DoubleClick ) )
+	{
+		_mousePressed = HitTest( position ) != 0;
+		return _mousePressed;
+	}
+	if ( button == MouseButton::Left && state == MouseState::Up )
+	{
+		_mouseReleased = _active != 0 || _mousePressed;
+		return _mouseReleased;
+	}
+
+	// Moves only matter when they change the hovered widget or drag the pressed one.
+	return _active != 0 || HitTest( position ) != _hot;
+}
+
+void ImmediateUi::Begin( DeviceContext& dc, const RectF& bounds )
+{
+	_dc = &dc;
+	_bounds = bounds;
+	_rowBottom = bounds.y;
+	_sameLine = false;
+	_items.clear();
+	_idStack.clear();
+	_nextHot = 0;
+	_frame++;
+}
+
+void ImmediateUi::Label( StringView text )
+{
+	// Labels are identified by their position, so changing text keeps the widget.
+	auto id = Combine( _idStack.empty() ? _panelId : _idStack.back(), static_cast< uint64_t >( _items.size() ) );
+	SizeF padding{ 0, _style.padding * 2 };
+	auto& widget = Prepare( id, text, TextAlignment::Leading, padding );
+	auto rect = NextRect( SizeF{ widget.textSize.w + padding.w, widget.textSize.h + padding.h } );
+	_items.push_back( Item{ id, WidgetKind::Label, 0, rect, &widget } );
+}
+
+bool ImmediateUi::Button( StringView label )
+{
+	auto id = MakeId( label );
+	SizeF padding{ _style.padding * 2, _style.padding * 2 };
+	auto& widget = Prepare( id, label, TextAlignment::Center, padding );
+	auto rect = NextRect( SizeF{ widget.textSize.w + padding.w, widget.textSize.h + padding.h } );
+
+	uint8_t state = 0;
+	bool clicked = Interact( id, rect, state );
+	_items.push_back( Item{ id, WidgetKind::Button, state, rect, &widget } );
+	return clicked;
+}
+
+bool ImmediateUi::Checkbox( StringView label, bool& value )
+{
+	auto id = MakeId( label );
+	// The box is a square of the text height left of the text.
+	auto box = _style.fontSize;
+	SizeF padding{ box + _style.spacing, _style.padding * 2 };
+	auto& widget = Prepare( id, label, TextAlignment::Leading, SizeF{ 0, padding.h } );
+	auto rect = NextRect( SizeF{ widget.textSize.w + padding.w, widget.textSize.h + padding.h } );
+
+	uint8_t state = 0;
+	bool clicked = Interact( id, rect, state );
+	if ( clicked )
+		value = !value;
+	if ( value )
+		state |= k_StateChecked;
+	_items.push_back( Item{ id, WidgetKind::Checkbox, state, rect, &widget } );
+	return clicked;
+}
+
+void ImmediateUi::Draw( const Item& item )
+{
+	const auto& rect = item.rect;
+	auto& textBrush = _dc->CreateFrameSolidBrush( _style.text );
+	RectF stroke{ rect.x + 0.5f, rect.y + 0.5f, rect.w - 1, rect.h - 1 };
+
+	switch ( item.kind )
+	{
+		case WidgetKind::Label:
+		{
+			if ( item.widget->textLayout )
+				_dc->DrawTextLayout( *item.widget->textLayout, textBrush, PointF{ rect.x, rect.y } );
+		} break;
+		case WidgetKind::Button:
+		{
+			if ( item.state & k_StatePressed )
+				_dc->FillSolidRect( _style.pressed, rect );
+			else if ( item.state & k_StateHovered )
+				_dc->FillSolidRect( _style.hovered, rect );
+			else
+				_dc->DrawSolidRect( _style.frame, stroke );
+			if ( item.widget->textLayout )
+				_dc->DrawTextLayout( *item.widget->textLayout, textBrush, PointF{ rect.x, rect.y } );
+		} break;
+		case WidgetKind::Checkbox:
+		{
+			auto box = _style.fontSize;
+			RectF boxRect{ rect.x, rect.y + ( rect.h - box ) * 0.5f, box, box };
+			if ( item.state & k_StateHovered )
+				_dc->FillSolidRect( _style.hovered, boxRect );
+			_dc->DrawSolidRect( _style.frame, RectF{ boxRect.x + 0.5f, boxRect.y + 0.5f, box - 1, box - 1 } );
+			if ( item.state & k_StateChecked )
+				_dc->FillSolidRect( _style.accent, RectF{ boxRect.x + 3, boxRect.y + 3, box - 6, box - 6 } );
+			if ( item.widget->textLayout )
+				_dc->DrawTextLayout( *item.widget->textLayout, textBrush, PointF{ rect.x + box + _style.spacing, rect.y } );
+		} break;
+	}
+}
+
+void ImmediateUi::End()
+{
+	uint64_t panelSignature = Combine( _panelId, _bounds );
+	for ( auto& item : _items )
+	{
+		auto signature = HashText( item.widget->text, static_cast< uint64_t >( item.kind ) );
+		signature = Combine( Combine( signature, item.rect ), static_cast< uint64_t >( item.state ) );
+		panelSignature = Combine( panelSignature, signature );
+
+		// Only the layers of widgets that changed are redrawn, the others are composited.
+		if ( item.widget->signature != signature )
+		{
+			_dc->InvalidateLayer( item.id );
+			item.widget->signature = signature;
+		}
+	}
+
+	if ( panelSignature != _panelSignature )
+	{
+		_dc->InvalidateLayer( _panelId );
+		_panelSignature = panelSignature;
+	}
+
+	if ( _dc->BeginLayer( _panelId, _bounds ) )
+	{
+		for ( const auto& item : _items )
+		{
+			if ( _dc->BeginLayer( item.id, item.rect ) )
+				Draw( item );
+			_dc->EndLayer();
+		}
+	}
+	_dc->EndLayer();
+
+	_hot = _nextHot;
+	if ( _mouseReleased )
+		_active = 0;
+	_mousePressed = false;
+	_mouseReleased = false;
+
+	if ( _frame % k_PruneInterval == 0 )
+		Prune();
+	_dc = nullptr;
+}
+
+void ImmediateUi::Prune()
+{
+	for ( auto it = _widgets.begin(); it != _widgets.end(); )
+	{
+		if ( it->second.lastFrame + k_PruneInterval <= _frame )
+		{
+			_dc->InvalidateLayer( it->first );
+			it = _widgets.erase( it );
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+} // namespace directui
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Graphics.h"
+#include "Window.h"
+
+#include <unordered_map> // for std::unordered_map
+#include <vector> // for std::vector
+#include <memory> // for std::unique_ptr
+#include <cstdint> // for uint64_t
+
+namespace directui
+{
+
+using UiId = uint64_t;
+
+struct UiStyle
+{
+	String fontFamily{ L"Segoe UI" };
+	float fontSize{ 12 };
+	float padding{ 6 }; // between the text and the widget edge
+	float spacing{ 4 }; // between widgets and around the panel
+	graphics::ColorF text{ 0xF1F1F1, 1 };
+	graphics::ColorF frame{ 0x3E3E40, 1 };
+	graphics::ColorF hovered{ 0x505052, 1 };
+	graphics::ColorF pressed{ 0x1B1B1C, 1 };
+	graphics::ColorF accent{ 0x2255FF, 1 };
+};
+
+// Immediate-mode widgets for a panel of a window, declared every frame between Begin and End:
+//
+//     ui.Begin( dc, bounds );
+//     if ( ui.Button( L"File" ) ) ...
+//     ui.End();
+//
+// Widget ids are hashes of the label and the id stack, text layouts and measured sizes are kept
+// per id between frames and rebuilt only when the text changes. Widgets are laid out and
+// interact while they are declared, drawing is deferred to End: the panel and every widget are
+// cached layers, a layer is invalidated only when the inputs of what it shows changed (text,
+// rect, hover and press state). A frame that changes nothing composites the cached panel and
+// draws nothing else.
+//
+// Mouse input is fed from Window::OnMouse and takes effect in the next frame. All calls are
+// made under the draw lock of the window.
+class ImmediateUi
+{
+private:
+	enum class WidgetKind : uint8_t
+	{
+		Label,
+		Button,
+		Checkbox
+	};
+
+	enum : uint8_t
+	{
+		k_StateHovered = 1 << 0,
+		k_StatePressed = 1 << 1,
+		k_StateChecked = 1 << 2
+	};
+
+	struct Widget
+	{
+		String text;
+		std::unique_ptr<graphics::TextLayout> textLayout;
+		graphics::SizeF textSize;
+		uint64_t signature{ 0 }; // of the content in its layer
+		uint64_t lastFrame{ 0 };
+	};
+
+	// Widgets declared in the current frame, in order
+	struct Item
+	{
+		UiId id;
+		WidgetKind kind;
+		uint8_t state;
+		graphics::RectF rect;
+		Widget* widget;
+	};
+
+	static constexpr uint64_t k_PruneInterval = 64; // frames
+
+	graphics::Device& _device;
+	graphics::LayerId _panelId;
+	UiStyle _style;
+	std::unique_ptr<graphics::TextFormat> _textFormat;
+
+	std::unordered_map<UiId, Widget> _widgets;
+	std::vector<Item> _items;
+	std::vector<UiId> _idStack;
+	uint64_t _panelSignature{ 0 };
+	uint64_t _frame{ 0 };
+
+	// Frame
+	graphics::DeviceContext* _dc{ nullptr };
+	graphics::RectF _bounds;
+	graphics::RectF _lastRect;
+	float _rowBottom{ 0 };
+	bool _sameLine{ false };
+
+	// Input, accumulated between frames
+	graphics::PointF _mouse{ -1, -1 };
+	bool _mousePressed{ false };
+	bool _mouseReleased{ false };
+	UiId _hot{ 0 };
+	UiId _nextHot{ 0 };
+	UiId _active{ 0 };
+
+	UiId MakeId( graphics::StringView label ) const;
+	Widget& Prepare( UiId id, graphics::StringView text, graphics::TextAlignment alignment, const graphics::SizeF& size );
+	graphics::RectF NextRect( const graphics::SizeF& size );
+	// Returns true when the widget was clicked.
+	bool Interact( UiId id, const graphics::RectF& rect, uint8_t& state );
+	UiId HitTest( const graphics::PointF& position ) const;
+
+	void Draw( const Item& item );
+	void Prune();
+
+public:
+	// The panel is cached as the layer panelId, widget layers use their hashed ids.
+	ImmediateUi( graphics::Device& device, graphics::LayerId panelId, const UiStyle& style = UiStyle{} );
+
+	const UiStyle& GetStyle() const { return _style; }
+	// Rebuilds every text layout and redraws every widget.
+	void SetStyle( const UiStyle& style );
+
+	// Position in DIPs, returns true when a frame is needed to show the effect.
+	bool OnMouse( MouseState state, MouseButton button, const graphics::PointF& position );
+
+	void Begin( graphics::DeviceContext& dc, const graphics::RectF& bounds );
+	void End();
+
+	// Widgets with equal labels need distinct ids pushed around them.
+	void PushId( graphics::StringView id );
+	void PushId( uint64_t id );
+	void PopId();
+
+	// Places the next widget right of the previous one instead of below it.
+	void SameLine() { _sameLine = true; }
+
+	void Label( graphics::StringView text );
+	bool Button( graphics::StringView label );
+	// Returns true when the value was toggled.
+	bool Checkbox( graphics::StringView label, bool& value );
+};
+
+} // namespace directui
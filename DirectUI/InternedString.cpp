@@ -0,0 +1,216 @@
+#include "InternedString.h"
+
+#include <unordered_map>
+#include <mutex>
+#include <new>
+#include <cstring>
+#include <cwchar>
+
+namespace directui
+{
+
+namespace
+{
+
+// Sharded by hash so threads interning different strings rarely contend.
+class InternTable
+{
+private:
+	static constexpr size_t k_ShardCount = 16;
+
+	struct Shard
+	{
+		std::mutex mutex;
+		std::unordered_multimap<uint32_t, InternedString::Entry*> entries;
+	};
+
+	Shard _shards[ k_ShardCount ];
+	std::atomic<size_t> _count{ 0 };
+
+	Shard& GetShard( uint32_t hash ) { return _shards[ hash % k_ShardCount ]; }
+
+	static bool Matches( const InternedString::Entry& entry, std::wstring_view text )
+	{
+		return entry.length == text.length() && std::wmemcmp( entry.Chars(), text.data(), text.length() ) == 0;
+	}
+
+public:
+	InternedString::Entry* Acquire( std::wstring_view text, uint32_t hash )
+	{
+		auto& shard = GetShard( hash );
+		std::lock_guard<std::mutex> lock{ shard.mutex };
+
+		auto range = shard.entries.equal_range( hash );
+		for ( auto it = range.first; it != range.second; ++it )
+		{
+			auto entry = it->second;
+			if ( !Matches( *entry, text ) )
+				continue;
+
+			// An entry whose count already dropped to zero is being freed by its last owner,
+			// it is unlinked here and replaced by a new one.
+			auto references = entry->references.load( std::memory_order_relaxed );
+			while ( references != 0 )
+			{
+				if ( entry->references.compare_exchange_weak( references, references + 1, std::memory_order_relaxed ) )
+					return entry;
+			}
+			shard.entries.erase( it );
+			break;
+		}
+
+		auto memory = ::operator new( sizeof( InternedString::Entry ) + ( text.length() + 1 ) * sizeof( wchar_t ) );
+		auto entry = new ( memory ) InternedString::Entry{};
+		entry->references.store( 1, std::memory_order_relaxed );
+		entry->hash = hash;
+		entry->length = text.length();
+		std::wmemcpy( entry->Chars(), text.data(), text.length() );
+		entry->Chars()[ text.length() ] = L'\0';
+
+		shard.entries.emplace( hash, entry );
+		_count.fetch_add( 1, std::memory_order_relaxed );
+		return entry;
+	}
+
+	// Called by the owner that dropped the count to zero.
+	void Free( InternedString::Entry* entry )
+	{
+		{
+			auto& shard = GetShard( entry->hash );
+			std::lock_guard<std::mutex> lock{ shard.mutex };
+
+			auto range = shard.entries.equal_range( entry->hash );
+			for ( auto it = range.first; it != range.second; ++it )
+			{
+				if ( it->second == entry )
+				{
+					shard.entries.erase( it );
+					break;
+				}
+			}
+		}
+
+		_count.fetch_sub( 1, std::memory_order_relaxed );
+		entry->~Entry();
+		::operator delete( entry );
+	}
+
+	size_t GetCount() const { return _count.load( std::memory_order_relaxed ); }
+};
+
+InternTable& GetInternTable()
+{
+	static InternTable table;
+	return table;
+}
+
+} // namespace
+
+uint32_t InternedString::ComputeHash( std::wstring_view text )
+{
+	// FNV-1a over code units
+	uint32_t hash = 2166136261u;
+	for ( auto c : text )
+	{
+		hash = ( hash ^ static_cast< uint32_t >( c ) ) * 16777619u;
+	}
+	return hash;
+}
+
+size_t InternedString::GetInternedCount()
+{
+	return GetInternTable().GetCount();
+}
+
+InternedString::InternedString()
+	: _hash{ ComputeHash( std::wstring_view{} ) }
+	, _length{ 0 }
+{
+	std::memset( _inline, 0, sizeof( _inline ) );
+}
+
+InternedString::InternedString( std::wstring_view text )
+	: _hash{ ComputeHash( text ) }
+	, _length{ static_cast< uint32_t >( text.length() ) }
+{
+	// Unused inline characters are zeroed, so inline strings compare as whole blocks.
+	std::memset( _inline, 0, sizeof( _inline ) );
+	if ( IsInline() )
+		std::wmemcpy( _inline, text.data(), text.length() );
+	else
+		_entry = GetInternTable().Acquire( text, _hash );
+}
+
+InternedString::InternedString( const InternedString& other )
+	: _hash{ other._hash }
+	, _length{ other._length }
+{
+	std::memcpy( _inline, other._inline, sizeof( _inline ) );
+	AddReference();
+}
+
+InternedString::InternedString( InternedString&& other ) noexcept
+	: _hash{ other._hash }
+	, _length{ other._length }
+{
+	std::memcpy( _inline, other._inline, sizeof( _inline ) );
+	std::memset( other._inline, 0, sizeof( other._inline ) );
+	other._hash = ComputeHash( std::wstring_view{} );
+	other._length = 0;
+}
+
+InternedString& InternedString::operator=( const InternedString& other )
+{
+	if ( this != &other )
+	{
+		other.AddReference();
+		Release();
+		std::memcpy( _inline, other._inline, sizeof( _inline ) );
+		_hash = other._hash;
+		_length = other._length;
+	}
+	return *this;
+}
+
+InternedString& InternedString::operator=( InternedString&& other ) noexcept
+{
+	if ( this != &other )
+	{
+		Release();
+		std::memcpy( _inline, other._inline, sizeof( _inline ) );
+		_hash = other._hash;
+		_length = other._length;
+		std::memset( other._inline, 0, sizeof( other._inline ) );
+		other._hash = ComputeHash( std::wstring_view{} );
+		other._length = 0;
+	}
+	return *this;
+}
+
+InternedString::~InternedString()
+{
+	Release();
+}
+
+void InternedString::AddReference() const
+{
+	if ( !IsInline() )
+		_entry->references.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void InternedString::Release()
+{
+	if ( !IsInline() && _entry->references.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+		GetInternTable().Free( _entry );
+}
+
+bool InternedString::operator==( const InternedString& other ) const
+{
+	if ( _hash != other._hash || _length != other._length )
+		return false;
+	if ( IsInline() )
+		return std::memcmp( _inline, other._inline, sizeof( _inline ) ) == 0;
+	return _entry == other._entry;
+}
+
+} // namespace directui
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string> // for std::wstring
+#include <string_view> // for std::wstring_view
+#include <atomic> // for std::atomic
+#include <cstdint> // for uint32_t
+#include <cstddef> // for size_t
+#include <functional> // for std::hash
+
+namespace directui
+{
+
+// Immutable UI text. Short strings are stored inline, longer ones are interned in a global
+// table and shared by every InternedString with the same content. The hash is computed once,
+// so equality is a compare of the hash, the length and then either the inline characters or
+// the shared entry pointer, never of the text itself.
+//
+// Converts to std::wstring_view, which every text API of the graphics backends accepts.
+class InternedString
+{
+public:
+	static constexpr size_t k_InlineCapacity = 16 / sizeof( wchar_t );
+
+	struct Entry
+	{
+		std::atomic<uint32_t> references;
+		uint32_t hash;
+		size_t length;
+		wchar_t* Chars() { return reinterpret_cast< wchar_t* >( this + 1 ); }
+		const wchar_t* Chars() const { return reinterpret_cast< const wchar_t* >( this + 1 ); }
+	};
+
+private:
+	union
+	{
+		wchar_t _inline[ k_InlineCapacity ];
+		Entry* _entry;
+	};
+	uint32_t _hash;
+	uint32_t _length;
+
+	bool IsInline() const { return _length <= k_InlineCapacity; }
+	void AddReference() const;
+	void Release();
+
+public:
+	InternedString();
+	InternedString( std::wstring_view text );
+	InternedString( const wchar_t* text ) : InternedString{ std::wstring_view{ text } } {}
+	InternedString( const std::wstring& text ) : InternedString{ std::wstring_view{ text } } {}
+
+	InternedString( const InternedString& other );
+	InternedString( InternedString&& other ) noexcept;
+	InternedString& operator=( const InternedString& other );
+	InternedString& operator=( InternedString&& other ) noexcept;
+	~InternedString();
+
+	// Not null terminated when stored inline.
+	const wchar_t* Data() const { return IsInline() ? _inline : _entry->Chars(); }
+	size_t Length() const { return _length; }
+	bool IsEmpty() const { return _length == 0; }
+	uint32_t Hash() const { return _hash; }
+
+	std::wstring_view View() const { return std::wstring_view{ Data(), _length }; }
+	operator std::wstring_view() const { return View(); }
+	std::wstring ToString() const { return std::wstring{ Data(), _length }; }
+
+	bool operator==( const InternedString& other ) const;
+	bool operator!=( const InternedString& other ) const { return !( *this == other ); }
+
+	static uint32_t ComputeHash( std::wstring_view text );
+	// Number of interned entries alive, for diagnostics.
+	static size_t GetInternedCount();
+};
+
+} // namespace directui
+
+template<>
+struct std::hash<directui::InternedString>
+{
+	size_t operator()( const directui::InternedString& text ) const { return text.Hash(); }
+};
@@ -0,0 +1,143 @@
+#include "LatencyTracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace directui
+{
+
+uint32_t LatencyHistogram::BucketOf( uint64_t microseconds )
+{
+	if ( microseconds < k_SubBuckets )
+		return static_cast< uint32_t >( microseconds );
+
+	uint32_t exponent = 0;
+	for ( auto value = microseconds; value > 1; value >>= 1 )
+	{
+		exponent++;
+	}
+
+	auto subBucket = static_cast< uint32_t >( ( microseconds >> ( exponent - k_SubBucketBits ) ) & ( k_SubBuckets - 1 ) );
+	return std::min( ( exponent - k_SubBucketBits + 1 ) * k_SubBuckets + subBucket, k_BucketCount - 1 );
+}
+
+uint64_t LatencyHistogram::UpperBoundOf( uint32_t bucket )
+{
+	if ( bucket < k_SubBuckets )
+		return bucket;
+
+	auto shift = bucket / k_SubBuckets - 1;
+	auto subBucket = bucket % k_SubBuckets;
+	return ( ( static_cast< uint64_t >( k_SubBuckets + subBucket ) + 1 ) << shift ) - 1;
+}
+
+void LatencyHistogram::Record( Duration latency )
+{
+	auto microseconds = static_cast< uint64_t >( std::max<int64_t>( 0, std::chrono::duration_cast< std::chrono::microseconds >( latency ).count() ) );
+	_buckets[ BucketOf( microseconds ) ]++;
+	_count++;
+	_sumMicroseconds += microseconds;
+	_maxMicroseconds = std::max( _maxMicroseconds, microseconds );
+}
+
+void LatencyHistogram::Clear()
+{
+	*this = LatencyHistogram{};
+}
+
+double LatencyHistogram::GetPercentileMilliseconds( double fraction ) const
+{
+	if ( _count == 0 )
+		return 0.0;
+
+	auto rank = static_cast< uint64_t >( std::ceil( std::clamp( fraction, 0.0, 1.0 ) * _count ) );
+	rank = std::max<uint64_t>( rank, 1 );
+
+	uint64_t seen = 0;
+	for ( uint32_t bucket = 0; bucket < k_BucketCount; ++bucket )
+	{
+		seen += _buckets[ bucket ];
+		if ( seen >= rank )
+			return std::min( UpperBoundOf( bucket ), _maxMicroseconds ) / 1000.0;
+	}
+	return GetMaxMilliseconds();
+}
+
+//------------------------------------------------------------------
+
+LatencySummary LatencyTracker::Summarize( const LatencyHistogram& histogram )
+{
+	LatencySummary summary;
+	summary.count = histogram.GetCount();
+	summary.p50 = histogram.GetPercentileMilliseconds( 0.50 );
+	summary.p95 = histogram.GetPercentileMilliseconds( 0.95 );
+	summary.p99 = histogram.GetPercentileMilliseconds( 0.99 );
+	summary.mean = histogram.GetMeanMilliseconds();
+	summary.max = histogram.GetMaxMilliseconds();
+	return summary;
+}
+
+void LatencyTracker::OnInput( Clock::time_point time )
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	if ( _pending.inputCount == 0 || time < _pending.input )
+		_pending.input = time;
+	_pending.inputCount++;
+}
+
+LatencyTracker::Frame LatencyTracker::BeginFrame( Clock::time_point now )
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	auto frame = _pending;
+	_pending = Frame{};
+	if ( frame.inputCount != 0 && now - frame.input > k_MaxPendingAge )
+		frame = Frame{};
+	return frame;
+}
+
+void LatencyTracker::OnPresent( const Frame& frame, Clock::time_point presentTime,
+	uint64_t presentCount, uint64_t displayedPresentCount, Clock::time_point displayedTime )
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+
+	if ( frame.inputCount != 0 )
+	{
+		_inputToPresent.Record( presentTime - frame.input );
+		if ( presentCount != 0 )
+		{
+			if ( _inFlight.size() == k_MaxInFlight )
+				_inFlight.erase( _inFlight.begin() );
+			_inFlight.push_back( InFlight{ presentCount, frame } );
+		}
+	}
+
+	if ( displayedPresentCount == 0 )
+		return;
+
+	// Statistics only report the latest present on screen, earlier ones were displayed at
+	// unknown times and are dropped.
+	auto it = _inFlight.begin();
+	for ( ; it != _inFlight.end() && it->presentCount <= displayedPresentCount; ++it )
+	{
+		if ( it->presentCount == displayedPresentCount )
+			_inputToDisplay.Record( displayedTime - it->frame.input );
+	}
+	_inFlight.erase( _inFlight.begin(), it );
+}
+
+LatencyStats LatencyTracker::GetStats() const
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	return LatencyStats{ Summarize( _inputToPresent ), Summarize( _inputToDisplay ) };
+}
+
+void LatencyTracker::Reset()
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	_pending = Frame{};
+	_inFlight.clear();
+	_inputToPresent.Clear();
+	_inputToDisplay.Clear();
+}
+
+} // namespace directui
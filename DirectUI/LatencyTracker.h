@@ -0,0 +1,108 @@
+#pragma once
+
+#include <chrono> // for std::chrono::steady_clock
+#include <vector> // for std::vector
+#include <mutex> // for std::mutex
+#include <cstdint> // for uint32_t, uint64_t
+#include <cstddef> // for size_t
+
+namespace directui
+{
+
+// Latency distribution in fixed log-linear buckets, eight per power of two microseconds, so
+// percentiles are within 12.5% of the recorded values at any scale and recording never allocates.
+class LatencyHistogram
+{
+public:
+	using Duration = std::chrono::steady_clock::duration;
+
+private:
+	static constexpr uint32_t k_SubBucketBits = 3;
+	static constexpr uint32_t k_SubBuckets = 1u << k_SubBucketBits;
+	static constexpr uint32_t k_BucketCount = 32 * k_SubBuckets; // up to 2^32 microseconds
+
+	uint64_t _buckets[ k_BucketCount ]{};
+	uint64_t _count{ 0 };
+	uint64_t _sumMicroseconds{ 0 };
+	uint64_t _maxMicroseconds{ 0 };
+
+	static uint32_t BucketOf( uint64_t microseconds );
+	static uint64_t UpperBoundOf( uint32_t bucket );
+
+public:
+	void Record( Duration latency );
+	void Clear();
+
+	uint64_t GetCount() const { return _count; }
+	double GetMeanMilliseconds() const { return _count ? _sumMicroseconds / 1000.0 / _count : 0.0; }
+	double GetMaxMilliseconds() const { return _maxMicroseconds / 1000.0; }
+	// Upper bound of the bucket holding the percentile, fraction between 0 and 1.
+	double GetPercentileMilliseconds( double fraction ) const;
+};
+
+struct LatencySummary
+{
+	uint64_t count{ 0 };
+	double p50{ 0 }, p95{ 0 }, p99{ 0 }, mean{ 0 }, max{ 0 }; // milliseconds
+};
+
+struct LatencyStats
+{
+	LatencySummary inputToPresent;
+	// Only counted when the backend reports when presents reached the screen.
+	LatencySummary inputToDisplay;
+};
+
+// Input-to-photon latency of a window. Input is timestamped when the system received it and
+// attributed to the first frame that starts drawing afterwards. The frame's latency is taken
+// when Present returns, and again once the swap chain statistics show the present on screen.
+//
+// Input that causes no redraw is attributed to whatever frame comes next, so inputs older
+// than k_MaxPendingAge when a frame starts are dropped instead of counted.
+//
+// OnInput is called on the UI thread, the frame calls on the render thread, stats from any thread.
+class LatencyTracker
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr Clock::duration k_MaxPendingAge = std::chrono::seconds{ 1 };
+
+	// Oldest input attributed to a frame, zero when the frame follows no input.
+	struct Frame
+	{
+		Clock::time_point input;
+		uint32_t inputCount{ 0 };
+	};
+
+private:
+	static constexpr size_t k_MaxInFlight = 16;
+
+	struct InFlight
+	{
+		uint64_t presentCount;
+		Frame frame;
+	};
+
+	mutable std::mutex _mutex;
+	Frame _pending;
+	std::vector<InFlight> _inFlight; // presented, not yet seen on screen, oldest first
+	LatencyHistogram _inputToPresent;
+	LatencyHistogram _inputToDisplay;
+
+	static LatencySummary Summarize( const LatencyHistogram& histogram );
+
+public:
+	void OnInput( Clock::time_point time );
+
+	Frame BeginFrame( Clock::time_point now = Clock::now() );
+	// presentCount numbers the present of the frame, displayedPresentCount is the last present
+	// known to be on screen at displayedTime. Counts are zero when the backend does not know them.
+	void OnPresent( const Frame& frame, Clock::time_point presentTime,
+		uint64_t presentCount, uint64_t displayedPresentCount, Clock::time_point displayedTime );
+
+	LatencyStats GetStats() const;
+	void Reset();
+};
+
+} // namespace directui
@@ -0,0 +1,228 @@
+#include "NullGraphics.h"
+
+#include <unordered_set>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+namespace graphics::null
+{
+
+class Brush : public graphics::Brush
+{
+public:
+	static const char* Name() { return "NullBrush"; }
+
+	Brush() : graphics::Brush{ Name() } {}
+};
+
+class GradientBrush : public graphics::GradientBrush
+{
+protected:
+	void OnGeometryChanged() override {}
+	void OnStopsChanged() override {}
+
+public:
+	static const char* Name() { return "NullGradientBrush"; }
+
+	template< typename TGradient >
+	GradientBrush( const TGradient& gradient, const GradientStops& stops ) : graphics::GradientBrush{ Name(), gradient, stops } {}
+};
+
+class TextFormat : public graphics::TextFormat
+{
+private:
+	float _height;
+public:
+	static const char* Name() { return "NullTextFormat"; }
+
+	TextFormat( float height ) : graphics::TextFormat{ Name() }, _height{ height } {}
+
+	float GetHeight() const { return _height; }
+};
+
+class TextLayout : public graphics::TextLayout
+{
+public:
+	static const char* Name() { return "NullTextLayout"; }
+
+	TextLayout() : graphics::TextLayout{ Name() } {}
+
+	void SetTextAlignment( TextAlignment alignment ) override {}
+	void SetParagraphAlignment( ParagraphAlignment alignment ) override {}
+};
+
+class DeviceContext final : public graphics::DeviceContext
+{
+private:
+	std::unordered_set<LayerKey, LayerKeyHash> _validLayers;
+	std::vector<DpiBucket> _layerDpis;
+	RectF _drawRect;
+	float _dpi{ 96.0f };
+	directui::SizePx _offscreenSize;
+	ReadbackId _nextReadbackId{ 1 };
+
+public:
+	static const char* Name() { return "NullDeviceContext"; }
+
+	DeviceContext() : graphics::DeviceContext{ Name() } {}
+
+	std::unique_ptr<graphics::Brush> CreateSolidBrush( const ColorF& color ) override
+	{
+		return std::unique_ptr<graphics::Brush>( new Brush{} );
+	}
+
+	Brush& CreateFrameSolidBrush( const ColorF& color ) override
+	{
+		return *_frameArena.New<Brush>();
+	}
+
+	TextLayout& CreateFrameTextLayout( StringView text, const graphics::TextFormat& format, const SizeF& sizeFit ) override
+	{
+		return *_frameArena.New<TextLayout>();
+	}
+
+	void BeginDraw( directui::Handle windowHandle ) override
+	{
+		_frameArena.Reset();
+	}
+
+	void BeginDraw( const directui::SizePx& sizePx, float dpi ) override
+	{
+		_frameArena.Reset();
+		_offscreenSize = sizePx;
+		_dpi = dpi;
+		_drawRect = RectF{ 0, 0, sizePx.w * 96.0f / dpi, sizePx.h * 96.0f / dpi };
+	}
+
+	void EndDraw() override {}
+
+	ReadbackId QueueReadback( void* pixels, int stride ) override
+	{
+		for ( int y = 0; y < _offscreenSize.h; ++y )
+		{
+			memset( static_cast< uint8_t* >( pixels ) + y * stride, 0, static_cast< size_t >( _offscreenSize.w ) * 4 );
+		}
+		return _nextReadbackId++;
+	}
+
+	bool PollReadback( ReadbackId id, bool wait ) override { return true; }
+
+	RectF GetDrawRect() override { return _drawRect; }
+	float GetDpi() override { return _dpi; }
+
+	void Clear( const ColorF& color ) override {}
+	void FillRect( graphics::Brush& brush, const RectF& rect ) override {}
+	void DrawRect( graphics::Brush& brush, const RectF& rect, float strokeWidth ) override {}
+	void DrawTextLayout( const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position ) override {}
+
+	void FillRect( Brush& brush, const RectF& rect ) {}
+	void DrawRect( Brush& brush, const RectF& rect, float strokeWidth ) {}
+	void DrawTextLayout( const TextLayout& layout, Brush& brush, const PointF& position ) {}
+
+	void PushClip( const RectF& rect ) override {}
+	void PopClip() override {}
+
+	bool BeginLayer( LayerId id, const RectF& bounds ) override
+	{
+		LayerKey key{ id, ToDpiBucket( _dpi ) };
+		if ( std::find( _layerDpis.begin(), _layerDpis.end(), key.dpi ) == _layerDpis.end() )
+			_layerDpis.push_back( key.dpi );
+		return _validLayers.insert( key ).second;
+	}
+
+	void EndLayer( const Matrix3x2F& transform, float opacity ) override {}
+
+	void InvalidateLayer( LayerId id ) override
+	{
+		for ( auto dpi : _layerDpis )
+		{
+			_validLayers.erase( LayerKey{ id, dpi } );
+		}
+	}
+};
+
+class Device : public graphics::Device
+{
+public:
+	std::unique_ptr<graphics::DeviceContext> CreateDeviceContext() override
+	{
+		return std::unique_ptr<graphics::DeviceContext>( new DeviceContext{} );
+	}
+
+	std::unique_ptr<graphics::TextFormat> CreateTextFormat( const String& fontFamily, float height ) override
+	{
+		return std::unique_ptr<graphics::TextFormat>( new TextFormat{ height } );
+	}
+
+	std::unique_ptr<graphics::TextLayout> CreateTextLayout( StringView text, const graphics::TextFormat& format, const SizeF& sizeFit ) override
+	{
+		return std::unique_ptr<graphics::TextLayout>( new TextLayout{} );
+	}
+
+	std::unique_ptr<graphics::Brush> CreateSolidBrush( const ColorF& color ) override
+	{
+		return std::unique_ptr<graphics::Brush>( new Brush{} );
+	}
+
+	std::unique_ptr<graphics::GradientBrush> CreateGradientBrush( const LinearGradient& gradient, const GradientStops& stops ) override
+	{
+		return std::unique_ptr<graphics::GradientBrush>( new GradientBrush{ gradient, stops } );
+	}
+
+	std::unique_ptr<graphics::GradientBrush> CreateGradientBrush( const RadialGradient& gradient, const GradientStops& stops ) override
+	{
+		return std::unique_ptr<graphics::GradientBrush>( new GradientBrush{ gradient, stops } );
+	}
+
+	// Approximates an average glyph as half an em wide.
+	TextMetrics MeasureText( StringView text, const graphics::TextFormat& format, float maxWidth ) override
+	{
+		float height = 0;
+		if ( auto pFormat = format.As<TextFormat>() )
+		{
+			height = pFormat->GetHeight();
+		}
+		return TextMetrics{ text.length() * height * 0.5f, height * 1.2f, 1 };
+	}
+};
+
+DeviceContext* Backend::Cast( graphics::DeviceContext& dc ) { return dc.As<DeviceContext>(); }
+Brush* Backend::Cast( graphics::Brush& brush ) { return brush.As<Brush>(); }
+const TextLayout* Backend::Cast( const graphics::TextLayout& layout ) { return layout.As<TextLayout>(); }
+
+// DeviceContext is final, so the calls below are bound statically.
+Brush& Backend::CreateFrameSolidBrush( DeviceContext& dc, const ColorF& color ) { return dc.CreateFrameSolidBrush( color ); }
+TextLayout& Backend::CreateFrameTextLayout( DeviceContext& dc, StringView text, const graphics::TextFormat& format, const SizeF& sizeFit )
+{
+	return dc.CreateFrameTextLayout( text, format, sizeFit );
+}
+
+void Backend::Clear( DeviceContext& dc, const ColorF& color ) { dc.Clear( color ); }
+void Backend::FillRect( DeviceContext& dc, Brush& brush, const RectF& rect ) { dc.FillRect( brush, rect ); }
+void Backend::FillRect( DeviceContext& dc, graphics::Brush& brush, const RectF& rect ) { dc.FillRect( brush, rect ); }
+void Backend::DrawRect( DeviceContext& dc, Brush& brush, const RectF& rect, float strokeWidth ) { dc.DrawRect( brush, rect, strokeWidth ); }
+void Backend::DrawRect( DeviceContext& dc, graphics::Brush& brush, const RectF& rect, float strokeWidth ) { dc.DrawRect( brush, rect, strokeWidth ); }
+void Backend::DrawTextLayout( DeviceContext& dc, const TextLayout& layout, Brush& brush, const PointF& position ) { dc.DrawTextLayout( layout, brush, position ); }
+void Backend::DrawTextLayout( DeviceContext& dc, const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position )
+{
+	dc.DrawTextLayout( layout, brush, position );
+}
+
+// Mixed objects take the virtual path of the context, which downcasts both.
+void Backend::DrawTextLayout( DeviceContext& dc, const graphics::TextLayout& layout, Brush& brush, const PointF& position )
+{
+	dc.DrawTextLayout( layout, static_cast< graphics::Brush& >( brush ), position );
+}
+
+void Backend::DrawTextLayout( DeviceContext& dc, const TextLayout& layout, graphics::Brush& brush, const PointF& position )
+{
+	dc.DrawTextLayout( static_cast< const graphics::TextLayout& >( layout ), brush, position );
+}
+
+std::unique_ptr<graphics::Device> CreateDevice()
+{
+	return std::unique_ptr<graphics::Device>( new Device{} );
+}
+
+} // namespace graphics::null
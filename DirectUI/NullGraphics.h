@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Graphics.h"
+
+namespace graphics::null
+{
+
+class DeviceContext;
+class Brush;
+class TextLayout;
+
+// Statically bound primitives for graphics::StaticDeviceContext.
+struct Backend
+{
+	using DeviceContext = null::DeviceContext;
+	using Brush = null::Brush;
+	using TextLayout = null::TextLayout;
+
+	// Null when the object was not created by this backend.
+	static DeviceContext* Cast( graphics::DeviceContext& dc );
+	static Brush* Cast( graphics::Brush& brush );
+	static const TextLayout* Cast( const graphics::TextLayout& layout );
+
+	static Brush& CreateFrameSolidBrush( DeviceContext& dc, const ColorF& color );
+	static TextLayout& CreateFrameTextLayout( DeviceContext& dc, StringView text, const graphics::TextFormat& format, const SizeF& sizeFit );
+
+	static void Clear( DeviceContext& dc, const ColorF& color );
+	static void FillRect( DeviceContext& dc, Brush& brush, const RectF& rect );
+	static void FillRect( DeviceContext& dc, graphics::Brush& brush, const RectF& rect );
+	static void DrawRect( DeviceContext& dc, Brush& brush, const RectF& rect, float strokeWidth );
+	static void DrawRect( DeviceContext& dc, graphics::Brush& brush, const RectF& rect, float strokeWidth );
+	static void DrawTextLayout( DeviceContext& dc, const TextLayout& layout, Brush& brush, const PointF& position );
+	static void DrawTextLayout( DeviceContext& dc, const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position );
+	static void DrawTextLayout( DeviceContext& dc, const graphics::TextLayout& layout, Brush& brush, const PointF& position );
+	static void DrawTextLayout( DeviceContext& dc, const TextLayout& layout, graphics::Brush& brush, const PointF& position );
+};
+
+// Backend that accepts every call and draws nothing, used to measure the cost of the
+// layers above the backend and to run headless.
+std::unique_ptr<graphics::Device> CreateDevice();
+
+} // namespace graphics::null
@@ -0,0 +1,89 @@
+#include "PointerHistory.h"
+
+#include <cmath>
+
+namespace directui
+{
+
+void PointerHistory::Add( const PointerSample& sample )
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	if ( !_recent.empty() && sample.time < _recent.back().time )
+		return;
+
+	_pending.push_back( sample );
+
+	size_t stale = 0;
+	while ( stale < _recent.size() && sample.time - _recent[ stale ].time > k_VelocityWindow )
+	{
+		stale++;
+	}
+	_recent.erase( _recent.begin(), _recent.begin() + stale );
+	_recent.push_back( sample );
+}
+
+bool PointerHistory::HasPending() const
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	return !_pending.empty();
+}
+
+void PointerHistory::Take( std::vector<PointerSample>& batch )
+{
+	batch.clear();
+	std::lock_guard<std::mutex> lock{ _mutex };
+	batch.swap( _pending );
+}
+
+void PointerHistory::Clear()
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	_pending.clear();
+	_recent.clear();
+}
+
+std::optional<PointPx> PointerHistory::Predict( Clock::duration ahead, Clock::time_point now ) const
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	if ( _recent.empty() )
+		return std::nullopt;
+
+	const auto& last = _recent.back();
+	if ( _recent.size() < 2 || now - last.time > k_RestTime )
+		return last.position;
+
+	// Least squares fit of position over time, times in seconds relative to the last sample.
+	auto seconds = [&last] ( const PointerSample& sample ) {
+		return std::chrono::duration<double>( sample.time - last.time ).count();
+	};
+
+	double meanT = 0, meanX = 0, meanY = 0;
+	for ( const auto& sample : _recent )
+	{
+		meanT += seconds( sample );
+		meanX += sample.position.x;
+		meanY += sample.position.y;
+	}
+	auto count = static_cast< double >( _recent.size() );
+	meanT /= count;
+	meanX /= count;
+	meanY /= count;
+
+	double varianceT = 0, covarianceX = 0, covarianceY = 0;
+	for ( const auto& sample : _recent )
+	{
+		auto dt = seconds( sample ) - meanT;
+		varianceT += dt * dt;
+		covarianceX += dt * ( sample.position.x - meanX );
+		covarianceY += dt * ( sample.position.y - meanY );
+	}
+	if ( varianceT <= 0 )
+		return last.position;
+
+	auto horizon = std::chrono::duration<double>( ahead ).count();
+	return PointPx{
+		last.position.x + static_cast< int >( std::lround( covarianceX / varianceT * horizon ) ),
+		last.position.y + static_cast< int >( std::lround( covarianceY / varianceT * horizon ) ) };
+}
+
+} // namespace directui
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CoreTypes.h"
+
+#include <vector> // for std::vector
+#include <mutex> // for std::mutex
+#include <chrono> // for std::chrono::steady_clock
+#include <optional> // for std::optional
+
+namespace directui
+{
+
+struct PointerSample
+{
+	PointPx position; // client pixels
+	std::chrono::steady_clock::time_point time;
+};
+
+// Pointer samples collected between two frames, oldest first.
+struct PointerBatch
+{
+	const std::vector<PointerSample>& samples;
+	// Where the pointer is expected at the prediction horizon after the last sample.
+	std::optional<PointPx> predicted;
+};
+
+// Coalesced pointer samples waiting for the next frame. Samples are added on the UI thread and
+// taken by the thread that draws, the batch vectors are swapped so neither side allocates once
+// both have grown to the usual batch size.
+class PointerHistory
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Velocity is fitted over the samples this close to the last one.
+	static constexpr Clock::duration k_VelocityWindow = std::chrono::milliseconds{ 50 };
+	// A pointer without samples for this long is at rest and predicted where it is.
+	static constexpr Clock::duration k_RestTime = std::chrono::milliseconds{ 100 };
+
+private:
+	mutable std::mutex _mutex;
+	std::vector<PointerSample> _pending;
+	// Samples within the velocity window, kept across batches so a batch of a single sample
+	// still has a velocity.
+	std::vector<PointerSample> _recent;
+
+public:
+	// Samples older than the last added one are ignored.
+	void Add( const PointerSample& sample );
+	bool HasPending() const;
+
+	// Moves the pending samples into batch, which is cleared first.
+	void Take( std::vector<PointerSample>& batch );
+	void Clear();
+
+	// Linear extrapolation of the recent motion, nothing without at least one sample.
+	std::optional<PointPx> Predict( Clock::duration ahead, Clock::time_point now = Clock::now() ) const;
+};
+
+} // namespace directui
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Graphics.h"
+
+#include <utility> // for std::forward
+
+namespace graphics
+{
+
+// Drawing front-end bound to one backend at compile time. TBackend is the Backend struct of a
+// backend header (cpu::Backend, dx::Backend, null::Backend), its functions call the final
+// backend context directly, so primitives cost no virtual call and, for brushes and text
+// layouts of the backend types, no downcast. They are defined with the backend and inline
+// into the draw code under whole program optimization.
+//
+// Objects of other types (gradient brushes, objects held through the base classes) are
+// accepted too and downcast by the backend as on the virtual path. Calls that are not
+// primitives go through the virtual DeviceContext, which stays the interface of everything
+// else. Draw code is usually written once as a generic lambda and run by DrawStatic:
+//
+//     DrawStatic<cpu::Backend>( dc, [&] ( auto& dc ) {
+//         auto& brush = dc.CreateFrameSolidBrush( color );
+//         for ( const auto& rect : rects )
+//             dc.FillRect( brush, rect );
+//     } );
+template< typename TBackend >
+class StaticDeviceContext
+{
+public:
+	using Context = typename TBackend::DeviceContext;
+	using Brush = typename TBackend::Brush;
+	using TextLayout = typename TBackend::TextLayout;
+
+private:
+	Context& _context;
+	DeviceContext& _adapter; // the same context through the virtual interface
+
+public:
+	StaticDeviceContext( Context& context, DeviceContext& adapter ) : _context{ context }, _adapter{ adapter } {}
+
+	DeviceContext& GetAdapter() { return _adapter; }
+
+	Brush& CreateFrameSolidBrush( const ColorF& color ) { return TBackend::CreateFrameSolidBrush( _context, color ); }
+	TextLayout& CreateFrameTextLayout( StringView text, const TextFormat& format, const SizeF& sizeFit )
+	{
+		return TBackend::CreateFrameTextLayout( _context, text, format, sizeFit );
+	}
+
+	RectF GetDrawRect() { return _adapter.GetDrawRect(); }
+	float GetDpi() { return _adapter.GetDpi(); }
+
+	void Clear( const ColorF& color ) { TBackend::Clear( _context, color ); }
+
+	void FillRect( Brush& brush, const RectF& rect ) { TBackend::FillRect( _context, brush, rect ); }
+	void FillRect( graphics::Brush& brush, const RectF& rect ) { TBackend::FillRect( _context, brush, rect ); }
+
+	void DrawRect( Brush& brush, const RectF& rect, float strokeWidth = 1.0f ) { TBackend::DrawRect( _context, brush, rect, strokeWidth ); }
+	void DrawRect( graphics::Brush& brush, const RectF& rect, float strokeWidth = 1.0f ) { TBackend::DrawRect( _context, brush, rect, strokeWidth ); }
+
+	void DrawTextLayout( const TextLayout& layout, Brush& brush, const PointF& position )
+	{
+		TBackend::DrawTextLayout( _context, layout, brush, position );
+	}
+	void DrawTextLayout( const graphics::TextLayout& layout, graphics::Brush& brush, const PointF& position )
+	{
+		TBackend::DrawTextLayout( _context, layout, brush, position );
+	}
+	void DrawTextLayout( const graphics::TextLayout& layout, Brush& brush, const PointF& position )
+	{
+		TBackend::DrawTextLayout( _context, layout, brush, position );
+	}
+	void DrawTextLayout( const TextLayout& layout, graphics::Brush& brush, const PointF& position )
+	{
+		TBackend::DrawTextLayout( _context, layout, brush, position );
+	}
+
+	void FillSolidRect( const ColorF& color, const RectF& rect ) { FillRect( CreateFrameSolidBrush( color ), rect ); }
+	void DrawSolidRect( const ColorF& color, const RectF& rect, float strokeWidth = 1.0f ) { DrawRect( CreateFrameSolidBrush( color ), rect, strokeWidth ); }
+
+	void PushClip( const RectF& rect ) { _adapter.PushClip( rect ); }
+	void PopClip() { _adapter.PopClip(); }
+
+	bool BeginLayer( LayerId id, const RectF& bounds ) { return _adapter.BeginLayer( id, bounds ); }
+	void EndLayer( const Matrix3x2F& transform = Matrix3x2F::Identity(), float opacity = 1.0f ) { _adapter.EndLayer( transform, opacity ); }
+	void InvalidateLayer( LayerId id ) { _adapter.InvalidateLayer( id ); }
+};
+
+// Calls draw with a StaticDeviceContext when dc is a context of TBackend, with dc itself
+// otherwise, for example when a capture context wraps it.
+template< typename TBackend, typename TDraw >
+void DrawStatic( DeviceContext& dc, TDraw&& draw )
+{
+	if ( auto context = TBackend::Cast( dc ) )
+	{
+		StaticDeviceContext<TBackend> staticContext{ *context, dc };
+		std::forward<TDraw>( draw )( staticContext );
+	}
+	else
+	{
+		std::forward<TDraw>( draw )( dc );
+	}
+}
+
+} // namespace graphics
@@ -0,0 +1,257 @@
+#include "StyleSheet.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace directui
+{
+
+namespace
+{
+
+uint32_t CountBits( uint64_t value )
+{
+	uint32_t count = 0;
+	for ( ; value != 0; value &= value - 1 )
+	{
+		count++;
+	}
+	return count;
+}
+
+uint64_t QuantizeColor( const graphics::ColorF& color )
+{
+	auto channel = [] ( float value ) {
+		return static_cast< uint64_t >( std::clamp( value, 0.0f, 1.0f ) * 65535.0f + 0.5f );
+	};
+	return channel( color.r ) | channel( color.g ) << 16 | channel( color.b ) << 32 | channel( color.a ) << 48;
+}
+
+} // namespace
+
+uint32_t StyleSelector::GetSpecificity() const
+{
+	return ( type.IsEmpty() ? 0 : 1 ) + 10 * ( CountBits( classes ) + CountBits( states ) );
+}
+
+bool StyleSelector::Matches( const InternedString& widgetType, StyleClassSet widgetClasses, WidgetFlags widgetStates ) const
+{
+	return ( type.IsEmpty() || type == widgetType ) &&
+		( classes & ~widgetClasses ) == 0 &&
+		( states & ~widgetStates ) == 0;
+}
+
+size_t StyleSheet::KeyHash::operator()( const Key& key ) const
+{
+	size_t hash = key.type.Hash();
+	hash ^= std::hash<uint64_t>{}( key.classes ) + 0x9E3779B9 + ( hash << 6 ) + ( hash >> 2 );
+	hash ^= std::hash<uint32_t>{}( key.states ) + 0x9E3779B9 + ( hash << 6 ) + ( hash >> 2 );
+	return hash;
+}
+
+StyleClassSet StyleSheet::GetClass( const InternedString& name )
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	auto it = std::find( _classes.begin(), _classes.end(), name );
+	if ( it == _classes.end() )
+	{
+		if ( _classes.size() == k_MaxClasses )
+			throw std::length_error( "Too many style classes" );
+		it = _classes.insert( _classes.end(), name );
+	}
+	return StyleClassSet{ 1 } << ( it - _classes.begin() );
+}
+
+StyleClassSet StyleSheet::GetClasses( std::initializer_list<InternedString> names )
+{
+	StyleClassSet classes = 0;
+	for ( const auto& name : names )
+	{
+		classes |= GetClass( name );
+	}
+	return classes;
+}
+
+template< typename TPredicate >
+void StyleSheet::Invalidate( TPredicate&& dependsOn )
+{
+	for ( auto it = _cache.begin(); it != _cache.end(); )
+	{
+		if ( dependsOn( it->first, it->second ) )
+			it = _cache.erase( it );
+		else
+			++it;
+	}
+}
+
+// Removes the entries whose objects were released once the map reached the limit, the limit then
+// doubles the live entries so pruning costs amortized constant time per insertion.
+template< typename TMap >
+void StyleSheet::PruneExpired( TMap& map, size_t& limit )
+{
+	if ( map.size() < limit )
+		return;
+
+	for ( auto it = map.begin(); it != map.end(); )
+	{
+		if ( it->second.expired() )
+			it = map.erase( it );
+		else
+			++it;
+	}
+	limit = std::max( k_MinPruneLimit, map.size() * 2 );
+}
+
+StyleRuleId StyleSheet::AddRule( const StyleSelector& selector, const StyleDeclaration& declaration )
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	auto id = static_cast< StyleRuleId >( _rules.size() );
+	_rules.push_back( Rule{ selector, declaration } );
+
+	// Keys of widgets in states no rule referred to before are new keys, existing entries only
+	// change when the new rule matches them.
+	_referencedStates |= selector.states;
+	Invalidate( [&selector] ( const Key& key, const Entry& ) { return selector.Matches( key.type, key.classes, key.states ); } );
+	return id;
+}
+
+void StyleSheet::SetDeclaration( StyleRuleId rule, const StyleDeclaration& declaration )
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	_rules.at( rule ).declaration = declaration;
+	Invalidate( [rule] ( const Key&, const Entry& entry ) {
+		return std::find( entry.rules.begin(), entry.rules.end(), rule ) != entry.rules.end();
+	} );
+}
+
+void StyleSheet::RemoveRule( StyleRuleId rule )
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	_rules.at( rule ).removed = true;
+	Invalidate( [rule] ( const Key&, const Entry& entry ) {
+		return std::find( entry.rules.begin(), entry.rules.end(), rule ) != entry.rules.end();
+	} );
+}
+
+void StyleSheet::SetVariable( const InternedString& name, const graphics::ColorF& color )
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	_variables[ name ] = color;
+	Invalidate( [&name] ( const Key&, const Entry& entry ) {
+		return std::find( entry.variables.begin(), entry.variables.end(), name ) != entry.variables.end();
+	} );
+}
+
+graphics::ColorF StyleSheet::ResolveColor( const StyleColor& color, Entry& entry ) const
+{
+	if ( color.variable.IsEmpty() )
+		return color.value;
+
+	// Undefined variables resolve to transparent, the entry still depends on them.
+	if ( std::find( entry.variables.begin(), entry.variables.end(), color.variable ) == entry.variables.end() )
+		entry.variables.push_back( color.variable );
+	auto it = _variables.find( color.variable );
+	return it != _variables.end() ? it->second : graphics::ColorF{};
+}
+
+std::shared_ptr<graphics::Brush> StyleSheet::GetBrush( const graphics::ColorF& color )
+{
+	if ( color.a <= 0 )
+		return nullptr;
+
+	auto key = QuantizeColor( color );
+	auto it = _brushes.find( key );
+	if ( it != _brushes.end() )
+	{
+		if ( auto brush = it->second.lock() )
+			return brush;
+	}
+
+	PruneExpired( _brushes, _brushesPruneLimit );
+	std::shared_ptr<graphics::Brush> brush = _device.CreateSolidBrush( color );
+	_brushes[ key ] = brush;
+	return brush;
+}
+
+std::shared_ptr<graphics::TextFormat> StyleSheet::GetTextFormat( const graphics::String& fontFamily, float fontSize )
+{
+	auto key = std::make_pair( fontFamily, fontSize );
+	auto it = _textFormats.find( key );
+	if ( it != _textFormats.end() )
+	{
+		if ( auto format = it->second.lock() )
+			return format;
+	}
+
+	PruneExpired( _textFormats, _textFormatsPruneLimit );
+	std::shared_ptr<graphics::TextFormat> format = _device.CreateTextFormat( fontFamily, fontSize );
+	_textFormats[ key ] = format;
+	return format;
+}
+
+StyleSheet::Entry StyleSheet::Compute( const Key& key )
+{
+	Entry entry;
+	for ( StyleRuleId id = 0; id < _rules.size(); ++id )
+	{
+		const auto& rule = _rules[ id ];
+		if ( !rule.removed && rule.selector.Matches( key.type, key.classes, key.states ) )
+			entry.rules.push_back( id );
+	}
+
+	// Less specific rules first, equally specific ones in the order they were added.
+	std::stable_sort( entry.rules.begin(), entry.rules.end(), [this] ( StyleRuleId a, StyleRuleId b ) {
+		return _rules[ a ].selector.GetSpecificity() < _rules[ b ].selector.GetSpecificity();
+	} );
+
+	auto style = std::make_shared<ComputedStyle>();
+	for ( auto id : entry.rules )
+	{
+		const auto& declaration = _rules[ id ].declaration;
+		if ( declaration.background )
+			style->background = ResolveColor( *declaration.background, entry );
+		if ( declaration.foreground )
+			style->foreground = ResolveColor( *declaration.foreground, entry );
+		if ( declaration.border )
+			style->border = ResolveColor( *declaration.border, entry );
+		if ( declaration.borderWidth )
+			style->borderWidth = *declaration.borderWidth;
+		if ( declaration.fontFamily )
+			style->fontFamily = *declaration.fontFamily;
+		if ( declaration.fontSize )
+			style->fontSize = *declaration.fontSize;
+	}
+
+	style->backgroundBrush = GetBrush( style->background );
+	style->foregroundBrush = GetBrush( style->foreground );
+	style->borderBrush = style->borderWidth > 0 ? GetBrush( style->border ) : nullptr;
+	style->textFormat = GetTextFormat( style->fontFamily, style->fontSize );
+	entry.style = std::move( style );
+	return entry;
+}
+
+std::shared_ptr<const ComputedStyle> StyleSheet::Resolve( const InternedString& type, StyleClassSet classes, WidgetFlags states )
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	Key key{ type, classes, states & _referencedStates };
+
+	auto it = _cache.find( key );
+	if ( it != _cache.end() )
+	{
+		_stats.hits++;
+		return it->second.style;
+	}
+
+	_stats.misses++;
+	return _cache.emplace( key, Compute( key ) ).first->second.style;
+}
+
+StyleSheet::Stats StyleSheet::GetStats() const
+{
+	std::lock_guard<std::mutex> lock{ _mutex };
+	auto stats = _stats;
+	stats.entries = _cache.size();
+	return stats;
+}
+
+} // namespace directui
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "Graphics.h"
+#include "InternedString.h"
+#include "WidgetStore.h"
+
+#include <memory> // for std::shared_ptr
+#include <optional> // for std::optional
+#include <vector> // for std::vector
+#include <unordered_map> // for std::unordered_map
+#include <map> // for std::map
+#include <initializer_list> // for std::initializer_list
+#include <mutex> // for std::mutex
+#include <cstdint> // for uint32_t, uint64_t
+
+namespace directui
+{
+
+// Bit per class name registered in a StyleSheet.
+using StyleClassSet = uint64_t;
+using StyleRuleId = uint32_t;
+
+// A color given directly, or by the name of a theme variable of the sheet.
+struct StyleColor
+{
+	graphics::ColorF value;
+	InternedString variable;
+
+	StyleColor() {}
+	StyleColor( const graphics::ColorF& value ) : value{ value } {}
+	StyleColor( const InternedString& variable ) : variable{ variable } {}
+};
+
+// Matches widgets of the type (any type when empty) that have all the classes and all the
+// state flags of the selector. More classes and states make a selector more specific than a type.
+struct StyleSelector
+{
+	InternedString type;
+	StyleClassSet classes{ 0 };
+	WidgetFlags states{ 0 };
+
+	uint32_t GetSpecificity() const;
+	bool Matches( const InternedString& widgetType, StyleClassSet widgetClasses, WidgetFlags widgetStates ) const;
+};
+
+// Properties a rule sets, unset ones come from less specific rules or the defaults.
+struct StyleDeclaration
+{
+	std::optional<StyleColor> background;
+	std::optional<StyleColor> foreground;
+	std::optional<StyleColor> border;
+	std::optional<float> borderWidth;
+	std::optional<graphics::String> fontFamily;
+	std::optional<float> fontSize;
+};
+
+// Resolved properties with the native objects to draw them. Brushes and text formats are
+// shared by every computed style with the same color or font.
+struct ComputedStyle
+{
+	graphics::ColorF background;
+	graphics::ColorF foreground{ 0, 0, 0, 1 };
+	graphics::ColorF border;
+	float borderWidth{ 0 };
+	graphics::String fontFamily{ L"Segoe UI" };
+	float fontSize{ 12 };
+
+	std::shared_ptr<graphics::Brush> backgroundBrush;
+	std::shared_ptr<graphics::Brush> foregroundBrush;
+	std::shared_ptr<graphics::Brush> borderBrush;
+	std::shared_ptr<graphics::TextFormat> textFormat;
+};
+
+// Rules with type, class and state selectors. Computed styles are cached per widget type, class
+// set and the states any rule refers to, so a widget changing between states it has been drawn
+// in before is a lookup. Each cache entry remembers the rules and variables it was computed from,
+// and changing one of them drops only the entries that depend on it.
+class StyleSheet
+{
+public:
+	struct Stats
+	{
+		uint64_t hits{ 0 };
+		uint64_t misses{ 0 };
+		size_t entries{ 0 };
+	};
+
+private:
+	static constexpr size_t k_MaxClasses = 64;
+	static constexpr size_t k_MinPruneLimit = 64;
+
+	struct Rule
+	{
+		StyleSelector selector;
+		StyleDeclaration declaration;
+		bool removed{ false };
+	};
+
+	struct Key
+	{
+		InternedString type;
+		StyleClassSet classes;
+		WidgetFlags states;
+
+		bool operator==( const Key& other ) const { return type == other.type && classes == other.classes && states == other.states; }
+	};
+
+	struct KeyHash
+	{
+		size_t operator()( const Key& key ) const;
+	};
+
+	struct Entry
+	{
+		std::shared_ptr<const ComputedStyle> style;
+		std::vector<StyleRuleId> rules;
+		std::vector<InternedString> variables;
+	};
+
+	graphics::Device& _device;
+	mutable std::mutex _mutex;
+
+	std::vector<Rule> _rules;
+	std::vector<InternedString> _classes; // bit index is the position
+	std::unordered_map<InternedString, graphics::ColorF> _variables;
+	WidgetFlags _referencedStates{ 0 };
+
+	std::unordered_map<Key, Entry, KeyHash> _cache;
+	Stats _stats;
+
+	// Native objects by value, alive while a computed style holds them. Brushes are keyed by
+	// the color with 16 bits per channel.
+	std::unordered_map<uint64_t, std::weak_ptr<graphics::Brush>> _brushes;
+	std::map<std::pair<graphics::String, float>, std::weak_ptr<graphics::TextFormat>> _textFormats;
+	// Expired entries are pruned on insertion once a map reaches its limit, see PruneExpired.
+	size_t _brushesPruneLimit{ k_MinPruneLimit };
+	size_t _textFormatsPruneLimit{ k_MinPruneLimit };
+
+	template< typename TPredicate >
+	void Invalidate( TPredicate&& dependsOn );
+	template< typename TMap >
+	static void PruneExpired( TMap& map, size_t& limit );
+
+	Entry Compute( const Key& key );
+	graphics::ColorF ResolveColor( const StyleColor& color, Entry& entry ) const;
+	std::shared_ptr<graphics::Brush> GetBrush( const graphics::ColorF& color );
+	std::shared_ptr<graphics::TextFormat> GetTextFormat( const graphics::String& fontFamily, float fontSize );
+
+public:
+	explicit StyleSheet( graphics::Device& device ) : _device{ device } {}
+
+	// Registers the class on first use, at most k_MaxClasses per sheet.
+	StyleClassSet GetClass( const InternedString& name );
+	StyleClassSet GetClasses( std::initializer_list<InternedString> names );
+
+	StyleRuleId AddRule( const StyleSelector& selector, const StyleDeclaration& declaration );
+	void SetDeclaration( StyleRuleId rule, const StyleDeclaration& declaration );
+	void RemoveRule( StyleRuleId rule );
+
+	void SetVariable( const InternedString& name, const graphics::ColorF& color );
+
+	// Valid as long as the caller holds it, later changes to the sheet produce new styles.
+	std::shared_ptr<const ComputedStyle> Resolve( const InternedString& type, StyleClassSet classes, WidgetFlags states );
+
+	Stats GetStats() const;
+};
+
+} // namespace directui
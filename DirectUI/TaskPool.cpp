@@ -0,0 +1,230 @@
+#include "TaskPool.h"
+
+#include <algorithm>
+
+namespace directui
+{
+
+namespace
+{
+
+thread_local const TaskPool* t_pool{ nullptr };
+thread_local size_t t_worker{ 0 };
+
+} // namespace
+
+void TaskPool::Ring::Grow()
+{
+	std::vector<Entry> entries( std::max<size_t>( 16, _entries.size() * 2 ) );
+	for ( size_t i = 0; i < _count; ++i )
+	{
+		entries[ i ] = std::move( _entries[ ( _head + i ) % _entries.size() ] );
+	}
+	_entries.swap( entries );
+	_head = 0;
+}
+
+void TaskPool::Ring::PushBack( Entry entry )
+{
+	if ( _count == _entries.size() )
+		Grow();
+	_entries[ ( _head + _count ) % _entries.size() ] = std::move( entry );
+	_count++;
+}
+
+TaskPool::Entry TaskPool::Ring::PopBack()
+{
+	_count--;
+	return std::move( _entries[ ( _head + _count ) % _entries.size() ] );
+}
+
+TaskPool::Entry TaskPool::Ring::PopFront()
+{
+	auto entry = std::move( _entries[ _head ] );
+	_head = ( _head + 1 ) % _entries.size();
+	_count--;
+	return entry;
+}
+
+TaskPool::TaskPool( unsigned threadCount )
+{
+	if ( threadCount == 0 )
+		threadCount = std::max( 1u, std::thread::hardware_concurrency() );
+
+	for ( unsigned i = 0; i < threadCount; ++i )
+	{
+		_queues.emplace_back( new Queue{} );
+	}
+
+	for ( unsigned i = 0; i < threadCount; ++i )
+	{
+		_threads.emplace_back( [this, i] { WorkerLoop( i ); } );
+	}
+}
+
+TaskPool::~TaskPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ _wakeMutex };
+		_stop = true;
+	}
+	_wake.notify_all();
+
+	for ( auto& thread : _threads )
+	{
+		thread.join();
+	}
+}
+
+size_t TaskPool::CurrentWorker() const
+{
+	if ( t_pool == this )
+		return t_worker;
+
+	// Other threads spread their jobs over all queues.
+	return _nextQueue.fetch_add( 1, std::memory_order_relaxed ) % _queues.size();
+}
+
+void TaskPool::Submit( Job job, TaskPriority priority, CancellationToken token )
+{
+	auto& queue = *_queues[ CurrentWorker() ];
+	{
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+		queue.entries[ static_cast< size_t >( priority ) ].PushBack( Entry{ std::move( job ), std::move( token ) } );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{ _wakeMutex };
+		_queued.fetch_add( 1, std::memory_order_relaxed );
+	}
+	_wake.notify_one();
+}
+
+bool TaskPool::Pop( size_t index, size_t priority, Entry& entry )
+{
+	auto& queue = *_queues[ index ];
+	std::lock_guard<std::mutex> lock{ queue.mutex };
+	auto& entries = queue.entries[ priority ];
+	if ( entries.IsEmpty() )
+		return false;
+
+	entry = entries.PopBack();
+	_queued.fetch_sub( 1, std::memory_order_relaxed );
+	return true;
+}
+
+bool TaskPool::Steal( size_t start, size_t priority, Entry& entry )
+{
+	for ( size_t i = 1; i <= _queues.size(); ++i )
+	{
+		auto& queue = *_queues[ ( start + i ) % _queues.size() ];
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+		auto& entries = queue.entries[ priority ];
+		if ( !entries.IsEmpty() )
+		{
+			entry = entries.PopFront();
+			_queued.fetch_sub( 1, std::memory_order_relaxed );
+			return true;
+		}
+	}
+	return false;
+}
+
+bool TaskPool::Take( size_t index, bool isWorker, Entry& entry )
+{
+	for ( size_t priority = 0; priority < k_PriorityCount; ++priority )
+	{
+		if ( ( isWorker && Pop( index, priority, entry ) ) || Steal( index, priority, entry ) )
+			return true;
+	}
+	return false;
+}
+
+bool TaskPool::RunOne()
+{
+	Entry entry;
+	bool isWorker = t_pool == this;
+	if ( !Take( isWorker ? t_worker : CurrentWorker(), isWorker, entry ) )
+		return false;
+
+	if ( !entry.token.IsCancelled() )
+		entry.job();
+	return true;
+}
+
+void TaskPool::WorkerLoop( size_t index )
+{
+	t_pool = this;
+	t_worker = index;
+
+	for ( ;; )
+	{
+		Entry entry;
+		if ( Take( index, true, entry ) )
+		{
+			if ( !entry.token.IsCancelled() )
+				entry.job();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock{ _wakeMutex };
+		_wake.wait( lock, [this] { return _stop || _queued.load( std::memory_order_relaxed ) > 0; } );
+		if ( _stop && _queued.load( std::memory_order_relaxed ) == 0 )
+			return;
+	}
+}
+
+void TaskPool::ParallelFor( size_t count, const std::function<void( size_t )>& body, TaskPriority priority )
+{
+	if ( count == 0 )
+		return;
+
+	// A few chunks per thread leave room for stealing when items differ in cost.
+	const size_t chunkCount = std::min( count, ( _threads.size() + 1 ) * 4 );
+	const size_t chunkSize = ( count + chunkCount - 1 ) / chunkCount;
+
+	// Tasks capture only the group and their first index, small enough to skip the heap in std::function.
+	// Chunks point at the group on this stack, so it waits for all of them even after a failure.
+	struct Group
+	{
+		const std::function<void( size_t )>& body;
+		size_t count;
+		size_t chunkSize;
+		std::atomic<size_t> remaining;
+		std::atomic<bool> failed{ false };
+		std::exception_ptr error;
+	};
+	Group group{ body, count, chunkSize, ( count + chunkSize - 1 ) / chunkSize, {}, {} };
+
+	for ( size_t begin = 0; begin < count; begin += chunkSize )
+	{
+		Submit( [pGroup = &group, begin] {
+			try
+			{
+				auto end = std::min( pGroup->count, begin + pGroup->chunkSize );
+				for ( size_t i = begin; i < end && !pGroup->failed.load( std::memory_order_relaxed ); ++i )
+				{
+					pGroup->body( i );
+				}
+			}
+			catch ( ... )
+			{
+				// The first failing chunk stores its exception, later ones are dropped.
+				if ( !pGroup->failed.exchange( true, std::memory_order_relaxed ) )
+					pGroup->error = std::current_exception();
+			}
+			pGroup->remaining.fetch_sub( 1, std::memory_order_acq_rel );
+		}, priority );
+	}
+
+	while ( group.remaining.load( std::memory_order_acquire ) > 0 )
+	{
+		if ( !RunOne() )
+			std::this_thread::yield();
+	}
+
+	if ( group.error )
+		std::rethrow_exception( group.error );
+}
+
+} // namespace directui
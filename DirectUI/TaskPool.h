@@ -0,0 +1,265 @@
+#pragma once
+
+#include <functional> // for std::function
+#include <memory> // for std::unique_ptr, std::shared_ptr
+#include <vector> // for std::vector
+#include <thread> // for std::thread
+#include <mutex> // for std::mutex
+#include <condition_variable> // for std::condition_variable
+#include <atomic> // for std::atomic
+#include <optional> // for std::optional
+#include <exception> // for std::exception_ptr
+#include <stdexcept> // for std::logic_error
+#include <type_traits> // for std::invoke_result_t
+
+namespace directui
+{
+
+enum class TaskPriority
+{
+	High,
+	Normal,
+	Low
+};
+
+class CancellationToken
+{
+private:
+	std::shared_ptr<const std::atomic<bool>> _cancelled;
+public:
+	CancellationToken() {}
+	explicit CancellationToken( std::shared_ptr<const std::atomic<bool>> cancelled ) : _cancelled{ std::move( cancelled ) } {}
+
+	bool CanBeCancelled() const { return _cancelled != nullptr; }
+	bool IsCancelled() const { return _cancelled && _cancelled->load( std::memory_order_acquire ); }
+};
+
+class CancellationSource
+{
+private:
+	std::shared_ptr<std::atomic<bool>> _cancelled;
+public:
+	CancellationSource() : _cancelled{ std::make_shared<std::atomic<bool>>( false ) } {}
+
+	void Cancel() { _cancelled->store( true, std::memory_order_release ); }
+	bool IsCancelled() const { return _cancelled->load( std::memory_order_acquire ); }
+	CancellationToken GetToken() const { return CancellationToken{ _cancelled }; }
+};
+
+// Runs callbacks on a specific thread, the application implements it for the message loop thread.
+class Dispatcher
+{
+public:
+	virtual ~Dispatcher() {}
+	virtual void Post( std::function<void()> callback ) = 0;
+};
+
+// Work-stealing thread pool. Every worker owns a queue per priority, pops its own newest
+// job and steals the oldest job of another worker when its queue runs empty. Higher
+// priorities are drained from all queues before lower ones are looked at.
+class TaskPool
+{
+public:
+	using Job = std::function<void()>;
+
+private:
+	static constexpr size_t k_PriorityCount = 3;
+
+	struct Entry
+	{
+		Job job;
+		CancellationToken token;
+	};
+
+	// Double-ended ring of entries. Capacity is kept when it drains, so a steady stream of jobs
+	// (ParallelFor chunks every frame) does not allocate.
+	class Ring
+	{
+	private:
+		std::vector<Entry> _entries;
+		size_t _head{ 0 };
+		size_t _count{ 0 };
+
+		void Grow();
+	public:
+		bool IsEmpty() const { return _count == 0; }
+		void PushBack( Entry entry );
+		Entry PopBack();
+		Entry PopFront();
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		Ring entries[ k_PriorityCount ];
+	};
+
+	std::vector<std::unique_ptr<Queue>> _queues;
+	std::vector<std::thread> _threads;
+
+	std::mutex _wakeMutex;
+	std::condition_variable _wake;
+	std::atomic<size_t> _queued{ 0 };
+	mutable std::atomic<size_t> _nextQueue{ 0 };
+	bool _stop{ false };
+
+	size_t CurrentWorker() const;
+	bool Pop( size_t index, size_t priority, Entry& entry );
+	bool Steal( size_t start, size_t priority, Entry& entry );
+	bool Take( size_t index, bool isWorker, Entry& entry );
+	void WorkerLoop( size_t index );
+
+public:
+	// Zero threads means one per hardware thread.
+	explicit TaskPool( unsigned threadCount = 0 );
+	~TaskPool();
+
+	TaskPool( const TaskPool& ) = delete;
+	TaskPool& operator=( const TaskPool& ) = delete;
+
+	size_t GetThreadCount() const { return _threads.size(); }
+
+	// Jobs whose token is cancelled before they start are dropped. Jobs must not throw, an
+	// exception escaping a job terminates the process like one escaping a thread.
+	void Submit( Job job, TaskPriority priority = TaskPriority::Normal, CancellationToken token = {} );
+
+	// Runs one queued job on the calling thread, returns false when all queues are empty.
+	bool RunOne();
+
+	// Calls body( i ) for every i in [0, count) and returns when all calls finished.
+	// The calling thread runs jobs while it waits, so nested calls from workers cannot deadlock.
+	// When body throws, the first exception is rethrown after all chunks finished.
+	void ParallelFor( size_t count, const std::function<void( size_t )>& body, TaskPriority priority = TaskPriority::High );
+};
+
+namespace detail
+{
+
+struct Unit {};
+
+template< typename T >
+struct TaskState
+{
+	using Value = std::conditional_t<std::is_void_v<T>, Unit, T>;
+
+	Dispatcher& dispatcher;
+	CancellationToken token;
+
+	std::mutex mutex;
+	bool done{ false };
+	std::optional<Value> value;
+	std::exception_ptr error;
+	std::function<void()> continuation;
+	bool hasContinuation{ false };
+
+	TaskState( Dispatcher& dispatcher, CancellationToken token ) : dispatcher{ dispatcher }, token{ std::move( token ) } {}
+
+	void Complete()
+	{
+		std::function<void()> pending;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			done = true;
+			pending = std::move( continuation );
+		}
+		if ( pending )
+			dispatcher.Post( std::move( pending ) );
+	}
+};
+
+} // namespace detail
+
+// Result of work running on a TaskPool.
+template< typename T >
+class Task
+{
+private:
+	std::shared_ptr<detail::TaskState<T>> _state;
+
+public:
+	Task() {}
+	explicit Task( std::shared_ptr<detail::TaskState<T>> state ) : _state{ std::move( state ) } {}
+
+	bool IsValid() const { return _state != nullptr; }
+
+	bool IsReady() const
+	{
+		std::lock_guard<std::mutex> lock{ _state->mutex };
+		return _state->done;
+	}
+
+	// Calls onValue with the result on the dispatcher thread, or onError when the work threw.
+	// Nothing is called once the token of the task is cancelled, which makes it safe to capture
+	// a window whose token was used. Without onError the exception is rethrown on the dispatcher thread.
+	// A task has a single continuation, calling ThenOnUi again throws std::logic_error.
+	template< typename TOnValue >
+	void ThenOnUi( TOnValue onValue, std::function<void( std::exception_ptr )> onError = nullptr )
+	{
+		auto state = _state;
+		std::function<void()> continuation = [state, onValue = std::move( onValue ), onError = std::move( onError )] () mutable {
+			if ( state->token.IsCancelled() )
+				return;
+
+			if ( state->error )
+			{
+				if ( onError )
+					onError( state->error );
+				else
+					std::rethrow_exception( state->error );
+			}
+			else if constexpr ( std::is_void_v<T> )
+			{
+				onValue();
+			}
+			else
+			{
+				onValue( std::move( *state->value ) );
+			}
+		};
+
+		{
+			std::lock_guard<std::mutex> lock{ state->mutex };
+			if ( state->hasContinuation )
+				throw std::logic_error( "Task already has a continuation" );
+			state->hasContinuation = true;
+			if ( !state->done )
+			{
+				state->continuation = std::move( continuation );
+				return;
+			}
+		}
+		state->dispatcher.Post( std::move( continuation ) );
+	}
+};
+
+template< typename TWork >
+auto RunAsync( TaskPool& pool, Dispatcher& dispatcher, TWork&& work,
+	TaskPriority priority = TaskPriority::Normal, CancellationToken token = {} ) -> Task<std::invoke_result_t<TWork>>
+{
+	using T = std::invoke_result_t<TWork>;
+	auto state = std::make_shared<detail::TaskState<T>>( dispatcher, token );
+
+	pool.Submit( [state, work = std::forward<TWork>( work )] () mutable {
+		try
+		{
+			if constexpr ( std::is_void_v<T> )
+			{
+				work();
+				state->value.emplace();
+			}
+			else
+			{
+				state->value.emplace( work() );
+			}
+		}
+		catch ( ... )
+		{
+			state->error = std::current_exception();
+		}
+		state->Complete();
+	}, priority, std::move( token ) );
+
+	return Task<T>{ state };
+}
+
+} // namespace directui
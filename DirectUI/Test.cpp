@@ -1,198 +1,326 @@
-#include "Window.h"
-#include "Application.h"
-#include "Graphics.h"
-#include "Dpi.h"
-
-using namespace directui;
-using namespace graphics;
-
-void DrawThinBorder( DeviceContext& dc )
-{
-	auto rect = dc.GetDrawRect();
-	auto strokeWidth = 0.5f;
-	rect.x += strokeWidth;
-	rect.y += strokeWidth;
-	rect.w -= strokeWidth * 2.0f;
-	rect.h -= strokeWidth * 2.0f;
-	dc.DrawSolidRect( ColorF{ 0x5D5D63, 1 }, rect, strokeWidth );
-}
-
-enum class MenuState
-{
-	Normal,
-	Active,
-	Pressed
-};
-
-class MenuItem
-{
-private:
-	String _text;
-	RectF _rect;
-	std::unique_ptr<TextLayout> _textLayout;
-	MenuState _state{ MenuState::Normal };
-	std::unique_ptr<Window> _popup;
-public:
-	MenuItem( const String& text ) : _text{ text }, _rect{ 0, 0, 60, 20 }
-	{
-		auto& device = Application::Instance()->GetDevice();
-		auto textFormat = device.CreateTextFormat( L"Segoe UI", 12 );
-		_textLayout = device.CreateTextLayout( text, *textFormat, SizeF{ _rect.w, _rect.h } );
-		_textLayout->SetTextAlignment( TextAlignment::Center );
-		_textLayout->SetParagraphAlignment( ParagraphAlignment::Center );
-	}
-
-	RectF GetRect() const { return _rect; }
-	void SetRect( const RectF& rect ) { _rect = rect; }
-
-	MenuState GetState() const { return _state; }
-	void SetState( MenuState state ) { _state = state; }
-
-	/*void HandleMouse( const MouseMessage& mm, float dpi )
-	{
-		if ( mm.GetState() == MouseState::Down )
-		{
-			auto windowRect = mm.GetWindow().GetRect();
-			auto popupRect = ConvertRect( RectF{ _rect.x, _rect.y + _rect.h, 200, 200 }, dpi );
-			popupRect.x += windowRect.x;
-			popupRect.y += windowRect.y;
-			_popup.reset( new Window( WindowType::Popup, L"Popup", popupRect, nullptr, 
-				[] ( const Message& message ) {
-					if ( auto dm = message.As<DrawMessage>() )
-					{
-						auto& dc = dm->GetDeviceContext();
-						dc.Clear( ColorF{ 0x1B1B1C, 1 } );
-						DrawThinBorder( dc );
-					}
-				} ) );
-			_popup->Show();
-		}
-	}*/
-
-	void Draw( DeviceContext& dc )
-	{
-		auto brush = dc.CreateSolidBrush( ColorF{ 0x22'55'ff, 1 } );
-		switch ( _state )
-		{
-			case MenuState::Active:		dc.FillSolidRect( ColorF{ 0x3E3E40, 1 }, _rect );	break;
-			case MenuState::Pressed:	dc.FillSolidRect( ColorF{ 0x1B1B1C, 1 }, _rect );	break;
-			default:					dc.DrawSolidRect( ColorF{ 0x3E3E40, 1 }, _rect );	break;
-		}
-		dc.DrawTextLayout( *_textLayout, *brush, PointF{ _rect.x, _rect.y } );
-	}
-};
-
-class MenuBar
-{
-private:
-	std::vector<MenuItem> _items;
-public:
-	void Append( MenuItem&& item )
-	{
-		_items.push_back( std::move( item ) );
-	}
-
-	void Layout()
-	{
-		PointF pos{ 0, 0 };
-		for ( auto& item : _items )
-		{
-			auto rect = item.GetRect();
-			rect.x = pos.x;
-			rect.y = pos.y;
-			item.SetRect( rect );
-			pos.x += rect.w;
-		}
-	}
-
-	/*void HandleMouse( const MouseMessage& mm, float dpi )
-	{
-		auto mousePos = ConvertPoint( mm.GetPosition(), dpi );
-		MenuItem* activeItem = nullptr;
-		for ( auto& item : _items )
-		{
-			item.SetState( MenuState::Normal );
-			if ( activeItem == nullptr && item.GetRect().HasPoint( mousePos ) )
-			{
-				activeItem = &item;
-			}
-		}
-
-		if ( activeItem )
-		{
-			activeItem->SetState( MenuState::Active );
-			activeItem->HandleMouse( mm, dpi );
-		}
-	}*/
-
-	void Draw( DeviceContext& dc )
-	{
-		for ( auto& item : _items )
-		{
-			item.Draw( dc );
-		}
-	}
-};
-
-int main()
-{
-	Application app;
-
-	MenuBar menuBar;
-	menuBar.Append( MenuItem{ L"File" } );
-	menuBar.Append( MenuItem{ L"Edit" } );
-	menuBar.Append( MenuItem{ L"View" } );
-	menuBar.Append( MenuItem{ L"Project" } );
-	menuBar.Layout();
-
-	PointPx dragStartPosPx;
-	bool isDragging{ false };
-
-	Window mainWindow{ WindowType::Main, ConvertRect( RectF{ 200, 200, 640, 480 }, GetSystemDpi() ), nullptr };
-
-	mainWindow.OnDraw = [&menuBar] ( Window& w, DeviceContext& dc ) {
-		dc.Clear( ColorF{ 0x2D2D30, 0.1f } );
-		menuBar.Draw( dc );
-		DrawThinBorder( dc );
-	};
-
-	mainWindow.OnMouse = [&menuBar] ( Window& w, MouseState state, MouseButton button, PointPx position ) {
-
-	};
-
-		//[&] ( const Message& message ) {
-		//	if ( auto dm = message.As<DrawMessage>() )
-		//	{
-		//		auto& dc = dm->GetDeviceContext();
-		//		dc.Clear( ColorF{ 0x2D2D30, 1 } );
-		//		menuBar.Draw( dc );
-		//		DrawThinBorder( dc );
-		//	}
-		//	else if ( auto mm = message.As<MouseMessage>() )
-		//	{
-		//		auto mousePosPx = mm->GetPosition();
-		//		menuBar.HandleMouse( *mm, mainWindow.GetDpi() );
-		//		mainWindow.Redraw();
-
-		//		/*if ( mm->GetState() == MouseState::Down )
-		//		{
-		//			dragStartPosPx = mousePosPx;
-		//			isDragging = true;
-		//		}
-		//		else if ( mm->GetState() == MouseState::Move && isDragging )
-		//		{
-		//			auto rc = mainWindow.GetRect();
-		//			rc.x += mousePosPx.x - dragStartPosPx.x;
-		//			rc.y += mousePosPx.y - dragStartPosPx.y;
-		//			mainWindow.Move( rc );
-		//		}
-		//		else if ( mm->GetState() == MouseState::Up )
-		//		{
-		//			isDragging = false;
-		//		}*/
-		//	}
-		//}
-	mainWindow.Show();
-	
-	return app.Run( mainWindow );
-}
+#include "Window.h"
+#include "Application.h"
+#include "Graphics.h"
+#include "StaticDeviceContext.h"
+#include "DxGraphics.h"
+#include "Dpi.h"
+#include "WidgetStore.h"
+#include "InternedString.h"
+#include "HitTestMap.h"
+#include "ImmediateUi.h"
+#include "LatencyTracker.h"
+#include "StyleSheet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cwchar>
+#include <cstring>
+#include <chrono>
+
+using namespace directui;
+using namespace graphics;
+
+const InternedString k_WindowStyle{ L"Window" };
+const InternedString k_MenuItemStyle{ L"MenuItem" };
+
+void AddTheme( StyleSheet& styles )
+{
+	styles.SetVariable( L"accent", ColorF{ 0x2255FF, 1 } );
+
+	StyleDeclaration window;
+	window.background = ColorF{ 0x2D2D30, 0.1f };
+	window.border = ColorF{ 0x5D5D63, 1 };
+	window.borderWidth = 0.5f;
+	styles.AddRule( StyleSelector{ k_WindowStyle }, window );
+
+	StyleDeclaration item;
+	item.foreground = InternedString{ L"accent" };
+	item.border = ColorF{ 0x3E3E40, 1 };
+	item.borderWidth = 1.0f;
+	styles.AddRule( StyleSelector{ k_MenuItemStyle }, item );
+
+	StyleDeclaration hovered;
+	hovered.background = ColorF{ 0x3E3E40, 1 };
+	styles.AddRule( StyleSelector{ k_MenuItemStyle, 0, k_WidgetHovered }, hovered );
+
+	StyleDeclaration pressed;
+	pressed.background = ColorF{ 0x1B1B1C, 1 };
+	styles.AddRule( StyleSelector{ k_MenuItemStyle, 0, k_WidgetPressed }, pressed );
+}
+
+void DrawThinBorder( DeviceContext& dc, const ComputedStyle& style )
+{
+	if ( style.borderBrush == nullptr )
+		return;
+
+	auto rect = dc.GetDrawRect();
+	auto strokeWidth = style.borderWidth;
+	rect.x += strokeWidth;
+	rect.y += strokeWidth;
+	rect.w -= strokeWidth * 2.0f;
+	rect.h -= strokeWidth * 2.0f;
+	dc.DrawRect( *style.borderBrush, rect, strokeWidth );
+}
+
+// Hot data of menu items (rect, hover and press state) lives in the widget store,
+// the text layout and popup window stay in a side table.
+class MenuItem
+{
+private:
+	InternedString _text;
+	std::unique_ptr<TextLayout> _textLayout;
+	std::unique_ptr<Window> _popup;
+
+	static constexpr float k_Padding = 10;
+public:
+	MenuItem() {}
+
+	static WidgetHandle Create( WidgetStore& widgets, WidgetTable<MenuItem>& items, StyleSheet& styles, const InternedString& text )
+	{
+		auto& device = Application::Instance()->GetDevice();
+		auto style = styles.Resolve( k_MenuItemStyle, 0, 0 );
+		const auto& textFormat = style->textFormat;
+		RectF rect{ 0, 0, 60, 20 };
+		rect.w = std::ceil( device.MeasureText( text, *textFormat ).width ) + k_Padding * 2;
+
+		auto handle = widgets.Create( rect );
+		auto& item = items[ handle ];
+		item._text = text;
+		item._textLayout = device.CreateTextLayout( text, *textFormat, SizeF{ rect.w, rect.h } );
+		item._textLayout->SetTextAlignment( TextAlignment::Center );
+		item._textLayout->SetParagraphAlignment( ParagraphAlignment::Center );
+		return handle;
+	}
+
+	/*void HandleMouse( const MouseMessage& mm, float dpi )
+	{
+		if ( mm.GetState() == MouseState::Down )
+		{
+			auto windowRect = mm.GetWindow().GetRect();
+			auto popupRect = ConvertRect( RectF{ _rect.x, _rect.y + _rect.h, 200, 200 }, dpi );
+			popupRect.x += windowRect.x;
+			popupRect.y += windowRect.y;
+			_popup.reset( new Window( WindowType::Popup, L"Popup", popupRect, nullptr, 
+				[] ( const Message& message ) {
+					if ( auto dm = message.As<DrawMessage>() )
+					{
+						auto& dc = dm->GetDeviceContext();
+						dc.Clear( ColorF{ 0x1B1B1C, 1 } );
+						DrawThinBorder( dc );
+					}
+				} ) );
+			_popup->Show();
+		}
+	}*/
+
+	// Switching between states drawn before resolves to the cached style and its brushes.
+	template< typename TContext >
+	void Draw( TContext& dc, StyleSheet& styles, const RectF& rect, WidgetFlags flags ) const
+	{
+		auto style = styles.Resolve( k_MenuItemStyle, 0, flags );
+		if ( style->backgroundBrush )
+			dc.FillRect( *style->backgroundBrush, rect );
+		else if ( style->borderBrush )
+			dc.DrawRect( *style->borderBrush, rect, style->borderWidth );
+		if ( style->foregroundBrush )
+			dc.DrawTextLayout( *_textLayout, *style->foregroundBrush, PointF{ rect.x, rect.y } );
+	}
+};
+
+class MenuBar
+{
+private:
+	StyleSheet& _styles;
+	WidgetStore _widgets;
+	WidgetTable<MenuItem> _items;
+public:
+	explicit MenuBar( StyleSheet& styles ) : _styles{ styles } {}
+
+	void Append( const InternedString& text )
+	{
+		MenuItem::Create( _widgets, _items, _styles, text );
+	}
+
+	void Layout()
+	{
+		PointF pos{ 0, 0 };
+		for ( size_t i = 0; i < _widgets.GetCount(); ++i )
+		{
+			auto handle = _widgets.HandleAt( i );
+			auto rect = _widgets.GetRect( handle );
+			rect.x = pos.x;
+			rect.y = pos.y;
+			_widgets.SetRect( handle, rect );
+			pos.x += rect.w;
+		}
+	}
+
+	// Updates hover and press states, returns true when an item has to be repainted.
+	bool HandleMouse( MouseState state, const PointF& position )
+	{
+		auto hit = _widgets.HitTest( position );
+		for ( size_t i = 0; i < _widgets.GetCount(); ++i )
+		{
+			auto handle = _widgets.HandleAt( i );
+			WidgetFlags set = 0;
+			if ( handle == hit )
+			{
+				set = k_WidgetHovered;
+				if ( state == MouseState::Down || ( state == MouseState::Move && _widgets.HasFlags( handle, k_WidgetPressed ) ) )
+					set |= k_WidgetPressed;
+			}
+			_widgets.SetFlags( handle, set, k_WidgetHovered | k_WidgetPressed );
+		}
+
+		bool dirty = false;
+		_widgets.ForEach( k_WidgetDirtyPaint, [&dirty] ( size_t ) { dirty = true; } );
+		_widgets.ClearFlags( k_WidgetDirtyPaint );
+		return dirty;
+	}
+
+	RectF GetBounds() const
+	{
+		RectF bounds;
+		for ( const auto& rect : _widgets.GetRects() )
+		{
+			bounds.w = std::max( bounds.w, rect.x + rect.w );
+			bounds.h = std::max( bounds.h, rect.y + rect.h );
+		}
+		return bounds;
+	}
+
+	void Draw( DeviceContext& dc )
+	{
+		const auto& rects = _widgets.GetRects();
+		const auto& flags = _widgets.GetFlags();
+		// Application windows draw with the Direct2D backend, item primitives are bound to it statically.
+		DrawStatic<dx::Backend>( dc, [&] ( auto& dc ) {
+			for ( size_t i = 0; i < rects.size(); ++i )
+			{
+				if ( flags[ i ] & k_WidgetVisible )
+					_items.Find( _widgets.HandleAt( i ) )->Draw( dc, _styles, rects[ i ], flags[ i ] );
+			}
+		} );
+	}
+};
+
+constexpr LayerId k_MenuBarLayer = 1;
+constexpr LayerId k_ToolsLayer = 2;
+
+int main()
+{
+	Application app;
+
+	StyleSheet styles{ app.GetDevice() };
+	AddTheme( styles );
+
+	MenuBar menuBar{ styles };
+	menuBar.Append( L"File" );
+	menuBar.Append( L"Edit" );
+	menuBar.Append( L"View" );
+	menuBar.Append( L"Project" );
+	menuBar.Layout();
+
+	PointPx dragStartPosPx;
+	bool isDragging{ false };
+
+	Window mainWindow{ WindowType::Main, ConvertRect( RectF{ 200, 200, 640, 480 }, GetSystemDpi() ), nullptr };
+
+	// The menu bar sits in the caption, resize borders stay on top of it.
+	HitTestMap hitTestMap;
+	hitTestMap.AddCaption( 40 );
+	hitTestMap.AddClientHole( menuBar.GetBounds() );
+	hitTestMap.AddResizeBorders( 4 );
+	mainWindow.SetHitTestMap( hitTestMap );
+
+	bool menuBarDirty{ false };
+
+	ImmediateUi tools{ app.GetDevice(), k_ToolsLayer };
+	bool showBorder{ true };
+
+	mainWindow.OnDraw = [&app, &styles, &menuBar, &menuBarDirty, &tools, &showBorder] ( Window& w, DeviceContext& dc ) {
+		auto windowStyle = styles.Resolve( k_WindowStyle, 0, 0 );
+		dc.Clear( windowStyle->background );
+		if ( menuBarDirty )
+		{
+			dc.InvalidateLayer( k_MenuBarLayer );
+			menuBarDirty = false;
+		}
+		if ( dc.BeginLayer( k_MenuBarLayer, menuBar.GetBounds() ) )
+		{
+			menuBar.Draw( dc );
+		}
+		dc.EndLayer();
+
+		auto latency = w.GetLatencyStats().inputToPresent;
+		wchar_t latencyText[ 64 ];
+		std::swprintf( latencyText, 64, L"Input latency p95 %.1f ms", latency.p95 );
+
+		// Reported once the first frame was presented, so from the second frame on.
+		wchar_t startupText[ 64 ] = L"First frame";
+		for ( const auto& phase : app.GetStartupPhases() )
+		{
+			if ( std::strcmp( phase.name, "First frame" ) == 0 )
+				std::swprintf( startupText, 64, L"First frame %.1f ms", std::chrono::duration<double, std::milli>( phase.duration ).count() );
+		}
+
+		tools.Begin( dc, RectF{ 0, 40, 240, 120 } );
+		if ( tools.Button( L"Reset latency" ) )
+			w.ResetLatencyStats();
+		tools.Checkbox( L"Thin border", showBorder );
+		tools.Label( latencyText );
+		tools.Label( startupText );
+		tools.End();
+
+		if ( showBorder )
+			DrawThinBorder( dc, *windowStyle );
+	};
+
+	mainWindow.OnMouse = [&menuBar, &menuBarDirty, &tools] ( Window& w, MouseState state, MouseButton button, PointPx position ) {
+		auto positionF = ConvertPoint( position, w.GetDpi() );
+		bool redraw = tools.OnMouse( state, button, positionF );
+		if ( menuBar.HandleMouse( state, positionF ) )
+		{
+			menuBarDirty = true;
+			redraw = true;
+		}
+		if ( redraw )
+			w.Redraw();
+	};
+
+		//[&] ( const Message& message ) {
+		//	if ( auto dm = message.As<DrawMessage>() )
+		//	{
+		//		auto& dc = dm->GetDeviceContext();
+		//		dc.Clear( ColorF{ 0x2D2D30, 1 } );
+		//		menuBar.Draw( dc );
+		//		DrawThinBorder( dc );
+		//	}
+		//	else if ( auto mm = message.As<MouseMessage>() )
+		//	{
+		//		auto mousePosPx = mm->GetPosition();
+		//		menuBar.HandleMouse( *mm, mainWindow.GetDpi() );
+		//		mainWindow.Redraw();
+
+		//		/*if ( mm->GetState() == MouseState::Down )
+		//		{
+		//			dragStartPosPx = mousePosPx;
+		//			isDragging = true;
+		//		}
+		//		else if ( mm->GetState() == MouseState::Move && isDragging )
+		//		{
+		//			auto rc = mainWindow.GetRect();
+		//			rc.x += mousePosPx.x - dragStartPosPx.x;
+		//			rc.y += mousePosPx.y - dragStartPosPx.y;
+		//			mainWindow.Move( rc );
+		//		}
+		//		else if ( mm->GetState() == MouseState::Up )
+		//		{
+		//			isDragging = false;
+		//		}*/
+		//	}
+		//}
+	mainWindow.Show();
+	
+	return app.Run();
+}
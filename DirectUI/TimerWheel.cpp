@@ -0,0 +1,276 @@
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+namespace directui
+{
+
+TimerWheel::TimerWheel( Clock::duration resolution, Clock::duration coalescing )
+	: _epoch{ Clock::now() }
+	, _resolution{ std::max( resolution, Clock::duration{ 1 } ) }
+	, _coalescingTicks{ static_cast< uint64_t >( std::max<Clock::rep>( 1, coalescing.count() / _resolution.count() ) ) }
+{
+	_nodes.resize( k_ListCount );
+	for ( uint32_t i = 0; i < k_ListCount; ++i )
+	{
+		_nodes[ i ].prev = i;
+		_nodes[ i ].next = i;
+	}
+}
+
+uint64_t TimerWheel::ToTicksCeil( Clock::time_point time ) const
+{
+	auto elapsed = ( time - _epoch ).count();
+	if ( elapsed <= 0 )
+		return 0;
+	return static_cast< uint64_t >( ( elapsed + _resolution.count() - 1 ) / _resolution.count() );
+}
+
+uint64_t TimerWheel::ToTicksFloor( Clock::time_point time ) const
+{
+	auto elapsed = ( time - _epoch ).count();
+	if ( elapsed <= 0 )
+		return 0;
+	return static_cast< uint64_t >( elapsed / _resolution.count() );
+}
+
+void TimerWheel::Link( uint32_t list, uint32_t node )
+{
+	auto tail = _nodes[ list ].prev;
+	_nodes[ node ].prev = tail;
+	_nodes[ node ].next = list;
+	_nodes[ tail ].next = node;
+	_nodes[ list ].prev = node;
+
+	if ( list < k_OverflowList )
+		_occupied[ list / k_Slots ][ ( list % k_Slots ) / 64 ] |= uint64_t{ 1 } << ( list % 64 );
+}
+
+void TimerWheel::Unlink( uint32_t node )
+{
+	auto prev = _nodes[ node ].prev;
+	auto next = _nodes[ node ].next;
+	_nodes[ prev ].next = next;
+	_nodes[ next ].prev = prev;
+	_nodes[ node ].prev = node;
+	_nodes[ node ].next = node;
+
+	// Only a sentinel links to itself, the list it heads is empty now.
+	if ( prev == next && prev < k_OverflowList )
+		_occupied[ prev / k_Slots ][ ( prev % k_Slots ) / 64 ] &= ~( uint64_t{ 1 } << ( prev % 64 ) );
+}
+
+// Timers go to the lowest level whose slot range still contains both the expiry and the
+// current tick, so every occupied slot of a level lies ahead of the current tick.
+void TimerWheel::Place( uint32_t node )
+{
+	auto expiry = _nodes[ node ].expiry;
+	auto difference = expiry ^ _current;
+
+	uint32_t level = 0;
+	while ( level < k_Levels && ( difference >> ( k_SlotBits * ( level + 1 ) ) ) != 0 )
+	{
+		level++;
+	}
+
+	if ( level == k_Levels )
+	{
+		Link( k_OverflowList, node );
+		return;
+	}
+
+	auto slot = static_cast< uint32_t >( ( expiry >> ( k_SlotBits * level ) ) & k_SlotMask );
+	Link( level * k_Slots + slot, node );
+}
+
+uint32_t TimerWheel::NextOccupied( uint32_t level, uint32_t from ) const
+{
+	for ( uint32_t word = from / 64; word < k_Slots / 64; ++word )
+	{
+		auto bits = _occupied[ level ][ word ];
+		if ( word == from / 64 )
+			bits &= ~uint64_t{ 0 } << ( from % 64 );
+
+		for ( uint32_t bit = 0; bits != 0; ++bit, bits >>= 1 )
+		{
+			if ( bits & 1 )
+				return word * 64 + bit;
+		}
+	}
+	return k_Slots;
+}
+
+TimerId TimerWheel::Start( Clock::duration delay, Callback callback, Clock::duration period )
+{
+	uint32_t index;
+	if ( !_freeNodes.empty() )
+	{
+		index = _freeNodes.back();
+		_freeNodes.pop_back();
+	}
+	else
+	{
+		index = static_cast< uint32_t >( _nodes.size() );
+		_nodes.emplace_back();
+	}
+
+	auto& node = _nodes[ index ];
+	node.prev = index;
+	node.next = index;
+	node.generation++;
+	node.active = true;
+	node.expiry = std::max( ToTicksCeil( Clock::now() + delay ), _current + 1 );
+	node.period = period > Clock::duration::zero() ? std::max<uint64_t>( 1, ToTicksCeil( _epoch + period ) ) : 0;
+	node.callback = std::move( callback );
+	Place( index );
+	_count++;
+
+	return ( static_cast< TimerId >( node.generation ) << 32 ) | index;
+}
+
+bool TimerWheel::Cancel( TimerId id )
+{
+	auto index = static_cast< uint32_t >( id & 0xFFFFFFFF );
+	auto generation = static_cast< uint32_t >( id >> 32 );
+	if ( index < k_ListCount || index >= _nodes.size() )
+		return false;
+
+	auto& node = _nodes[ index ];
+	if ( !node.active || node.generation != generation )
+		return false;
+
+	Unlink( index );
+	node.active = false;
+	node.callback = nullptr;
+	_freeNodes.push_back( index );
+	_count--;
+	return true;
+}
+
+void TimerWheel::Cascade()
+{
+	// Levels whose lower indices all wrapped are moved down, highest first so timers
+	// landing in a lower slot that is cascaded in the same step are moved again.
+	uint32_t top = 1;
+	while ( top < k_Levels && ( ( _current >> ( k_SlotBits * top ) ) & k_SlotMask ) == 0 )
+	{
+		top++;
+	}
+
+	// Detached through the firing list first, overflow timers still too far out return to the same list.
+	auto recascade = [this] ( uint32_t list ) {
+		while ( !IsEmpty( list ) )
+		{
+			auto node = _nodes[ list ].next;
+			Unlink( node );
+			Link( k_FiringList, node );
+		}
+		while ( !IsEmpty( k_FiringList ) )
+		{
+			auto node = _nodes[ k_FiringList ].next;
+			Unlink( node );
+			Place( node );
+		}
+	};
+
+	if ( top == k_Levels )
+		recascade( k_OverflowList );
+
+	for ( uint32_t level = std::min( top, k_Levels - 1 ); level >= 1; --level )
+	{
+		auto slot = static_cast< uint32_t >( ( _current >> ( k_SlotBits * level ) ) & k_SlotMask );
+		recascade( level * k_Slots + slot );
+	}
+}
+
+void TimerWheel::Fire()
+{
+	auto list = static_cast< uint32_t >( _current & k_SlotMask );
+	if ( IsEmpty( list ) )
+		return;
+
+	// Moved to a separate list so callbacks can cancel timers due in the same tick.
+	while ( !IsEmpty( list ) )
+	{
+		auto node = _nodes[ list ].next;
+		Unlink( node );
+		Link( k_FiringList, node );
+	}
+
+	while ( !IsEmpty( k_FiringList ) )
+	{
+		auto index = _nodes[ k_FiringList ].next;
+		Unlink( index );
+
+		// Callbacks can start timers and reallocate the nodes, no references are kept.
+		auto generation = _nodes[ index ].generation;
+		auto periodic = _nodes[ index ].period != 0;
+		auto callback = std::move( _nodes[ index ].callback );
+		if ( !periodic )
+		{
+			_nodes[ index ].active = false;
+			_freeNodes.push_back( index );
+			_count--;
+		}
+
+		callback();
+
+		auto& node = _nodes[ index ];
+		if ( periodic && node.active && node.generation == generation )
+		{
+			node.callback = std::move( callback );
+			node.expiry = _current + node.period;
+			Place( index );
+		}
+	}
+}
+
+// Start of the first occupied slot at the lowest occupied level. Everything before it is
+// empty, so the current tick can jump there without visiting the slots in between.
+uint64_t TimerWheel::NextTick() const
+{
+	for ( uint32_t level = 0; level < k_Levels; ++level )
+	{
+		auto index = static_cast< uint32_t >( ( _current >> ( k_SlotBits * level ) ) & k_SlotMask );
+		auto slot = index + 1 < k_Slots ? NextOccupied( level, index + 1 ) : k_Slots;
+		if ( slot < k_Slots )
+		{
+			auto rotationStart = ( _current >> ( k_SlotBits * ( level + 1 ) ) ) << ( k_SlotBits * ( level + 1 ) );
+			return rotationStart + ( static_cast< uint64_t >( slot ) << ( k_SlotBits * level ) );
+		}
+	}
+
+	// The overflow list cascades when the top level wraps.
+	return ( ( _current >> ( k_SlotBits * k_Levels ) ) + 1 ) << ( k_SlotBits * k_Levels );
+}
+
+void TimerWheel::Advance( Clock::time_point now )
+{
+	auto target = ToTicksFloor( now );
+	while ( _current < target )
+	{
+		auto tick = _count != 0 ? NextTick() : target + 1;
+		if ( tick > target )
+		{
+			_current = target;
+			break;
+		}
+
+		_current = tick;
+		if ( ( _current & k_SlotMask ) == 0 )
+			Cascade();
+		Fire();
+	}
+}
+
+std::optional<TimerWheel::Clock::time_point> TimerWheel::GetNextDue() const
+{
+	if ( _count == 0 )
+		return std::nullopt;
+
+	auto tick = NextTick();
+	tick = ( tick + _coalescingTicks - 1 ) / _coalescingTicks * _coalescingTicks;
+	return _epoch + _resolution * tick;
+}
+
+} // namespace directui
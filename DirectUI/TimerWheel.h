@@ -0,0 +1,89 @@
+#pragma once
+
+#include <functional> // for std::function
+#include <vector> // for std::vector
+#include <chrono> // for std::chrono::steady_clock
+#include <optional> // for std::optional
+#include <cstdint> // for uint64_t
+
+namespace directui
+{
+
+using TimerId = uint64_t;
+
+// Hashed hierarchical timer wheel. Four levels of 256 slots cover 2^32 ticks, longer timers
+// wait in an overflow list. Start and Cancel are O(1), Advance jumps straight to the next
+// occupied slot, whichever level it is on.
+//
+// Timers never fire early. With a coalescing interval the reported next due time is rounded
+// up to that interval, so timers due within the same interval fire in a single Advance.
+class TimerWheel
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using Callback = std::function<void()>;
+
+private:
+	static constexpr uint32_t k_Levels = 4;
+	static constexpr uint32_t k_SlotBits = 8;
+	static constexpr uint32_t k_Slots = 1u << k_SlotBits;
+	static constexpr uint32_t k_SlotMask = k_Slots - 1;
+	static constexpr uint32_t k_OverflowList = k_Levels * k_Slots;
+	static constexpr uint32_t k_FiringList = k_OverflowList + 1;
+	static constexpr uint32_t k_ListCount = k_FiringList + 1;
+
+	// Nodes [0, k_ListCount) are list sentinels, timers follow. Lists are circular.
+	struct Node
+	{
+		uint32_t prev;
+		uint32_t next;
+		uint32_t generation{ 0 };
+		bool active{ false };
+		uint64_t expiry{ 0 };
+		uint64_t period{ 0 };
+		Callback callback;
+	};
+
+	std::vector<Node> _nodes;
+	std::vector<uint32_t> _freeNodes;
+	uint64_t _occupied[ k_Levels ][ k_Slots / 64 ]{};
+
+	Clock::time_point _epoch;
+	Clock::duration _resolution;
+	uint64_t _coalescingTicks;
+	uint64_t _current{ 0 }; // every timer up to this tick has fired
+	size_t _count{ 0 };
+
+	uint64_t ToTicksCeil( Clock::time_point time ) const;
+	uint64_t ToTicksFloor( Clock::time_point time ) const;
+
+	bool IsEmpty( uint32_t list ) const { return _nodes[ list ].next == list; }
+	void Link( uint32_t list, uint32_t node );
+	void Unlink( uint32_t node );
+	void Place( uint32_t node );
+	void Cascade();
+	void Fire();
+	uint32_t NextOccupied( uint32_t level, uint32_t from ) const;
+	uint64_t NextTick() const;
+
+public:
+	explicit TimerWheel( Clock::duration resolution = std::chrono::milliseconds( 1 ), Clock::duration coalescing = Clock::duration::zero() );
+
+	TimerWheel( const TimerWheel& ) = delete;
+	TimerWheel& operator=( const TimerWheel& ) = delete;
+
+	// A non-zero period restarts the timer after every expiry until it is cancelled.
+	TimerId Start( Clock::duration delay, Callback callback, Clock::duration period = Clock::duration::zero() );
+	// Returns false when the timer already fired or was cancelled.
+	bool Cancel( TimerId id );
+
+	// Fires every timer due at the given time, callbacks can start and cancel timers.
+	void Advance( Clock::time_point now );
+
+	// Time at which Advance has work to do, a cascade or an expiry, nothing when there are no timers.
+	std::optional<Clock::time_point> GetNextDue() const;
+
+	size_t GetCount() const { return _count; }
+};
+
+} // namespace directui
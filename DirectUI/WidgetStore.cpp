@@ -0,0 +1,244 @@
+#include "WidgetStore.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace directui
+{
+
+WidgetHandle WidgetStore::Create( const graphics::RectF& rect, WidgetHandle parent, int32_t zOrder, WidgetFlags flags )
+{
+	uint32_t slot;
+	if ( !_freeSlots.empty() )
+	{
+		slot = _freeSlots.back();
+		_freeSlots.pop_back();
+	}
+	else
+	{
+		slot = static_cast< uint32_t >( _slots.size() );
+		_slots.push_back( Slot{ 0, 0 } );
+		_childCounts.push_back( 0 );
+	}
+
+	auto parentSlot = IsAlive( parent ) ? parent.slot : WidgetHandle::k_InvalidSlot;
+	if ( parentSlot != WidgetHandle::k_InvalidSlot )
+		_childCounts[ parentSlot ]++;
+
+	_slots[ slot ].dense = static_cast< uint32_t >( _rects.size() );
+	_rects.push_back( rect );
+	_flags.push_back( flags );
+	_zOrders.push_back( zOrder );
+	_parents.push_back( parentSlot );
+	_denseToSlot.push_back( slot );
+	_sequences.push_back( _nextSequence++ );
+
+	// Appending keeps the order unless the new widget sorts below the last one.
+	if ( _zOrders.size() > 1 && zOrder < _zOrders[ _zOrders.size() - 2 ] )
+		_orderDirty = true;
+
+	return WidgetHandle{ slot, _slots[ slot ].generation };
+}
+
+void WidgetStore::RemoveDense( uint32_t dense )
+{
+	auto slot = _denseToSlot[ dense ];
+	auto parentSlot = _parents[ dense ];
+	if ( parentSlot != WidgetHandle::k_InvalidSlot )
+		_childCounts[ parentSlot ]--;
+
+	auto last = static_cast< uint32_t >( _rects.size() - 1 );
+	if ( dense != last )
+	{
+		_rects[ dense ] = _rects[ last ];
+		_flags[ dense ] = _flags[ last ];
+		_zOrders[ dense ] = _zOrders[ last ];
+		_parents[ dense ] = _parents[ last ];
+		_denseToSlot[ dense ] = _denseToSlot[ last ];
+		_sequences[ dense ] = _sequences[ last ];
+		_slots[ _denseToSlot[ dense ] ].dense = dense;
+		_orderDirty = true;
+	}
+
+	_rects.pop_back();
+	_flags.pop_back();
+	_zOrders.pop_back();
+	_parents.pop_back();
+	_denseToSlot.pop_back();
+	_sequences.pop_back();
+
+	_slots[ slot ].generation++;
+	_freeSlots.push_back( slot );
+}
+
+void WidgetStore::Destroy( WidgetHandle handle )
+{
+	if ( !IsAlive( handle ) )
+		return;
+
+	if ( _childCounts[ handle.slot ] == 0 )
+	{
+		RemoveDense( _slots[ handle.slot ].dense );
+		return;
+	}
+
+	// Descendants are found by marking children of marked slots until nothing changes,
+	// one pass per tree level.
+	std::vector<bool> marked( _slots.size(), false );
+	marked[ handle.slot ] = true;
+	for ( bool changed = true; changed; )
+	{
+		changed = false;
+		for ( size_t i = 0; i < _parents.size(); ++i )
+		{
+			auto parentSlot = _parents[ i ];
+			if ( parentSlot != WidgetHandle::k_InvalidSlot && marked[ parentSlot ] && !marked[ _denseToSlot[ i ] ] )
+			{
+				marked[ _denseToSlot[ i ] ] = true;
+				changed = true;
+			}
+		}
+	}
+
+	for ( auto i = static_cast< uint32_t >( _rects.size() ); i-- > 0; )
+	{
+		if ( marked[ _denseToSlot[ i ] ] )
+			RemoveDense( i );
+	}
+}
+
+void WidgetStore::Clear()
+{
+	for ( auto slot : _denseToSlot )
+	{
+		_slots[ slot ].generation++;
+		_childCounts[ slot ] = 0;
+		_freeSlots.push_back( slot );
+	}
+
+	_rects.clear();
+	_flags.clear();
+	_zOrders.clear();
+	_parents.clear();
+	_denseToSlot.clear();
+	_sequences.clear();
+	_orderDirty = false;
+}
+
+bool WidgetStore::IsAlive( WidgetHandle handle ) const
+{
+	return handle.slot < _slots.size() && _slots[ handle.slot ].generation == handle.generation &&
+		_slots[ handle.slot ].dense < _denseToSlot.size() && _denseToSlot[ _slots[ handle.slot ].dense ] == handle.slot;
+}
+
+WidgetHandle WidgetStore::HandleAt( size_t index ) const
+{
+	auto slot = _denseToSlot[ index ];
+	return WidgetHandle{ slot, _slots[ slot ].generation };
+}
+
+void WidgetStore::SetRect( WidgetHandle handle, const graphics::RectF& rect )
+{
+	auto index = IndexOf( handle );
+	_rects[ index ] = rect;
+	_flags[ index ] |= k_WidgetDirtyPaint;
+}
+
+void WidgetStore::SetFlags( WidgetHandle handle, WidgetFlags set, WidgetFlags clear )
+{
+	auto index = IndexOf( handle );
+	auto flags = ( _flags[ index ] & ~clear ) | set;
+	constexpr WidgetFlags dirtyBits = k_WidgetDirtyLayout | k_WidgetDirtyPaint;
+	if ( ( flags & ~dirtyBits ) != ( _flags[ index ] & ~dirtyBits ) )
+		flags |= k_WidgetDirtyPaint;
+	_flags[ index ] = flags;
+}
+
+void WidgetStore::ClearFlags( WidgetFlags flags )
+{
+	for ( auto& value : _flags )
+	{
+		value &= ~flags;
+	}
+}
+
+void WidgetStore::SetZOrder( WidgetHandle handle, int32_t zOrder )
+{
+	auto index = IndexOf( handle );
+	if ( _zOrders[ index ] == zOrder )
+		return;
+
+	_zOrders[ index ] = zOrder;
+	_flags[ index ] |= k_WidgetDirtyPaint;
+	_orderDirty = true;
+}
+
+WidgetHandle WidgetStore::GetParent( WidgetHandle handle ) const
+{
+	auto parentSlot = _parents[ IndexOf( handle ) ];
+	if ( parentSlot == WidgetHandle::k_InvalidSlot )
+		return WidgetHandle{};
+	return WidgetHandle{ parentSlot, _slots[ parentSlot ].generation };
+}
+
+void WidgetStore::SortByZOrder()
+{
+	if ( !_orderDirty )
+		return;
+	_orderDirty = false;
+
+	std::vector<uint32_t> order( _rects.size() );
+	std::iota( order.begin(), order.end(), 0 );
+	std::sort( order.begin(), order.end(), [this] ( uint32_t a, uint32_t b ) {
+		return _zOrders[ a ] != _zOrders[ b ] ? _zOrders[ a ] < _zOrders[ b ] : _sequences[ a ] < _sequences[ b ];
+	} );
+
+	auto permute = [&order] ( auto& values ) {
+		std::remove_reference_t<decltype( values )> sorted;
+		sorted.reserve( values.size() );
+		for ( auto index : order )
+		{
+			sorted.push_back( values[ index ] );
+		}
+		values.swap( sorted );
+	};
+
+	permute( _rects );
+	permute( _flags );
+	permute( _zOrders );
+	permute( _parents );
+	permute( _denseToSlot );
+	permute( _sequences );
+
+	for ( uint32_t i = 0; i < _denseToSlot.size(); ++i )
+	{
+		_slots[ _denseToSlot[ i ] ].dense = i;
+	}
+}
+
+WidgetHandle WidgetStore::HitTest( const graphics::PointF& point ) const
+{
+	constexpr WidgetFlags hittable = k_WidgetVisible | k_WidgetEnabled;
+
+	if ( !_orderDirty )
+	{
+		for ( auto i = _rects.size(); i-- > 0; )
+		{
+			if ( ( _flags[ i ] & hittable ) == hittable && _rects[ i ].HasPoint( point ) )
+				return HandleAt( i );
+		}
+		return WidgetHandle{};
+	}
+
+	size_t best = _rects.size();
+	for ( size_t i = 0; i < _rects.size(); ++i )
+	{
+		if ( ( _flags[ i ] & hittable ) == hittable && _rects[ i ].HasPoint( point ) &&
+			( best == _rects.size() || _zOrders[ i ] > _zOrders[ best ] ||
+				( _zOrders[ i ] == _zOrders[ best ] && _sequences[ i ] > _sequences[ best ] ) ) )
+			best = i;
+	}
+	return best < _rects.size() ? HandleAt( best ) : WidgetHandle{};
+}
+
+} // namespace directui
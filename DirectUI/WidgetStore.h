@@ -0,0 +1,148 @@
+#pragma once
+
+#include "CoreTypes.h"
+
+#include <vector> // for std::vector
+#include <cstdint> // for uint32_t
+#include <cstddef> // for size_t
+#include <limits> // for std::numeric_limits
+
+namespace directui
+{
+
+using WidgetFlags = uint32_t;
+
+constexpr WidgetFlags k_WidgetVisible = 1u << 0;
+constexpr WidgetFlags k_WidgetEnabled = 1u << 1;
+constexpr WidgetFlags k_WidgetHovered = 1u << 2;
+constexpr WidgetFlags k_WidgetPressed = 1u << 3;
+constexpr WidgetFlags k_WidgetFocused = 1u << 4;
+constexpr WidgetFlags k_WidgetDirtyLayout = 1u << 8;
+constexpr WidgetFlags k_WidgetDirtyPaint = 1u << 9;
+
+// Stable reference to a widget. The generation makes handles of destroyed widgets invalid
+// even when their slot is reused.
+struct WidgetHandle
+{
+	static constexpr uint32_t k_InvalidSlot = std::numeric_limits<uint32_t>::max();
+
+	uint32_t slot{ k_InvalidSlot };
+	uint32_t generation{ 0 };
+
+	bool IsValid() const { return slot != k_InvalidSlot; }
+	bool operator==( const WidgetHandle& other ) const { return slot == other.slot && generation == other.generation; }
+	bool operator!=( const WidgetHandle& other ) const { return !( *this == other ); }
+};
+
+// Hot per-widget data in parallel arrays. The arrays are dense, destroying a widget moves the
+// last one into its place, and SortByZOrder keeps them in drawing order, so passes over all
+// widgets read them front to back. Handles map to dense indices through a slot table.
+//
+// Cold data (text, layouts, popups) lives in WidgetTable columns keyed by the handle slot.
+// Rects are in window DIPs, parents only scope Destroy and do not offset their children.
+class WidgetStore
+{
+private:
+	struct Slot
+	{
+		uint32_t dense;
+		uint32_t generation;
+	};
+
+	// Dense, indexed together
+	std::vector<graphics::RectF> _rects;
+	std::vector<WidgetFlags> _flags;
+	std::vector<int32_t> _zOrders;
+	std::vector<uint32_t> _parents; // parent slot
+	std::vector<uint32_t> _denseToSlot;
+	std::vector<uint64_t> _sequences; // creation order, slots are reused
+
+
+	std::vector<Slot> _slots;
+	std::vector<uint32_t> _childCounts; // by slot, lets Destroy skip the descendant search
+	std::vector<uint32_t> _freeSlots;
+	uint64_t _nextSequence{ 0 };
+	bool _orderDirty{ false };
+
+	void RemoveDense( uint32_t dense );
+
+public:
+	WidgetHandle Create( const graphics::RectF& rect, WidgetHandle parent = {}, int32_t zOrder = 0,
+		WidgetFlags flags = k_WidgetVisible | k_WidgetEnabled | k_WidgetDirtyPaint );
+	// Destroys the widget and all its descendants.
+	void Destroy( WidgetHandle handle );
+	void Clear();
+
+	bool IsAlive( WidgetHandle handle ) const;
+	size_t GetCount() const { return _rects.size(); }
+
+	// Dense index of a live widget, valid until the next Destroy or SortByZOrder.
+	size_t IndexOf( WidgetHandle handle ) const { return _slots[ handle.slot ].dense; }
+	WidgetHandle HandleAt( size_t index ) const;
+
+	const std::vector<graphics::RectF>& GetRects() const { return _rects; }
+	const std::vector<WidgetFlags>& GetFlags() const { return _flags; }
+
+	const graphics::RectF& GetRect( WidgetHandle handle ) const { return _rects[ IndexOf( handle ) ]; }
+	void SetRect( WidgetHandle handle, const graphics::RectF& rect );
+
+	WidgetFlags GetFlags( WidgetHandle handle ) const { return _flags[ IndexOf( handle ) ]; }
+	bool HasFlags( WidgetHandle handle, WidgetFlags flags ) const { return ( GetFlags( handle ) & flags ) == flags; }
+	// Changing anything but the dirty bits marks the widget for repaint.
+	void SetFlags( WidgetHandle handle, WidgetFlags set, WidgetFlags clear = 0 );
+	// Clears the given flags on every widget, e.g. the dirty bits after a pass.
+	void ClearFlags( WidgetFlags flags );
+
+	int32_t GetZOrder( WidgetHandle handle ) const { return _zOrders[ IndexOf( handle ) ]; }
+	void SetZOrder( WidgetHandle handle, int32_t zOrder );
+	WidgetHandle GetParent( WidgetHandle handle ) const;
+
+	// Stable, widgets with equal z-order keep their creation order.
+	void SortByZOrder();
+
+	// Topmost visible and enabled widget containing the point, in drawing order once sorted.
+	WidgetHandle HitTest( const graphics::PointF& point ) const;
+
+	// Calls callback( index ) for every widget having any of the flags, in dense order.
+	template< typename TCallback >
+	void ForEach( WidgetFlags anyOf, TCallback&& callback ) const
+	{
+		for ( size_t i = 0, count = _flags.size(); i < count; ++i )
+		{
+			if ( _flags[ i ] & anyOf )
+				callback( i );
+		}
+	}
+};
+
+// Column of cold per-widget data, indexed by the slot of the widget handle.
+template< typename T >
+class WidgetTable
+{
+private:
+	std::vector<T> _values;
+
+public:
+	T& operator[]( WidgetHandle handle )
+	{
+		if ( handle.slot >= _values.size() )
+			_values.resize( handle.slot + 1 );
+		return _values[ handle.slot ];
+	}
+
+	const T* Find( WidgetHandle handle ) const
+	{
+		return handle.slot < _values.size() ? &_values[ handle.slot ] : nullptr;
+	}
+
+	// Releases the value of a destroyed widget, its slot is going to be reused.
+	void Erase( WidgetHandle handle )
+	{
+		if ( handle.slot < _values.size() )
+			_values[ handle.slot ] = T{};
+	}
+
+	void Clear() { _values.clear(); }
+};
+
+} // namespace directui
@@ -1,401 +1,1215 @@
-#include "Window.h"
-#include "Application.h"
-#include "Graphics.h"
-#include "DxGraphics.h"
-
-#include <unordered_map>
-#include <algorithm>
-
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-#include <windows.h> // for Win32 API
-#include <windowsx.h> // for GET_X_LPARAM, GET_Y_LPARAM
-#include <dwmapi.h> // for access to Desktop Window Manager functions
-#include <versionhelpers.h>
-
-#ifdef _MSC_VER
-#pragma comment(linker, "/subsystem:windows /ENTRY:mainCRTStartup")
-#pragma comment(lib, "dwmapi.lib")
-#endif
-
-namespace directui
-{
-
-class Window::Impl
-{
-private:
-	Window& _self;
-
-	HWND _hwnd{ nullptr };
-	WindowType _type{ WindowType::Main };
-	bool _activated{ false };
-
-	bool _willDestroyPostQuit{ false };
-	std::unique_ptr<graphics::DeviceContext> _deviceContext;
-
-	static const wchar_t* ClassName() { return  L"DirectUIWindow"; }
-
-	struct WindowStyles
-	{
-		DWORD style;
-		DWORD exStyle;
-	};
-
-	static WindowStyles WindowStylesFromType( WindowType type )
-	{
-		switch ( type )
-		{
-			case WindowType::Main: return WindowStyles{ WS_OVERLAPPEDWINDOW, WS_EX_NOREDIRECTIONBITMAP | WS_EX_APPWINDOW };
-			case WindowType::Popup: return WindowStyles{ WS_POPUP, WS_EX_NOREDIRECTIONBITMAP };
-			case WindowType::Child: return WindowStyles{ WS_CHILDWINDOW, WS_EX_NOREDIRECTIONBITMAP };
-			default: return WindowStyles{ 0, 0 };
-		}
-	}
-
-public:
-	Impl( Window& self, WindowType type, graphics::Device& device, const RectPx& rcPx, Window* parentWindow )
-		: _self{ self }
-		, _type{ type }
-	{
-		RegisterOnce();
-
-		auto styles = WindowStylesFromType( type );
-		HWND parentHwnd = nullptr;
-
-		if ( parentWindow && parentWindow->_impl )
-			parentHwnd = parentWindow->_impl->_hwnd;
-
-		_hwnd = ::CreateWindowExW( styles.exStyle, ClassName(), nullptr, styles.style,
-			rcPx.x, rcPx.y, rcPx.w, rcPx.h,
-			parentHwnd, nullptr, ProgramInstance(), this );
-
-		_deviceContext = device.CreateDeviceContext();
-	}
-
-	~Impl()
-	{
-		::DestroyWindow( _hwnd );
-	}
-
-	Handle GetHandle() const { return _hwnd; }
-
-	float GetDpi()  const
-	{
-		return static_cast< float >( ::GetDpiForWindow( _hwnd ) );
-	}
-
-	RectPx GetRect() const
-	{
-		RECT rc{ 0, 0, 0, 0 };
-		::GetClientRect( _hwnd, &rc );
-		::MapWindowRect( _hwnd, nullptr, &rc );
-		return RectPx{ rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top };
-	}
-
-	void Show()
-	{
-		::ShowWindow( _hwnd, SW_SHOW );
-	}
-
-	void Redraw( WindowRedraw redraw )
-	{
-		::RedrawWindow( _hwnd, nullptr, nullptr, redraw == WindowRedraw::Invalidate ? RDW_INVALIDATE : RDW_UPDATENOW );
-	}
-
-	void Move( const RectPx& rcPx )
-	{
-		::SetWindowPos( _hwnd, nullptr, rcPx.x, rcPx.y, rcPx.w, rcPx.h, SWP_NOACTIVATE | SWP_NOZORDER );
-	}
-
-	int MessageLoop()
-	{
-		_willDestroyPostQuit = true;
-
-		MSG msg;
-		while ( ::GetMessageW( &msg, nullptr, 0, 0 ) )
-		{
-			::TranslateMessage( &msg );
-			::DispatchMessageW( &msg );
-		}
-
-		return static_cast< int >( msg.wParam );
-	}
-
-private:
-	LRESULT OnMessage( UINT message, WPARAM wParam, LPARAM lParam )
-	{
-		if ( message == WM_DESTROY && _willDestroyPostQuit )
-		{
-			::PostQuitMessage( 0 );
-			return 0;
-		}
-
-		LRESULT result = 0;
-		if ( ::DwmDefWindowProc( _hwnd, message, wParam, lParam, &result ) )
-		{
-			return result;
-		}
-
-		switch ( message )
-		{
-			case WM_ACTIVATE:
-			{
-				if ( !_activated && _type == WindowType::Main )
-				{
-					MARGINS margins{ 1,1,1,1 };
-					auto hr = ::DwmExtendFrameIntoClientArea( _hwnd, &margins );
-					if ( SUCCEEDED( hr ) )
-					{
-						::SetWindowPos( _hwnd, nullptr, 0, 0, 0, 0, SWP_NOSIZE | SWP_NOMOVE | SWP_NOZORDER | SWP_NOACTIVATE | SWP_FRAMECHANGED );
-					}
-					_activated = true;
-					return 0;
-				}
-			} break;
-			case WM_ERASEBKGND:
-			{
-				return 1;
-			} break;
-			case WM_NCCALCSIZE:
-			{
-				if ( wParam == TRUE && _type == WindowType::Main )
-				{
-					return 0;
-				}
-			} break;
-			case WM_NCHITTEST:
-			{
-				int x = GET_X_LPARAM( lParam );
-				int y = GET_Y_LPARAM( lParam );
-				
-				auto rect = GetRect();
-
-				if ( x > rect.x&& x < rect.x + rect.w )
-				{
-					if ( y > rect.y&& y < std::min( rect.y + rect.h, rect.y + 40 ) )
-					{
-						return HTCAPTION;
-					}
-				}
-
-				//return HTCLIENT;
-
-				//return HTNOWHERE;
-			} break;
-			case WM_PAINT:
-			{
-				_deviceContext->BeginDraw( _hwnd );
-
-				if ( _self.OnDraw )
-					_self.OnDraw( _self, *_deviceContext );
-				
-				_deviceContext->EndDraw();
-
-				return 0;
-			} break;
-			case WM_MOUSEMOVE:
-			case WM_LBUTTONDOWN:
-			case WM_LBUTTONUP:
-			case WM_LBUTTONDBLCLK:
-			case WM_MBUTTONDOWN:
-			case WM_MBUTTONUP:
-			case WM_MBUTTONDBLCLK:
-			case WM_RBUTTONDOWN:
-			case WM_RBUTTONUP:
-			case WM_RBUTTONDBLCLK:
-			case WM_XBUTTONDOWN:
-			case WM_XBUTTONUP:
-			case WM_XBUTTONDBLCLK:
-			{
-				int x = GET_X_LPARAM( lParam );
-				int y = GET_Y_LPARAM( lParam );
-
-				struct MouseButtonAndState { MouseButton button; MouseState state; };
-
-				std::unordered_map<UINT, MouseButtonAndState> mapMessageToMouse
-				{
-					{ WM_MOUSEMOVE,		{ MouseButton::None,	MouseState::Move		} },
-					{ WM_LBUTTONDOWN,	{ MouseButton::Left,	MouseState::Down		} },
-					{ WM_LBUTTONUP,		{ MouseButton::Left,	MouseState::Up			} },
-					{ WM_LBUTTONDBLCLK,	{ MouseButton::Left,	MouseState::DoubleClick } },
-					{ WM_MBUTTONDOWN,	{ MouseButton::Middle,	MouseState::Down		} },
-					{ WM_MBUTTONUP,		{ MouseButton::Middle,	MouseState::Up			} },
-					{ WM_MBUTTONDBLCLK,	{ MouseButton::Middle,	MouseState::DoubleClick } },
-					{ WM_RBUTTONDOWN,	{ MouseButton::Right,	MouseState::Down		} },
-					{ WM_RBUTTONUP,		{ MouseButton::Right,	MouseState::Up			} },
-					{ WM_RBUTTONDBLCLK,	{ MouseButton::Right,	MouseState::DoubleClick } },
-					{ WM_XBUTTONDOWN,	{ MouseButton::Other,	MouseState::Down		} },
-					{ WM_XBUTTONUP,		{ MouseButton::Other,	MouseState::Up			} },
-					{ WM_XBUTTONDBLCLK,	{ MouseButton::Other,	MouseState::DoubleClick } },
-				};
-
-				if ( _self.OnMouse )
-				{
-					const auto& mouse = mapMessageToMouse.at( message );
-					if ( mouse.state == MouseState::Down )
-					{
-						::SetCapture( _hwnd );
-					}
-					else if ( mouse.state == MouseState::Up )
-					{
-						::ReleaseCapture();
-					}
-					_self.OnMouse( _self, mouse.state, mouse.button, PointPx{ x, y } );
-				}
-
-			} break;
-			case WM_MOUSEWHEEL:
-			default:
-				break;
-		}
-
-		return ::DefWindowProcW( _hwnd, message, wParam, lParam );
-	}
-
-	static LRESULT CALLBACK WindowProc( HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam )
-	{
-		Window::Impl* pThis = nullptr;
-
-		if ( message == WM_NCCREATE )
-		{
-			CREATESTRUCT* pCreate = reinterpret_cast< CREATESTRUCT* >( lParam );
-			pThis = reinterpret_cast< Window::Impl* >( pCreate->lpCreateParams );
-			::SetWindowLongPtrW( hwnd, GWLP_USERDATA, reinterpret_cast< LONG_PTR >( pThis ) );
-
-			pThis->_hwnd = hwnd;
-		}
-		else
-		{
-			pThis = reinterpret_cast< Window::Impl* >( ::GetWindowLongPtrW( hwnd, GWLP_USERDATA ) );
-		}
-
-		if ( pThis )
-			return pThis->OnMessage( message, wParam, lParam );
-
-		return ::DefWindowProcW( hwnd, message, wParam, lParam );
-	}
-
-	static HINSTANCE ProgramInstance()
-	{
-		return ::GetModuleHandle( nullptr );
-	}
-
-	static void RegisterOnce()
-	{
-		static bool isRegistered = false;
-		if ( isRegistered )
-			return;
-
-		isRegistered = true;
-
-		WNDCLASSEXW wc;
-
-		wc.cbSize = sizeof( WNDCLASSEX );
-
-		wc.style = CS_DBLCLKS | CS_VREDRAW | CS_HREDRAW;
-		wc.lpfnWndProc = WindowProc;
-		wc.cbClsExtra = 0;
-		wc.cbWndExtra = 0;
-		wc.hInstance = ProgramInstance();
-		wc.hIcon = nullptr;
-		wc.hCursor = ::LoadCursorW( nullptr, reinterpret_cast< LPCWSTR >( IDC_ARROW ) );
-		wc.hbrBackground = nullptr;
-		wc.lpszMenuName = nullptr;
-		wc.lpszClassName = ClassName();
-		wc.hIconSm = nullptr;
-
-		::RegisterClassExW( &wc );
-	}
-};
-
-Window::Window( WindowType type, const RectPx& rcPx, Window* parentWindow )
-{
-	_impl.reset( new Impl{ *this, type, Application::Instance()->GetDevice(), rcPx, parentWindow } );
-}
-
-Window::~Window()
-{
-	_impl.reset();
-}
-
-Handle Window::GetHandle() const
-{
-	return _impl->GetHandle();
-}
-
-float Window::GetDpi() const
-{
-	return _impl->GetDpi();
-}
-
-RectPx Window::GetRect() const
-{
-	return _impl->GetRect();
-}
-
-void Window::Show()
-{
-	_impl->Show();
-}
-
-void Window::Redraw( WindowRedraw redraw )
-{
-	_impl->Redraw( redraw );
-}
-
-void Window::Move( const RectPx& rcPx )
-{
-	_impl->Move( rcPx );
-}
-
-class Application::Impl
-{
-private:
-	std::unique_ptr<graphics::Device> _device;
-public:
-	Impl()
-	{
-		_device = graphics::dx::CreateDevice();
-	}
-
-	graphics::Device& GetDevice()
-	{
-		return *_device.get();
-	}
-};
-
-Application::Application()
-{
-	_impl.reset( new Impl{} );
-	Instance() = this;
-}
-
-Application::~Application()
-{
-	_impl.reset();
-	Instance() = nullptr;
-}
-
-Application*& Application::Instance()
-{
-	static Application* _instance{ nullptr };
-	return _instance;
-}
-
-int Application::Run( Window& window )
-{
-	return window._impl->MessageLoop();
-}
-
-graphics::Device& Application::GetDevice()
-{
-	return _impl->GetDevice();
-}
-
-float GetSystemDpi()
-{
-	return static_cast< float >( ::GetDpiForSystem() );
-}
-
-} // namespace directui
-
+#include "Window.h"
+#include "Application.h"
+#include "Graphics.h"
+#include "DxGraphics.h"
+#include "Animation.h"
+#include "TimerWheel.h"
+#include "HitTestMap.h"
+#include "LatencyTracker.h"
+#include "PointerHistory.h"
+#include "Dpi.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <optional>
+#include <atomic>
+#include <exception>
+#include <utility>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h> // for Win32 API
+#include <windowsx.h> // for GET_X_LPARAM, GET_Y_LPARAM
+#include <dwmapi.h> // for access to Desktop Window Manager functions
+#include <versionhelpers.h>
+
+#ifdef _MSC_VER
+#pragma comment(linker, "/subsystem:windows /ENTRY:mainCRTStartup")
+#pragma comment(lib, "dwmapi.lib")
+#endif
+
+namespace directui
+{
+
+class Window::Impl
+{
+private:
+	Window& _self;
+
+	HWND _hwnd{ nullptr };
+	WindowType _type{ WindowType::Main };
+	bool _activated{ false };
+
+	// Updated on WM_WINDOWPOSCHANGED so hit testing and GetRect make no syscalls. Written on the
+	// UI thread, other threads read under the geometry mutex.
+	RectPx _rect;
+	float _dpi{ k_DefaultDpi };
+	mutable std::mutex _geometryMutex;
+	HitTestMap _hitTestMap;
+
+	static constexpr float k_CaptionHeight = 40;
+	static constexpr float k_ResizeBorder = 4;
+
+	// Created at Show or the first frame, windows that are never shown need none. The swap chain
+	// follows at the first frame.
+	graphics::Device& _device;
+	std::unique_ptr<graphics::DeviceContext> _deviceContext;
+	std::optional<graphics::ResourceBudget> _resourceBudget;
+	CancellationSource _cancellation;
+	LatencyTracker _latency;
+
+	// Pointer samples for OnPointerBatch. The last point read by GetMouseMovePointsEx marks
+	// where the next read continues.
+	PointerHistory _pointerHistory;
+	std::vector<PointerSample> _pointerBatch;
+	MOUSEMOVEPOINT _lastPointer{};
+	std::chrono::milliseconds _pointerPrediction{ 0 };
+
+	// Held while drawing, and on the UI thread while input callbacks run if there is a render
+	// thread. The owner is the thread running callbacks under the lock, window calls made from
+	// them skip locking it again.
+	std::mutex _drawMutex;
+	std::atomic<std::thread::id> _drawLockOwner{ std::thread::id{} };
+
+	// Optional render thread, WM_PAINT only requests a frame from it
+	std::thread _renderThread;
+	std::mutex _renderMutex;
+	std::condition_variable _renderSignal;
+	bool _frameRequested{ false };
+	bool _stopRendering{ false };
+
+	static const wchar_t* ClassName() { return  L"DirectUIWindow"; }
+
+	struct WindowStyles
+	{
+		DWORD style;
+		DWORD exStyle;
+	};
+
+	static WindowStyles WindowStylesFromType( WindowType type )
+	{
+		switch ( type )
+		{
+			case WindowType::Main: return WindowStyles{ WS_OVERLAPPEDWINDOW, WS_EX_NOREDIRECTIONBITMAP | WS_EX_APPWINDOW };
+			case WindowType::Popup: return WindowStyles{ WS_POPUP, WS_EX_NOREDIRECTIONBITMAP };
+			case WindowType::Child: return WindowStyles{ WS_CHILDWINDOW, WS_EX_NOREDIRECTIONBITMAP };
+			default: return WindowStyles{ 0, 0 };
+		}
+	}
+
+public:
+	Impl( Window& self, WindowType type, graphics::Device& device, const RectPx& rcPx, Window* parentWindow, bool renderThread )
+		: _self{ self }
+		, _type{ type }
+		, _device{ device }
+	{
+		RegisterOnce();
+
+		auto styles = WindowStylesFromType( type );
+		HWND parentHwnd = nullptr;
+
+		if ( parentWindow && parentWindow->_impl )
+			parentHwnd = parentWindow->_impl->_hwnd;
+
+		if ( type == WindowType::Main )
+		{
+			_hitTestMap.AddCaption( k_CaptionHeight );
+			_hitTestMap.AddResizeBorders( k_ResizeBorder );
+		}
+
+		_hwnd = ::CreateWindowExW( styles.exStyle, ClassName(), nullptr, styles.style,
+			rcPx.x, rcPx.y, rcPx.w, rcPx.h,
+			parentHwnd, nullptr, ProgramInstance(), this );
+
+		UpdateGeometry();
+
+		if ( renderThread )
+		{
+			_renderThread = std::thread{ [this] { RenderLoop(); } };
+		}
+	}
+
+	~Impl()
+	{
+		_cancellation.Cancel();
+		StopRenderThread();
+		::DestroyWindow( _hwnd );
+	}
+
+	Handle GetHandle() const { return _hwnd; }
+
+	float GetDpi()  const
+	{
+		std::lock_guard<std::mutex> lock{ _geometryMutex };
+		return _dpi;
+	}
+
+	RectPx GetRect() const
+	{
+		std::lock_guard<std::mutex> lock{ _geometryMutex };
+		return _rect;
+	}
+
+	void SetHitTestMap( const HitTestMap& map )
+	{
+		_hitTestMap = map;
+		_hitTestMap.Update( SizePx{ _rect.w, _rect.h }, _dpi );
+	}
+
+	void Show()
+	{
+		{
+			auto lock = LockDrawUnlessOwned();
+			GetDeviceContext();
+		}
+		RunOnUiThread( [hwnd = _hwnd] { ::ShowWindow( hwnd, SW_SHOW ); } );
+	}
+
+	void Redraw( WindowRedraw redraw )
+	{
+		if ( redraw == WindowRedraw::Invalidate )
+			::RedrawWindow( _hwnd, nullptr, nullptr, RDW_INVALIDATE );
+		else
+			RunOnUiThread( [hwnd = _hwnd] { ::RedrawWindow( hwnd, nullptr, nullptr, RDW_UPDATENOW ); } );
+	}
+
+	void Move( const RectPx& rcPx )
+	{
+		RunOnUiThread( [hwnd = _hwnd, rcPx] {
+			::SetWindowPos( hwnd, nullptr, rcPx.x, rcPx.y, rcPx.w, rcPx.h, SWP_NOACTIVATE | SWP_NOZORDER );
+		} );
+	}
+
+	bool HasRenderThread() const { return _renderThread.joinable(); }
+
+	CancellationToken GetCancellationToken() const { return _cancellation.GetToken(); }
+
+	std::mutex& GetDrawMutex() { return _drawMutex; }
+
+	graphics::ResourceUsage GetResourceUsage() const
+	{
+		return _deviceContext ? _deviceContext->GetResourceUsage() : graphics::ResourceUsage{};
+	}
+
+	void SetResourceBudget( const graphics::ResourceBudget& budget )
+	{
+		auto lock = LockDrawUnlessOwned();
+		_resourceBudget = budget;
+		if ( _deviceContext )
+			_deviceContext->SetResourceBudget( budget );
+	}
+
+	LatencyTracker& GetLatencyTracker() { return _latency; }
+
+	void SetPointerPrediction( std::chrono::milliseconds ahead )
+	{
+		auto lock = LockDrawUnlessOwned();
+		_pointerPrediction = ahead;
+	}
+
+private:
+	// Holds the draw mutex while callbacks run, see _drawLockOwner.
+	class CallbackLock
+	{
+	private:
+		Impl& _impl;
+		std::lock_guard<std::mutex> _lock;
+
+	public:
+		explicit CallbackLock( Impl& impl ) : _impl{ impl }, _lock{ impl._drawMutex }
+		{
+			_impl._drawLockOwner = std::this_thread::get_id();
+		}
+		~CallbackLock() { _impl._drawLockOwner = std::thread::id{}; }
+	};
+
+	// Calls that send messages wait for the UI thread, which may be waiting for the draw lock held
+	// by a render thread making them. Other threads post them, they are dropped once the window
+	// is destroyed.
+	template< typename TCall >
+	void RunOnUiThread( TCall&& call )
+	{
+		auto application = Application::Instance();
+		if ( application->IsUiThread() )
+		{
+			call();
+			return;
+		}
+
+		application->GetUiDispatcher().Post( [token = _cancellation.GetToken(), call = std::forward<TCall>( call )] {
+			if ( !token.IsCancelled() )
+				call();
+		} );
+	}
+
+	// Does not own the mutex when called from a callback that runs under it.
+	std::unique_lock<std::mutex> LockDrawUnlessOwned()
+	{
+		if ( _drawLockOwner == std::this_thread::get_id() )
+			return std::unique_lock<std::mutex>{};
+		return std::unique_lock<std::mutex>{ _drawMutex };
+	}
+
+	// Called under the draw mutex.
+	graphics::DeviceContext& GetDeviceContext()
+	{
+		if ( _deviceContext == nullptr )
+		{
+			_deviceContext = _device.CreateDeviceContext();
+			if ( _resourceBudget )
+				_deviceContext->SetResourceBudget( *_resourceBudget );
+		}
+		return *_deviceContext;
+	}
+
+	void UpdateGeometry()
+	{
+		RECT rc{ 0, 0, 0, 0 };
+		::GetClientRect( _hwnd, &rc );
+		::MapWindowRect( _hwnd, nullptr, &rc );
+		RectPx rect{ rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top };
+		auto dpi = static_cast< float >( ::GetDpiForWindow( _hwnd ) );
+
+		bool resized = rect.w != _rect.w || rect.h != _rect.h || dpi != _dpi;
+		{
+			std::lock_guard<std::mutex> lock{ _geometryMutex };
+			_rect = rect;
+			_dpi = dpi;
+		}
+
+		if ( resized )
+			_hitTestMap.Update( SizePx{ rect.w, rect.h }, dpi );
+	}
+
+	static LRESULT ToNonClientHit( HitTest hit )
+	{
+		switch ( hit )
+		{
+			case HitTest::Nowhere: return HTNOWHERE;
+			case HitTest::Client: return HTCLIENT;
+			case HitTest::Caption: return HTCAPTION;
+			case HitTest::SystemMenu: return HTSYSMENU;
+			case HitTest::MinimizeButton: return HTMINBUTTON;
+			case HitTest::MaximizeButton: return HTMAXBUTTON;
+			case HitTest::CloseButton: return HTCLOSE;
+			case HitTest::Left: return HTLEFT;
+			case HitTest::Right: return HTRIGHT;
+			case HitTest::Top: return HTTOP;
+			case HitTest::Bottom: return HTBOTTOM;
+			case HitTest::TopLeft: return HTTOPLEFT;
+			case HitTest::TopRight: return HTTOPRIGHT;
+			case HitTest::BottomLeft: return HTBOTTOMLEFT;
+			case HitTest::BottomRight: return HTBOTTOMRIGHT;
+			default: return HTNOWHERE;
+		}
+	}
+
+	void Draw()
+	{
+		CallbackLock lock{ *this };
+
+		auto frame = _latency.BeginFrame();
+
+		if ( _self.OnPointerBatch && _pointerHistory.HasPending() )
+		{
+			_pointerHistory.Take( _pointerBatch );
+			std::optional<PointPx> predicted;
+			if ( _pointerPrediction.count() > 0 )
+				predicted = _pointerHistory.Predict( _pointerPrediction );
+			_self.OnPointerBatch( _self, PointerBatch{ _pointerBatch, predicted } );
+		}
+
+		auto& deviceContext = GetDeviceContext();
+		deviceContext.BeginDraw( _hwnd );
+
+		if ( _self.OnDraw )
+			_self.OnDraw( _self, deviceContext );
+
+		deviceContext.EndDraw();
+
+		auto presented = LatencyTracker::Clock::now();
+		auto statistics = deviceContext.GetPresentStatistics();
+		_latency.OnPresent( frame, presented, statistics.presentCount, statistics.displayedPresentCount, statistics.displayedTime );
+		Application::Instance()->OnFramePresented();
+	}
+
+	static bool IsInputMessage( UINT message )
+	{
+		return ( message >= WM_MOUSEFIRST && message <= WM_MOUSELAST ) || ( message >= WM_KEYFIRST && message <= WM_KEYLAST );
+	}
+
+	// Message and pointer times have the resolution of GetTickCount, 10 to 16 ms.
+	static std::chrono::steady_clock::time_point FromTickTime( DWORD tick )
+	{
+		auto age = static_cast< DWORD >( ::GetTickCount() ) - tick;
+		return std::chrono::steady_clock::now() - std::chrono::milliseconds{ age };
+	}
+
+	// When the system received the message being processed.
+	static std::chrono::steady_clock::time_point MessageTime()
+	{
+		return FromTickTime( static_cast< DWORD >( ::GetMessageTime() ) );
+	}
+
+	// Reads the moves coalesced into the current WM_MOUSEMOVE, newest first, up to the last point
+	// read before. The system keeps moves made outside the window too, moves older than
+	// k_MaxPointerAge before the message are not part of this interaction. Display points are
+	// 16-bit, coordinates on monitors left of or above the primary one wrap around.
+	void CollectPointerSamples( const PointPx& client )
+	{
+		constexpr int k_MaxPoints = 64;
+		constexpr DWORD k_MaxPointerAge = 250; // ms
+
+		MOUSEMOVEPOINT current{};
+		current.x = ( client.x + _rect.x ) & 0xFFFF;
+		current.y = ( client.y + _rect.y ) & 0xFFFF;
+		current.time = static_cast< DWORD >( ::GetMessageTime() );
+
+		MOUSEMOVEPOINT points[ k_MaxPoints ];
+		int count = ::GetMouseMovePointsEx( sizeof( MOUSEMOVEPOINT ), &current, points, k_MaxPoints, GMMP_USE_DISPLAY_POINTS );
+		if ( count <= 0 )
+		{
+			points[ 0 ] = current;
+			count = 1;
+		}
+
+		auto isLast = [this] ( const MOUSEMOVEPOINT& point ) {
+			return point.x == _lastPointer.x && point.y == _lastPointer.y && point.time == _lastPointer.time;
+		};
+		auto isOlder = [this, &current] ( const MOUSEMOVEPOINT& point ) {
+			return static_cast< LONG >( point.time - _lastPointer.time ) < 0 || current.time - point.time > k_MaxPointerAge;
+		};
+
+		int newCount = 0;
+		while ( newCount < count && !isLast( points[ newCount ] ) && !isOlder( points[ newCount ] ) )
+		{
+			newCount++;
+		}
+
+		auto unwrap = [] ( int coordinate ) { return coordinate > 32767 ? coordinate - 65536 : coordinate; };
+		for ( int i = newCount; i-- > 0; )
+		{
+			PointPx position{ unwrap( points[ i ].x ) - _rect.x, unwrap( points[ i ].y ) - _rect.y };
+			_pointerHistory.Add( PointerSample{ position, FromTickTime( points[ i ].time ) } );
+		}
+
+		_lastPointer = points[ 0 ];
+		if ( newCount > 0 )
+			Redraw( WindowRedraw::Invalidate );
+	}
+
+	void RequestFrame()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ _renderMutex };
+			_frameRequested = true;
+		}
+		_renderSignal.notify_one();
+	}
+
+	void RenderLoop()
+	{
+		for ( ;; )
+		{
+			{
+				std::unique_lock<std::mutex> lock{ _renderMutex };
+				_renderSignal.wait( lock, [this] { return _frameRequested || _stopRendering; } );
+				if ( _stopRendering )
+					return;
+				_frameRequested = false;
+			}
+
+			// Requests arriving while drawing are merged into a single next frame.
+			Draw();
+		}
+	}
+
+	void StopRenderThread()
+	{
+		if ( !_renderThread.joinable() )
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock{ _renderMutex };
+			_stopRendering = true;
+		}
+		_renderSignal.notify_one();
+		_renderThread.join();
+	}
+
+	LRESULT OnMessage( UINT message, WPARAM wParam, LPARAM lParam )
+	{
+		if ( message == WM_DESTROY )
+		{
+			StopRenderThread();
+			Application::Instance()->OnWindowDestroyed( _self );
+		}
+
+		if ( IsInputMessage( message ) )
+			_latency.OnInput( MessageTime() );
+
+		LRESULT result = 0;
+		if ( ::DwmDefWindowProc( _hwnd, message, wParam, lParam, &result ) )
+		{
+			return result;
+		}
+
+		switch ( message )
+		{
+			case WM_ACTIVATE:
+			{
+				if ( !_activated && _type == WindowType::Main )
+				{
+					MARGINS margins{ 1,1,1,1 };
+					auto hr = ::DwmExtendFrameIntoClientArea( _hwnd, &margins );
+					if ( SUCCEEDED( hr ) )
+					{
+						::SetWindowPos( _hwnd, nullptr, 0, 0, 0, 0, SWP_NOSIZE | SWP_NOMOVE | SWP_NOZORDER | SWP_NOACTIVATE | SWP_FRAMECHANGED );
+					}
+					_activated = true;
+					return 0;
+				}
+			} break;
+			case WM_ERASEBKGND:
+			{
+				return 1;
+			} break;
+			case WM_NCCALCSIZE:
+			{
+				if ( wParam == TRUE && _type == WindowType::Main )
+				{
+					return 0;
+				}
+			} break;
+			case WM_NCHITTEST:
+			{
+				if ( !_hitTestMap.IsEmpty() )
+				{
+					PointPx point{ GET_X_LPARAM( lParam ) - _rect.x, GET_Y_LPARAM( lParam ) - _rect.y };
+					return ToNonClientHit( _hitTestMap.Lookup( point ) );
+				}
+			} break;
+			case WM_WINDOWPOSCHANGED:
+			{
+				UpdateGeometry();
+			} break;
+			case WM_DPICHANGED:
+			{
+				// Content is laid out in DIPs and rescaled by the device context, the window only
+				// takes the suggested rect. SetWindowPos sends no WM_WINDOWPOSCHANGED when the rect
+				// stays the same, so the geometry is refreshed here as well.
+				auto suggested = reinterpret_cast< const RECT* >( lParam );
+				::SetWindowPos( _hwnd, nullptr, suggested->left, suggested->top,
+					suggested->right - suggested->left, suggested->bottom - suggested->top,
+					SWP_NOZORDER | SWP_NOACTIVATE );
+				UpdateGeometry();
+				Redraw( WindowRedraw::Invalidate );
+				return 0;
+			} break;
+			case WM_PAINT:
+			{
+				if ( HasRenderThread() )
+				{
+					::ValidateRect( _hwnd, nullptr );
+					RequestFrame();
+				}
+				else
+				{
+					Draw();
+				}
+
+				return 0;
+			} break;
+			case WM_MOUSEMOVE:
+			case WM_LBUTTONDOWN:
+			case WM_LBUTTONUP:
+			case WM_LBUTTONDBLCLK:
+			case WM_MBUTTONDOWN:
+			case WM_MBUTTONUP:
+			case WM_MBUTTONDBLCLK:
+			case WM_RBUTTONDOWN:
+			case WM_RBUTTONUP:
+			case WM_RBUTTONDBLCLK:
+			case WM_XBUTTONDOWN:
+			case WM_XBUTTONUP:
+			case WM_XBUTTONDBLCLK:
+			{
+				int x = GET_X_LPARAM( lParam );
+				int y = GET_Y_LPARAM( lParam );
+
+				if ( message == WM_MOUSEMOVE && _self.OnPointerBatch )
+					CollectPointerSamples( PointPx{ x, y } );
+
+				struct MouseButtonAndState { MouseButton button; MouseState state; };
+
+				std::unordered_map<UINT, MouseButtonAndState> mapMessageToMouse
+				{
+					{ WM_MOUSEMOVE,		{ MouseButton::None,	MouseState::Move		} },
+					{ WM_LBUTTONDOWN,	{ MouseButton::Left,	MouseState::Down		} },
+					{ WM_LBUTTONUP,		{ MouseButton::Left,	MouseState::Up			} },
+					{ WM_LBUTTONDBLCLK,	{ MouseButton::Left,	MouseState::DoubleClick } },
+					{ WM_MBUTTONDOWN,	{ MouseButton::Middle,	MouseState::Down		} },
+					{ WM_MBUTTONUP,		{ MouseButton::Middle,	MouseState::Up			} },
+					{ WM_MBUTTONDBLCLK,	{ MouseButton::Middle,	MouseState::DoubleClick } },
+					{ WM_RBUTTONDOWN,	{ MouseButton::Right,	MouseState::Down		} },
+					{ WM_RBUTTONUP,		{ MouseButton::Right,	MouseState::Up			} },
+					{ WM_RBUTTONDBLCLK,	{ MouseButton::Right,	MouseState::DoubleClick } },
+					{ WM_XBUTTONDOWN,	{ MouseButton::Other,	MouseState::Down		} },
+					{ WM_XBUTTONUP,		{ MouseButton::Other,	MouseState::Up			} },
+					{ WM_XBUTTONDBLCLK,	{ MouseButton::Other,	MouseState::DoubleClick } },
+				};
+
+				if ( _self.OnMouse )
+				{
+					const auto& mouse = mapMessageToMouse.at( message );
+					if ( mouse.state == MouseState::Down )
+					{
+						::SetCapture( _hwnd );
+					}
+					else if ( mouse.state == MouseState::Up )
+					{
+						::ReleaseCapture();
+					}
+					// Without a render thread drawing happens on this thread, nothing to exclude. Redraw
+					// with WindowRedraw::Now draws synchronously and locks the mutex itself then.
+					if ( HasRenderThread() )
+					{
+						CallbackLock lock{ *this };
+						_self.OnMouse( _self, mouse.state, mouse.button, PointPx{ x, y } );
+					}
+					else
+					{
+						_self.OnMouse( _self, mouse.state, mouse.button, PointPx{ x, y } );
+					}
+				}
+
+			} break;
+			case WM_MOUSEWHEEL:
+			default:
+				break;
+		}
+
+		return ::DefWindowProcW( _hwnd, message, wParam, lParam );
+	}
+
+	static LRESULT CALLBACK WindowProc( HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam )
+	{
+		Window::Impl* pThis = nullptr;
+
+		if ( message == WM_NCCREATE )
+		{
+			CREATESTRUCT* pCreate = reinterpret_cast< CREATESTRUCT* >( lParam );
+			pThis = reinterpret_cast< Window::Impl* >( pCreate->lpCreateParams );
+			::SetWindowLongPtrW( hwnd, GWLP_USERDATA, reinterpret_cast< LONG_PTR >( pThis ) );
+
+			pThis->_hwnd = hwnd;
+		}
+		else
+		{
+			pThis = reinterpret_cast< Window::Impl* >( ::GetWindowLongPtrW( hwnd, GWLP_USERDATA ) );
+		}
+
+		if ( pThis )
+			return pThis->OnMessage( message, wParam, lParam );
+
+		return ::DefWindowProcW( hwnd, message, wParam, lParam );
+	}
+
+	static HINSTANCE ProgramInstance()
+	{
+		return ::GetModuleHandle( nullptr );
+	}
+
+	static void RegisterOnce()
+	{
+		static bool isRegistered = false;
+		if ( isRegistered )
+			return;
+
+		isRegistered = true;
+
+		WNDCLASSEXW wc;
+
+		wc.cbSize = sizeof( WNDCLASSEX );
+
+		wc.style = CS_DBLCLKS | CS_VREDRAW | CS_HREDRAW;
+		wc.lpfnWndProc = WindowProc;
+		wc.cbClsExtra = 0;
+		wc.cbWndExtra = 0;
+		wc.hInstance = ProgramInstance();
+		wc.hIcon = nullptr;
+		wc.hCursor = ::LoadCursorW( nullptr, reinterpret_cast< LPCWSTR >( IDC_ARROW ) );
+		wc.hbrBackground = nullptr;
+		wc.lpszMenuName = nullptr;
+		wc.lpszClassName = ClassName();
+		wc.hIconSm = nullptr;
+
+		::RegisterClassExW( &wc );
+	}
+};
+
+Window::Window( WindowType type, const RectPx& rcPx, Window* parentWindow )
+{
+	auto begin = std::chrono::steady_clock::now();
+	auto application = Application::Instance();
+	bool renderThread = type == WindowType::Main && application->GetRenderThreads();
+
+	_impl.reset( new Impl{ *this, type, application->GetDevice(), rcPx, parentWindow, renderThread } );
+	application->AddStartupPhase( "First window", begin );
+
+	if ( type == WindowType::Main )
+		application->RegisterWindow( *this );
+}
+
+Window::~Window()
+{
+	auto application = Application::Instance();
+	application->GetAnimator().Cancel( *this );
+	_impl.reset();
+	application->UnregisterWindow( *this );
+}
+
+Handle Window::GetHandle() const
+{
+	return _impl->GetHandle();
+}
+
+float Window::GetDpi() const
+{
+	return _impl->GetDpi();
+}
+
+RectPx Window::GetRect() const
+{
+	return _impl->GetRect();
+}
+
+void Window::SetHitTestMap( const HitTestMap& map )
+{
+	_impl->SetHitTestMap( map );
+}
+
+void Window::SetPointerPrediction( std::chrono::milliseconds ahead )
+{
+	_impl->SetPointerPrediction( ahead );
+}
+
+void Window::Show()
+{
+	_impl->Show();
+}
+
+void Window::Redraw( WindowRedraw redraw )
+{
+	_impl->Redraw( redraw );
+}
+
+void Window::Move( const RectPx& rcPx )
+{
+	_impl->Move( rcPx );
+}
+
+CancellationToken Window::GetCancellationToken() const
+{
+	return _impl->GetCancellationToken();
+}
+
+bool Window::HasRenderThread() const
+{
+	return _impl->HasRenderThread();
+}
+
+std::unique_lock<std::mutex> Window::LockDraw()
+{
+	return std::unique_lock<std::mutex>{ _impl->GetDrawMutex() };
+}
+
+std::unique_lock<std::mutex> Window::TryLockDraw()
+{
+	return std::unique_lock<std::mutex>{ _impl->GetDrawMutex(), std::try_to_lock };
+}
+
+graphics::ResourceUsage Window::GetResourceUsage() const
+{
+	return _impl->GetResourceUsage();
+}
+
+void Window::SetResourceBudget( const graphics::ResourceBudget& budget )
+{
+	_impl->SetResourceBudget( budget );
+	Redraw();
+}
+
+LatencyStats Window::GetLatencyStats() const
+{
+	return _impl->GetLatencyTracker().GetStats();
+}
+
+void Window::ResetLatencyStats()
+{
+	_impl->GetLatencyTracker().Reset();
+}
+
+// Runs posted callbacks from the window procedure of a message-only window, so they are
+// also dispatched by modal loops (moving or resizing a window, message boxes). Exceptions
+// must not unwind through the system code calling the window procedure, the first one is
+// kept and rethrown by the message loop.
+class UiDispatcher : public Dispatcher
+{
+private:
+	static constexpr UINT k_RunCallbacks = WM_APP + 1;
+
+	HWND _hwnd{ nullptr };
+	std::mutex _mutex;
+	std::vector<std::function<void()>> _callbacks;
+	std::vector<std::function<void()>> _running;
+	std::exception_ptr _error;
+
+	static const wchar_t* ClassName() { return L"DirectUIDispatcher"; }
+
+	void RunCallbacks()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ _mutex };
+			_running.swap( _callbacks );
+		}
+
+		for ( auto& callback : _running )
+		{
+			try
+			{
+				callback();
+			}
+			catch ( ... )
+			{
+				if ( !_error )
+					_error = std::current_exception();
+			}
+		}
+		_running.clear();
+	}
+
+	static LRESULT CALLBACK WindowProc( HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam )
+	{
+		if ( message == k_RunCallbacks )
+		{
+			reinterpret_cast< UiDispatcher* >( ::GetWindowLongPtrW( hwnd, GWLP_USERDATA ) )->RunCallbacks();
+			return 0;
+		}
+		return ::DefWindowProcW( hwnd, message, wParam, lParam );
+	}
+
+public:
+	UiDispatcher()
+	{
+		WNDCLASSEXW wc{};
+		wc.cbSize = sizeof( WNDCLASSEX );
+		wc.lpfnWndProc = WindowProc;
+		wc.hInstance = ::GetModuleHandle( nullptr );
+		wc.lpszClassName = ClassName();
+		::RegisterClassExW( &wc );
+
+		_hwnd = ::CreateWindowExW( 0, ClassName(), nullptr, 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, wc.hInstance, nullptr );
+		::SetWindowLongPtrW( _hwnd, GWLP_USERDATA, reinterpret_cast< LONG_PTR >( this ) );
+	}
+
+	~UiDispatcher()
+	{
+		::DestroyWindow( _hwnd );
+	}
+
+	void Post( std::function<void()> callback ) override
+	{
+		bool wake;
+		{
+			std::lock_guard<std::mutex> lock{ _mutex };
+			wake = _callbacks.empty();
+			_callbacks.push_back( std::move( callback ) );
+		}
+
+		// One message drains everything posted until it is handled.
+		if ( wake )
+			::PostMessageW( _hwnd, k_RunCallbacks, 0, 0 );
+	}
+
+	// Called by the message loop after dispatching a message.
+	void RethrowError()
+	{
+		if ( auto error = std::exchange( _error, nullptr ) )
+			std::rethrow_exception( error );
+	}
+};
+
+class Application::Impl
+{
+private:
+	// Startup, from the constructor to the first presented frame
+	std::chrono::steady_clock::time_point _startTime{ std::chrono::steady_clock::now() };
+	std::vector<graphics::StartupPhase> _startupPhases;
+	std::atomic<bool> _started{ false };
+	mutable std::mutex _startupMutex;
+
+	std::unique_ptr<graphics::Device> _device;
+	Animator _animator;
+
+	// The pool is destroyed first, jobs still finishing can post to the dispatcher.
+	UiDispatcher _uiDispatcher;
+	TaskPool _taskPool;
+
+	// Main windows, the loop of Run() ends when the last one is destroyed
+	std::vector<Window*> _windows;
+	Window* _quitWindow{ nullptr };
+	bool _renderThreads{ false };
+
+	std::thread::id _uiThreadId;
+
+	// Delayed callbacks and timers, due times are coalesced to frames
+	using Clock = std::chrono::steady_clock;
+	TimerWheel _timerWheel;
+
+	// Callbacks for the next frame, paced like animations
+	std::vector<std::function<void()>> _frameCallbacks;
+	std::vector<std::function<void()>> _runningFrameCallbacks;
+	Clock::time_point _lastFrame;
+
+	Clock::time_point NextFrameTime() const
+	{
+		return _lastFrame + std::chrono::duration_cast< Clock::duration >( std::chrono::duration<float>( Animator::k_FrameInterval ) );
+	}
+
+	void RunDue()
+	{
+		auto now = Clock::now();
+
+		_timerWheel.Advance( now );
+
+		if ( !_frameCallbacks.empty() && NextFrameTime() <= now )
+		{
+			_lastFrame = now;
+			_runningFrameCallbacks.swap( _frameCallbacks );
+			for ( auto& callback : _runningFrameCallbacks )
+			{
+				callback();
+			}
+			_runningFrameCallbacks.clear();
+		}
+
+		if ( _animator.IsActive() && _animator.GetTimeUntilNextFrame() <= 0.0f )
+		{
+			// Windows invalidated by the update are painted by the next PeekMessage pass.
+			_animator.Update();
+		}
+	}
+
+	DWORD GetWaitTimeout() const
+	{
+		auto now = Clock::now();
+		auto next = Clock::time_point::max();
+
+		if ( auto due = _timerWheel.GetNextDue() )
+			next = std::min( next, *due );
+		if ( !_frameCallbacks.empty() )
+			next = std::min( next, NextFrameTime() );
+		if ( _animator.IsActive() )
+			next = std::min( next, now + std::chrono::duration_cast< Clock::duration >( std::chrono::duration<float>( _animator.GetTimeUntilNextFrame() ) ) );
+
+		if ( next == Clock::time_point::max() )
+			return INFINITE;
+		if ( next <= now )
+			return 0;
+
+		// Rounded up, waking early would only spin until the deadline.
+		auto milliseconds = std::chrono::ceil<std::chrono::milliseconds>( next - now ).count();
+		return static_cast< DWORD >( std::min<long long>( milliseconds, INFINITE - 1 ) );
+	}
+
+public:
+	Impl()
+		: _uiThreadId{ std::this_thread::get_id() }
+		, _timerWheel{ std::chrono::milliseconds( 1 ), std::chrono::duration_cast< Clock::duration >( std::chrono::duration<float>( Animator::k_FrameInterval ) ) }
+	{
+		auto deviceBegin = Clock::now();
+		_device = graphics::dx::CreateDevice();
+		AddStartupPhase( "Device", deviceBegin );
+		for ( const auto& phase : _device->GetStartupPhases() )
+		{
+			_startupPhases.push_back( phase );
+		}
+		AddStartupPhase( "Application", _startTime );
+	}
+
+	// Only the first phase of a name is kept, until the first frame is presented.
+	void AddStartupPhase( const char* name, Clock::time_point begin )
+	{
+		auto end = Clock::now();
+		if ( _started )
+			return;
+
+		std::lock_guard<std::mutex> lock{ _startupMutex };
+		auto it = std::find_if( _startupPhases.begin(), _startupPhases.end(), [name] ( const graphics::StartupPhase& phase ) {
+			return std::strcmp( phase.name, name ) == 0;
+		} );
+		if ( it == _startupPhases.end() )
+			_startupPhases.push_back( graphics::StartupPhase{ name, begin, end - begin } );
+	}
+
+	void OnFramePresented()
+	{
+		if ( _started )
+			return;
+
+		AddStartupPhase( "First frame", _startTime );
+		_started = true;
+	}
+
+	std::vector<graphics::StartupPhase> GetStartupPhases() const
+	{
+		std::lock_guard<std::mutex> lock{ _startupMutex };
+		return _startupPhases;
+	}
+
+	bool IsUiThread() const
+	{
+		return std::this_thread::get_id() == _uiThreadId;
+	}
+
+	TimerId StartTimer( Clock::duration delay, std::function<void()> callback, Clock::duration period )
+	{
+		return _timerWheel.Start( delay, std::move( callback ), period );
+	}
+
+	bool CancelTimer( TimerId id )
+	{
+		return _timerWheel.Cancel( id );
+	}
+
+	void PostNextFrame( std::function<void()> callback )
+	{
+		_frameCallbacks.push_back( std::move( callback ) );
+	}
+
+	void RegisterWindow( Window& window )
+	{
+		_windows.push_back( &window );
+	}
+
+	bool UnregisterWindow( Window& window )
+	{
+		auto it = std::find( _windows.begin(), _windows.end(), &window );
+		if ( it == _windows.end() )
+			return false;
+		_windows.erase( it );
+		return true;
+	}
+
+	void OnWindowDestroyed( Window& window )
+	{
+		bool registered = UnregisterWindow( window );
+		if ( &window == _quitWindow || ( _quitWindow == nullptr && registered && _windows.empty() ) )
+		{
+			::PostQuitMessage( 0 );
+		}
+	}
+
+	const std::vector<Window*>& GetWindows() const { return _windows; }
+
+	void SetRenderThreads( bool enabled ) { _renderThreads = enabled; }
+	bool GetRenderThreads() const { return _renderThreads; }
+
+	int MessageLoop( Window* quitWindow )
+	{
+		if ( quitWindow == nullptr && _windows.empty() )
+			return 0;
+
+		_quitWindow = quitWindow;
+
+		MSG msg;
+		for ( ;; )
+		{
+			while ( ::PeekMessageW( &msg, nullptr, 0, 0, PM_REMOVE ) )
+			{
+				if ( msg.message == WM_QUIT )
+				{
+					_quitWindow = nullptr;
+					return static_cast< int >( msg.wParam );
+				}
+
+				::TranslateMessage( &msg );
+				::DispatchMessageW( &msg );
+				_uiDispatcher.RethrowError();
+			}
+
+			RunDue();
+
+			auto timeout = GetWaitTimeout();
+			if ( timeout != 0 )
+			{
+				::MsgWaitForMultipleObjectsEx( 0, nullptr, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE );
+			}
+		}
+	}
+
+	graphics::Device& GetDevice()
+	{
+		return *_device.get();
+	}
+
+	Animator& GetAnimator()
+	{
+		return _animator;
+	}
+
+	TaskPool& GetTaskPool()
+	{
+		return _taskPool;
+	}
+
+	Dispatcher& GetUiDispatcher()
+	{
+		return _uiDispatcher;
+	}
+};
+
+Application::Application()
+{
+	_impl.reset( new Impl{} );
+	Instance() = this;
+}
+
+Application::~Application()
+{
+	_impl.reset();
+	Instance() = nullptr;
+}
+
+Application*& Application::Instance()
+{
+	static Application* _instance{ nullptr };
+	return _instance;
+}
+
+int Application::Run()
+{
+	return _impl->MessageLoop( nullptr );
+}
+
+int Application::Run( Window& window )
+{
+	return _impl->MessageLoop( &window );
+}
+
+void Application::AddStartupPhase( const char* name, std::chrono::steady_clock::time_point begin )
+{
+	_impl->AddStartupPhase( name, begin );
+}
+
+void Application::OnFramePresented()
+{
+	_impl->OnFramePresented();
+}
+
+std::vector<graphics::StartupPhase> Application::GetStartupPhases() const
+{
+	return _impl->GetStartupPhases();
+}
+
+void Application::SetRenderThreads( bool enabled )
+{
+	_impl->SetRenderThreads( enabled );
+}
+
+bool Application::GetRenderThreads() const
+{
+	return _impl->GetRenderThreads();
+}
+
+const std::vector<Window*>& Application::GetWindows() const
+{
+	return _impl->GetWindows();
+}
+
+void Application::RegisterWindow( Window& window )
+{
+	_impl->RegisterWindow( window );
+}
+
+void Application::UnregisterWindow( Window& window )
+{
+	_impl->UnregisterWindow( window );
+}
+
+void Application::OnWindowDestroyed( Window& window )
+{
+	_impl->OnWindowDestroyed( window );
+}
+
+graphics::Device& Application::GetDevice()
+{
+	return _impl->GetDevice();
+}
+
+Animator& Application::GetAnimator()
+{
+	return _impl->GetAnimator();
+}
+
+TaskPool& Application::GetTaskPool()
+{
+	return _impl->GetTaskPool();
+}
+
+Dispatcher& Application::GetUiDispatcher()
+{
+	return _impl->GetUiDispatcher();
+}
+
+bool Application::IsUiThread() const
+{
+	return _impl->IsUiThread();
+}
+
+void Application::PostDelayed( std::chrono::steady_clock::duration delay, std::function<void()> callback )
+{
+	if ( !_impl->IsUiThread() )
+	{
+		_impl->GetUiDispatcher().Post( [this, delay, callback = std::move( callback )] () mutable {
+			_impl->StartTimer( delay, std::move( callback ), std::chrono::steady_clock::duration::zero() );
+		} );
+		return;
+	}
+	_impl->StartTimer( delay, std::move( callback ), std::chrono::steady_clock::duration::zero() );
+}
+
+TimerId Application::StartTimer( std::chrono::steady_clock::duration delay, std::function<void()> callback, std::chrono::steady_clock::duration period )
+{
+	return _impl->StartTimer( delay, std::move( callback ), period );
+}
+
+bool Application::CancelTimer( TimerId id )
+{
+	return _impl->CancelTimer( id );
+}
+
+void Application::PostNextFrame( std::function<void()> callback )
+{
+	if ( !_impl->IsUiThread() )
+	{
+		_impl->GetUiDispatcher().Post( [this, callback = std::move( callback )] () mutable {
+			_impl->PostNextFrame( std::move( callback ) );
+		} );
+		return;
+	}
+	_impl->PostNextFrame( std::move( callback ) );
+}
+
+float GetSystemDpi()
+{
+	return static_cast< float >( ::GetDpiForSystem() );
+}
+
+} // namespace directui
+
@@ -1,83 +1,126 @@
-#pragma once
-
-#include "CoreTypes.h"
-
-#include <memory> // for std::unique_ptr
-#include <string> // for std::wstring
-#include <functional> // for std::function
-
-namespace graphics 
-{ 
-class Device;
-class DeviceContext;
-}
-
-namespace directui
-{
-
-using String = std::wstring;
-
-enum class WindowType
-{
-	Main,
-	Popup,
-	Child
-};
-
-enum class WindowRedraw
-{
-	Invalidate,
-	Now
-};
-
-enum class MouseButton
-{
-	None,
-	Left,
-	Middle,
-	Right,
-	Other
-};
-
-enum class MouseState
-{
-	Down,
-	Up,
-	Move,
-	DoubleClick
-};
-
-class Window;
-
-using DrawCallback = std::function<void( Window& window, graphics::DeviceContext& )>;
-using MouseCallback = std::function<void( Window& window, MouseState state, MouseButton button, PointPx position )>;
-
-class Window
-{
-private:
-	friend class Application;
-
-	class Impl;
-	std::unique_ptr<Impl> _impl;
-
-public:
-	DrawCallback OnDraw;
-	MouseCallback OnMouse;
-
-public:
-	Window( WindowType type, const RectPx& rcPx, Window* parentWindow );
-	~Window();
-
-	Handle GetHandle() const;
-	float GetDpi() const;
-	RectPx GetRect() const;
-	
-	void Show();
-	void Redraw( WindowRedraw redraw = WindowRedraw::Invalidate );
-
-	void Move( const RectPx& rcPx );
-};
-
-float GetSystemDpi();
-
-} //namespace directui
+#pragma once
+
+#include "CoreTypes.h"
+
+#include <memory> // for std::unique_ptr
+#include <string> // for std::wstring
+#include <functional> // for std::function
+#include <mutex> // for std::unique_lock
+#include <chrono> // for std::chrono::milliseconds
+
+namespace graphics 
+{ 
+class Device;
+class DeviceContext;
+struct ResourceUsage;
+struct ResourceBudget;
+}
+
+namespace directui
+{
+
+using String = std::wstring;
+
+enum class WindowType
+{
+	Main,
+	Popup,
+	Child
+};
+
+enum class WindowRedraw
+{
+	Invalidate,
+	Now
+};
+
+enum class MouseButton
+{
+	None,
+	Left,
+	Middle,
+	Right,
+	Other
+};
+
+enum class MouseState
+{
+	Down,
+	Up,
+	Move,
+	DoubleClick
+};
+
+class Window;
+class CancellationToken;
+class HitTestMap;
+struct LatencyStats;
+struct PointerBatch;
+
+using DrawCallback = std::function<void( Window& window, graphics::DeviceContext& )>;
+using MouseCallback = std::function<void( Window& window, MouseState state, MouseButton button, PointPx position )>;
+using PointerBatchCallback = std::function<void( Window& window, const PointerBatch& batch )>;
+
+class Window
+{
+private:
+	friend class Application;
+
+	class Impl;
+	std::unique_ptr<Impl> _impl;
+
+public:
+	DrawCallback OnDraw;
+	MouseCallback OnMouse;
+	// Every pointer move since the previous frame, including the moves the system coalesced into
+	// a single WM_MOUSEMOVE. Called once per frame right before OnDraw, on the same thread and under
+	// the draw lock. New samples request a frame.
+	PointerBatchCallback OnPointerBatch;
+
+public:
+	Window( WindowType type, const RectPx& rcPx, Window* parentWindow );
+	~Window();
+
+	Handle GetHandle() const;
+	float GetDpi() const;
+	RectPx GetRect() const;
+	
+	void Show();
+	void Redraw( WindowRedraw redraw = WindowRedraw::Invalidate );
+
+	void Move( const RectPx& rcPx );
+
+	// Non-client regions in DIPs, main windows default to a caption and resize borders.
+	// Without regions the whole window is client area. UI thread only.
+	void SetHitTestMap( const HitTestMap& map );
+
+	// How far ahead OnPointerBatch predicts the pointer position, zero disables prediction.
+	void SetPointerPrediction( std::chrono::milliseconds ahead );
+
+	// Cancelled when the window is destroyed.
+	CancellationToken GetCancellationToken() const;
+
+	// With a render thread OnDraw runs on that thread while holding the draw lock,
+	// state read by OnDraw has to be changed under LockDraw. OnMouse is then called under the
+	// lock too. Show, Move, Redraw, SetPointerPrediction and SetResourceBudget may be called
+	// from OnMouse, OnDraw and OnPointerBatch, except Redraw( WindowRedraw::Now ) from OnDraw.
+	// LockDraw and TryLockDraw may not, the calling thread already holds the lock. Called on
+	// another thread than the UI thread, Show, Move and Redraw( WindowRedraw::Now ) are posted
+	// to the UI thread and take effect after the call returned.
+	bool HasRenderThread() const;
+	std::unique_lock<std::mutex> LockDraw();
+	// Does not wait, the returned lock does not own the mutex while the window is drawing.
+	std::unique_lock<std::mutex> TryLockDraw();
+
+	// Resources owned by the device context of the window, see graphics::ResourceBudget.
+	graphics::ResourceUsage GetResourceUsage() const;
+	void SetResourceBudget( const graphics::ResourceBudget& budget );
+
+	// Input-to-present and input-to-display latency since the window was created or the last reset.
+	LatencyStats GetLatencyStats() const;
+	void ResetLatencyStats();
+};
+
+float GetSystemDpi();
+
+} //namespace directui
@@ -0,0 +1,621 @@
+// Replays draw captures against a graphics backend and reports per-frame CPU time,
+// draw calls and heap allocations, optionally compared to a saved baseline.
+//
+//   Replay <capture> [--backend null|cpu] [--threads N] [--iterations N] [--checksum]
+//          [--baseline file] [--save-baseline file] [--threshold percent]
+//   Replay --synthesize <capture> [--frames N]
+
+#include "../DirectUI/DrawCapture.h"
+#include "../DirectUI/NullGraphics.h"
+#include "../DirectUI/CpuGraphics.h"
+#if defined(_WIN32)
+#include "../DirectUI/DxGraphics.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace graphics;
+using namespace graphics::capture;
+
+namespace
+{
+
+std::atomic<size_t> g_allocations{ 0 };
+
+} // namespace
+
+void* operator new( size_t size )
+{
+	g_allocations.fetch_add( 1, std::memory_order_relaxed );
+	if ( void* p = std::malloc( size ? size : 1 ) )
+		return p;
+	throw std::bad_alloc{};
+}
+
+void* operator new[]( size_t size )
+{
+	return ::operator new( size );
+}
+
+void operator delete( void* p ) noexcept { std::free( p ); }
+void operator delete[]( void* p ) noexcept { std::free( p ); }
+void operator delete( void* p, size_t ) noexcept { std::free( p ); }
+void operator delete[]( void* p, size_t ) noexcept { std::free( p ); }
+
+namespace
+{
+
+struct FrameSample
+{
+	double milliseconds;
+	size_t drawCalls;
+	size_t allocations;
+};
+
+struct Summary
+{
+	double p50{ 0 }, p95{ 0 }, p99{ 0 }, mean{ 0 };
+	double drawCalls{ 0 };
+	double allocations{ 0 };
+	size_t frames{ 0 };
+};
+
+std::unique_ptr<Device> CreateBackend( const std::string& name, unsigned threads )
+{
+	if ( name == "null" )
+		return graphics::null::CreateDevice();
+	if ( name == "cpu" )
+		return graphics::cpu::CreateDevice( threads );
+#if defined(_WIN32)
+	if ( name == "dx" )
+		return graphics::dx::CreateDevice();
+#endif
+	return nullptr;
+}
+
+// Everything that would allocate while replaying (contexts, text formats, converted strings)
+// is prepared once, so measured allocations come from the backend alone. Captures are read
+// from files, the order of records the replay relies on is checked first.
+class Replayer
+{
+private:
+	static constexpr uint32_t k_MaxContexts = 256;
+
+	Device& _device;
+	CaptureView _view;
+	const char* _error{ nullptr };
+	std::vector<std::unique_ptr<DeviceContext>> _contexts;
+	std::map<std::pair<String, float>, std::unique_ptr<TextFormat>> _formats;
+	std::vector<const TextFormat*> _textFormats;
+	std::vector<String> _texts;
+	std::vector<std::unique_ptr<GradientBrush>> _gradientBrushes;
+	std::vector<uint32_t> _pixels;
+
+	std::unique_ptr<GradientBrush> CreateGradientBrush( const FillGradientRectRecord& fill )
+	{
+		GradientStops stops;
+		stops.stops.assign( fill.Stops(), fill.Stops() + fill.stopCount );
+		stops.extend = static_cast< GradientExtend >( fill.extend );
+
+		std::unique_ptr<GradientBrush> brush;
+		if ( static_cast< GradientType >( fill.gradientType ) == GradientType::Radial )
+			brush = _device.CreateGradientBrush( RadialGradient{ fill.center, fill.radiusX, fill.radiusY }, stops );
+		else
+			brush = _device.CreateGradientBrush( LinearGradient{ fill.start, fill.end }, stops );
+		brush->SetTransform( fill.transform );
+		return brush;
+	}
+
+	static bool HasPayload( const CaptureView::Record& record )
+	{
+		switch ( record.GetType() )
+		{
+			case RecordType::BeginFrame: return record.As<BeginFrameRecord>() != nullptr;
+			case RecordType::EndFrame: return record.As<EndFrameRecord>() != nullptr;
+			case RecordType::Clear: return record.As<ClearRecord>() != nullptr;
+			case RecordType::FillRect: return record.As<FillRectRecord>() != nullptr;
+			case RecordType::DrawRect: return record.As<DrawRectRecord>() != nullptr;
+			case RecordType::DrawTextRun: return record.As<DrawTextRunRecord>() != nullptr;
+			case RecordType::PushClip: return record.As<PushClipRecord>() != nullptr;
+			case RecordType::PopClip: return record.As<PopClipRecord>() != nullptr;
+			case RecordType::BeginLayer: return record.As<BeginLayerRecord>() != nullptr;
+			case RecordType::EndLayer: return record.As<EndLayerRecord>() != nullptr;
+			case RecordType::InvalidateLayer: return record.As<InvalidateLayerRecord>() != nullptr;
+			case RecordType::FillGradientRect: return record.As<FillGradientRectRecord>() != nullptr;
+			default: return true; // unknown records are skipped
+		}
+	}
+
+	// Returns why the capture cannot be replayed, null when it can.
+	const char* Validate() const
+	{
+		bool inFrame = false;
+		size_t clipDepth = 0;
+		size_t layerDepth = 0;
+		for ( auto record : _view )
+		{
+			if ( !HasPayload( record ) )
+				return "record is too small";
+
+			switch ( record.GetType() )
+			{
+				case RecordType::BeginFrame:
+				{
+					if ( inFrame )
+						return "frame begins inside a frame";
+					if ( record.As<BeginFrameRecord>()->contextId >= k_MaxContexts )
+						return "device context id out of range";
+					inFrame = true;
+					clipDepth = 0;
+					layerDepth = 0;
+				} break;
+				case RecordType::EndFrame:
+				{
+					if ( !inFrame )
+						return "frame ends outside a frame";
+					inFrame = false;
+				} break;
+				case RecordType::InvalidateLayer:
+					break; // also recorded between frames
+				case RecordType::Clear:
+				case RecordType::FillRect:
+				case RecordType::DrawRect:
+				case RecordType::DrawTextRun:
+				case RecordType::PushClip:
+				case RecordType::PopClip:
+				case RecordType::BeginLayer:
+				case RecordType::EndLayer:
+				case RecordType::FillGradientRect:
+				{
+					if ( !inFrame )
+						return "draw record outside a frame";
+					if ( record.GetType() == RecordType::PushClip )
+						clipDepth++;
+					else if ( record.GetType() == RecordType::BeginLayer )
+						layerDepth++;
+					else if ( record.GetType() == RecordType::PopClip && clipDepth-- == 0 )
+						return "clip popped without push";
+					else if ( record.GetType() == RecordType::EndLayer && layerDepth-- == 0 )
+						return "layer ended without begin";
+				} break;
+				default:
+					break;
+			}
+		}
+		return nullptr;
+	}
+
+public:
+	Replayer( Device& device, const CaptureView& view )
+		: _device{ device }
+		, _view{ view }
+	{
+		_error = Validate();
+		if ( _error != nullptr )
+			return;
+
+		for ( auto record : _view )
+		{
+			if ( auto frame = record.As<BeginFrameRecord>() )
+			{
+				while ( _contexts.size() <= frame->contextId )
+				{
+					_contexts.push_back( _device.CreateDeviceContext() );
+				}
+			}
+			else if ( auto text = record.As<DrawTextRunRecord>() )
+			{
+				auto key = std::make_pair( ToString( text->Family(), text->familyLength ), text->fontSize );
+				auto& format = _formats[ key ];
+				if ( format == nullptr )
+				{
+					format = _device.CreateTextFormat( key.first, key.second );
+				}
+				_textFormats.push_back( format.get() );
+				_texts.push_back( ToString( text->Text(), text->textLength ) );
+			}
+			else if ( auto gradient = record.As<FillGradientRectRecord>() )
+			{
+				_gradientBrushes.push_back( CreateGradientBrush( *gradient ) );
+			}
+		}
+	}
+
+	const char* GetError() const { return _error; }
+
+	// FNV-1a over the pixels of every frame, equal checksums mean identical output.
+	void HashFrame( DeviceContext& dc, uint64_t& hash )
+	{
+		auto rect = dc.GetDrawRect();
+		auto scale = dc.GetDpi() / 96.0f;
+		auto width = static_cast< int >( std::lround( rect.w * scale ) );
+		auto height = static_cast< int >( std::lround( rect.h * scale ) );
+		_pixels.assign( static_cast< size_t >( width ) * height, 0 );
+		dc.PollReadback( dc.QueueReadback( _pixels.data(), width * 4 ), true );
+		for ( auto pixel : _pixels )
+		{
+			hash = ( hash ^ pixel ) * 1099511628211ull;
+		}
+	}
+
+	void Run( std::vector<FrameSample>& samples, uint64_t* checksum = nullptr )
+	{
+		using Clock = std::chrono::steady_clock;
+
+		DeviceContext* dc = nullptr;
+		Clock::time_point frameStart;
+		size_t allocationsStart = 0;
+		size_t drawCalls = 0;
+		size_t textIndex = 0;
+		size_t gradientIndex = 0;
+		int skipDepth = 0;
+
+		for ( auto record : _view )
+		{
+			// Content of layers that are still cached in the backend is skipped like the application would.
+			if ( skipDepth > 0 )
+			{
+				if ( record.GetType() == RecordType::DrawTextRun )
+					textIndex++;
+				else if ( record.GetType() == RecordType::FillGradientRect )
+					gradientIndex++;
+				else if ( record.GetType() == RecordType::BeginLayer )
+					skipDepth++;
+				else if ( record.GetType() == RecordType::EndLayer )
+					skipDepth--;
+
+				if ( skipDepth > 0 )
+					continue;
+			}
+
+			switch ( record.GetType() )
+			{
+				case RecordType::BeginFrame:
+				{
+					auto frame = record.As<BeginFrameRecord>();
+					dc = _contexts[ frame->contextId ].get();
+					directui::SizePx sizePx{
+						static_cast< int >( std::ceil( frame->size.w * frame->dpi / 96.0f ) ),
+						static_cast< int >( std::ceil( frame->size.h * frame->dpi / 96.0f ) ) };
+
+					drawCalls = 0;
+					allocationsStart = g_allocations.load( std::memory_order_relaxed );
+					frameStart = Clock::now();
+					dc->BeginDraw( sizePx, frame->dpi );
+				} break;
+				case RecordType::EndFrame:
+				{
+					dc->EndDraw();
+					auto elapsed = std::chrono::duration<double, std::milli>( Clock::now() - frameStart ).count();
+					samples.push_back( FrameSample{ elapsed, drawCalls, g_allocations.load( std::memory_order_relaxed ) - allocationsStart } );
+					if ( checksum != nullptr )
+						HashFrame( *dc, *checksum );
+				} break;
+				case RecordType::Clear:
+				{
+					dc->Clear( record.As<ClearRecord>()->color );
+					drawCalls++;
+				} break;
+				case RecordType::FillRect:
+				{
+					auto fill = record.As<FillRectRecord>();
+					dc->FillRect( dc->CreateFrameSolidBrush( fill->color ), fill->rect );
+					drawCalls++;
+				} break;
+				case RecordType::FillGradientRect:
+				{
+					dc->FillRect( *_gradientBrushes[ gradientIndex ], record.As<FillGradientRectRecord>()->rect );
+					gradientIndex++;
+					drawCalls++;
+				} break;
+				case RecordType::DrawRect:
+				{
+					auto stroke = record.As<DrawRectRecord>();
+					dc->DrawRect( dc->CreateFrameSolidBrush( stroke->color ), stroke->rect, stroke->strokeWidth );
+					drawCalls++;
+				} break;
+				case RecordType::DrawTextRun:
+				{
+					auto text = record.As<DrawTextRunRecord>();
+					auto& layout = dc->CreateFrameTextLayout( _texts[ textIndex ], *_textFormats[ textIndex ], text->layoutSize );
+					layout.SetTextAlignment( static_cast< TextAlignment >( text->textAlignment ) );
+					layout.SetParagraphAlignment( static_cast< ParagraphAlignment >( text->paragraphAlignment ) );
+					dc->DrawTextLayout( layout, dc->CreateFrameSolidBrush( text->color ), text->position );
+					textIndex++;
+					drawCalls++;
+				} break;
+				case RecordType::PushClip:
+				{
+					dc->PushClip( record.As<PushClipRecord>()->rect );
+				} break;
+				case RecordType::PopClip:
+				{
+					dc->PopClip();
+				} break;
+				case RecordType::BeginLayer:
+				{
+					auto layer = record.As<BeginLayerRecord>();
+					if ( !dc->BeginLayer( layer->id, layer->bounds ) )
+						skipDepth = 1;
+				} break;
+				case RecordType::EndLayer:
+				{
+					auto layer = record.As<EndLayerRecord>();
+					dc->EndLayer( layer->transform, layer->opacity );
+					drawCalls++;
+				} break;
+				case RecordType::InvalidateLayer:
+				{
+					// Before the first frame nothing is cached yet.
+					if ( dc != nullptr )
+						dc->InvalidateLayer( record.As<InvalidateLayerRecord>()->id );
+				} break;
+				default:
+					break;
+			}
+		}
+	}
+};
+
+Summary Summarize( std::vector<FrameSample> samples )
+{
+	Summary summary;
+	summary.frames = samples.size();
+	if ( samples.empty() )
+		return summary;
+
+	double total = 0;
+	for ( const auto& sample : samples )
+	{
+		total += sample.milliseconds;
+		summary.drawCalls += static_cast< double >( sample.drawCalls );
+		summary.allocations += static_cast< double >( sample.allocations );
+	}
+	summary.mean = total / samples.size();
+	summary.drawCalls /= samples.size();
+	summary.allocations /= samples.size();
+
+	std::sort( samples.begin(), samples.end(), [] ( const FrameSample& a, const FrameSample& b ) { return a.milliseconds < b.milliseconds; } );
+	auto percentile = [&samples] ( double p ) {
+		auto index = static_cast< size_t >( std::ceil( p * samples.size() ) );
+		return samples[ std::min( samples.size() - 1, index > 0 ? index - 1 : 0 ) ].milliseconds;
+	};
+	summary.p50 = percentile( 0.50 );
+	summary.p95 = percentile( 0.95 );
+	summary.p99 = percentile( 0.99 );
+	return summary;
+}
+
+bool SaveBaseline( const std::string& path, const Summary& summary )
+{
+	std::ofstream file( path, std::ios::trunc );
+	file << "p50 " << summary.p50 << "\n";
+	file << "p95 " << summary.p95 << "\n";
+	file << "p99 " << summary.p99 << "\n";
+	file << "mean " << summary.mean << "\n";
+	file << "drawCalls " << summary.drawCalls << "\n";
+	file << "allocations " << summary.allocations << "\n";
+	return file.good();
+}
+
+bool LoadBaseline( const std::string& path, Summary& summary )
+{
+	std::ifstream file( path );
+	if ( !file )
+		return false;
+
+	std::string key;
+	double value;
+	while ( file >> key >> value )
+	{
+		if ( key == "p50" ) summary.p50 = value;
+		else if ( key == "p95" ) summary.p95 = value;
+		else if ( key == "p99" ) summary.p99 = value;
+		else if ( key == "mean" ) summary.mean = value;
+		else if ( key == "drawCalls" ) summary.drawCalls = value;
+		else if ( key == "allocations" ) summary.allocations = value;
+	}
+	return true;
+}
+
+// Per frame average, less than one allocation per frame more is not counted as a regression.
+constexpr double k_AllocationSlack = 0.5;
+
+// Returns true when the metric regressed beyond the threshold and grew by more than the slack.
+bool Compare( const char* name, double baseline, double current, double thresholdPercent, double slack = 0.0 )
+{
+	double change = baseline > 0 ? ( current - baseline ) / baseline * 100.0 : ( current > 0 ? 100.0 : 0.0 );
+	bool regressed = change > thresholdPercent && current - baseline > slack;
+	printf( "  %-12s %10.3f -> %10.3f  %+7.1f%%%s\n", name, baseline, current, change, regressed ? "  REGRESSION" : "" );
+	return regressed;
+}
+
+// Writes a dashboard-like workload through the capture device, for smoke tests and CI without production captures.
+int Synthesize( const std::string& path, int frames )
+{
+	CaptureWriter writer;
+	auto device = CreateCaptureDevice( graphics::null::CreateDevice(), writer );
+	auto dc = device->CreateDeviceContext();
+	auto format = device->CreateTextFormat( L"Segoe UI", 12 );
+
+	constexpr int k_Columns = 16;
+	constexpr int k_Rows = 40;
+	constexpr float k_CellWidth = 80;
+	constexpr float k_CellHeight = 20;
+
+	for ( int frame = 0; frame < frames; ++frame )
+	{
+		dc->BeginDraw( directui::SizePx{ 1280, 860 }, 96.0f );
+		dc->Clear( ColorF{ 0x2D2D30, 1 } );
+
+		if ( dc->BeginLayer( 1, RectF{ 0, 0, 1280, 40 } ) )
+		{
+			dc->FillSolidRect( ColorF{ 0x1B1B1C, 1 }, RectF{ 0, 0, 1280, 40 } );
+			auto& title = dc->CreateFrameTextLayout( L"Dashboard", *format, SizeF{ 200, 40 } );
+			dc->DrawTextLayout( title, dc->CreateFrameSolidBrush( ColorF{ 0xFFFFFF, 1 } ), PointF{ 10, 0 } );
+		}
+		dc->EndLayer();
+
+		dc->PushClip( RectF{ 0, 40, 1280, 820 } );
+		for ( int row = 0; row < k_Rows; ++row )
+		{
+			for ( int column = 0; column < k_Columns; ++column )
+			{
+				RectF cell{ column * k_CellWidth, 40 + row * k_CellHeight, k_CellWidth, k_CellHeight };
+				bool flash = ( row * k_Columns + column + frame ) % 7 == 0;
+				dc->FillSolidRect( ColorF{ flash ? 0x3E3E40u : 0x252526u, 1 }, cell );
+				dc->DrawSolidRect( ColorF{ 0x3F3F46, 1 }, cell );
+
+				wchar_t text[ 16 ];
+				swprintf( text, 16, L"%d.%02d", row * 10 + column, ( frame + column ) % 100 );
+				auto& layout = dc->CreateFrameTextLayout( text, *format, SizeF{ cell.w, cell.h } );
+				layout.SetTextAlignment( TextAlignment::Trailing );
+				dc->DrawTextLayout( layout, dc->CreateFrameSolidBrush( ColorF{ 0xDCDCDC, 1 } ), PointF{ cell.x, cell.y } );
+			}
+		}
+		dc->PopClip();
+		dc->EndDraw();
+	}
+
+	if ( !writer.Save( path ) )
+	{
+		fprintf( stderr, "Cannot write %s\n", path.c_str() );
+		return 1;
+	}
+	printf( "Wrote %d frames to %s\n", frames, path.c_str() );
+	return 0;
+}
+
+int Usage()
+{
+	fprintf( stderr,
+		"Usage: Replay <capture> [--backend null|cpu] [--threads N] [--iterations N] [--checksum]\n"
+		"              [--baseline file] [--save-baseline file] [--threshold percent]\n"
+		"       Replay --synthesize <capture> [--frames N]\n" );
+	return 2;
+}
+
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+	std::string capturePath;
+	std::string backendName = "null";
+	std::string baselinePath;
+	std::string saveBaselinePath;
+	std::string synthesizePath;
+	unsigned threads = 0;
+	bool checksum = false;
+	int iterations = 10;
+	int frames = 120;
+	double threshold = 10.0;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		std::string arg = argv[ i ];
+		bool hasValue = i + 1 < argc;
+		if ( arg == "--backend" && hasValue ) backendName = argv[ ++i ];
+		else if ( arg == "--threads" && hasValue ) threads = static_cast< unsigned >( std::max( 0, atoi( argv[ ++i ] ) ) );
+		else if ( arg == "--checksum" ) checksum = true;
+		else if ( arg == "--iterations" && hasValue ) iterations = std::max( 1, atoi( argv[ ++i ] ) );
+		else if ( arg == "--baseline" && hasValue ) baselinePath = argv[ ++i ];
+		else if ( arg == "--save-baseline" && hasValue ) saveBaselinePath = argv[ ++i ];
+		else if ( arg == "--threshold" && hasValue ) threshold = atof( argv[ ++i ] );
+		else if ( arg == "--synthesize" && hasValue ) synthesizePath = argv[ ++i ];
+		else if ( arg == "--frames" && hasValue ) frames = std::max( 1, atoi( argv[ ++i ] ) );
+		else if ( arg.size() > 2 && arg.compare( 0, 2, "--" ) == 0 ) return Usage();
+		else capturePath = arg;
+	}
+
+	if ( !synthesizePath.empty() )
+		return Synthesize( synthesizePath, frames );
+
+	if ( capturePath.empty() )
+		return Usage();
+
+	MappedCapture capture;
+	if ( !capture.Open( capturePath ) )
+	{
+		fprintf( stderr, "Cannot open capture %s\n", capturePath.c_str() );
+		return 1;
+	}
+
+	auto device = CreateBackend( backendName, threads );
+	if ( device == nullptr )
+	{
+		fprintf( stderr, "Unknown backend %s\n", backendName.c_str() );
+		return 1;
+	}
+
+	Replayer replayer{ *device, capture.GetView() };
+	if ( auto error = replayer.GetError() )
+	{
+		fprintf( stderr, "Cannot replay %s: %s\n", capturePath.c_str(), error );
+		return 1;
+	}
+
+	std::vector<FrameSample> samples;
+	samples.reserve( static_cast< size_t >( capture.GetView().GetHeader()->frameCount ) * iterations );
+
+	// The first pass warms up caches and arenas and is not measured.
+	std::vector<FrameSample> warmup;
+	warmup.reserve( capture.GetView().GetHeader()->frameCount );
+	uint64_t hash = 14695981039346656037ull;
+	replayer.Run( warmup, checksum ? &hash : nullptr );
+	if ( checksum )
+		printf( "Checksum %016llx\n", static_cast< unsigned long long >( hash ) );
+
+	for ( int i = 0; i < iterations; ++i )
+	{
+		replayer.Run( samples );
+	}
+
+	auto summary = Summarize( samples );
+	printf( "Backend %s, %zu frames (%d iterations)\n", backendName.c_str(), summary.frames, iterations );
+	printf( "  cpu ms       p50 %.3f  p95 %.3f  p99 %.3f  mean %.3f\n", summary.p50, summary.p95, summary.p99, summary.mean );
+	printf( "  draw calls   %.1f per frame\n", summary.drawCalls );
+	printf( "  allocations  %.1f per frame\n", summary.allocations );
+
+	auto usage = device->GetResourceUsage();
+	printf( "  resources    %.1f KiB in %u bitmaps, %u text layouts, %u brushes\n",
+		usage.GetTotalBytes() / 1024.0, usage.GetCount( ResourceType::Bitmap ),
+		usage.GetCount( ResourceType::TextLayout ), usage.GetCount( ResourceType::Brush ) );
+
+	if ( !saveBaselinePath.empty() && !SaveBaseline( saveBaselinePath, summary ) )
+	{
+		fprintf( stderr, "Cannot write baseline %s\n", saveBaselinePath.c_str() );
+		return 1;
+	}
+
+	if ( !baselinePath.empty() )
+	{
+		Summary baseline;
+		if ( !LoadBaseline( baselinePath, baseline ) )
+		{
+			fprintf( stderr, "Cannot read baseline %s\n", baselinePath.c_str() );
+			return 1;
+		}
+
+		printf( "Compared to baseline %s (threshold %.1f%%)\n", baselinePath.c_str(), threshold );
+		bool regressed = false;
+		regressed |= Compare( "p50 ms", baseline.p50, summary.p50, threshold );
+		regressed |= Compare( "p95 ms", baseline.p95, summary.p95, threshold );
+		regressed |= Compare( "p99 ms", baseline.p99, summary.p99, threshold );
+		regressed |= Compare( "draw calls", baseline.drawCalls, summary.drawCalls, 0.0 );
+		// Backends drawing on worker threads allocate a varying fraction of a block per frame.
+		regressed |= Compare( "allocations", baseline.allocations, summary.allocations, 0.0, k_AllocationSlack );
+		return regressed ? 1 : 0;
+	}
+
+	return 0;
+}